@@ -846,9 +846,17 @@ static int load_image(int fd, const char *path,
     int free = (int)MIN(buffer_len - buf_used(), buffer_len - bufidx)
                         - sizeof(struct bitmap);
 
+    /* the same cover at the same size decodes to the same bitmap */
+    struct albumart_cache_key key;
+    if (aa != NULL)
+        lseek(fd, aa->pos, SEEK_SET);
+    albumart_cache_key(fd, path, aa ? aa->size : filesize(fd), dim, &key);
+    rc = albumart_cache_load(&key, bmp, free);
+    if (rc > 0)
+        return rc + sizeof(struct bitmap);
+
 #ifdef HAVE_JPEG
     if (aa != NULL) {
-        lseek(fd, aa->pos, SEEK_SET);
         rc = clip_jpeg_fd(fd, aa->size, bmp, free, FORMAT_NATIVE|FORMAT_DITHER|
                          FORMAT_RESIZE|FORMAT_KEEP_ASPECT, NULL);
     }
@@ -860,8 +868,10 @@ static int load_image(int fd, const char *path,
         rc = read_bmp_fd(fd, bmp, free, FORMAT_NATIVE|FORMAT_DITHER|
                          FORMAT_RESIZE|FORMAT_KEEP_ASPECT, NULL);
 
+    if (rc > 0)
+        albumart_cache_save(&key, bmp, rc);
+
     return rc + (rc > 0 ? sizeof(struct bitmap) : 0);
-    (void)path;
 }
 #endif /* HAVE_ALBUMART */
 
@@ -1705,6 +1715,7 @@ void INIT_ATTR buffering_init(void)
        Whoever is using buffering should be responsible enough to clear all
        the handles at the right time. */
     queue_init(&buffering_queue, false);
+    queue_enable_lockfree(&buffering_queue);
     buffering_thread_id = create_thread( buffering_thread, buffering_stack,
             sizeof(buffering_stack), CREATE_THREAD_FROZEN,
             buffering_thread_name IF_PRIO(, PRIORITY_BUFFERING)
@@ -92,6 +92,16 @@ static struct event_queue codec_queue SHAREDBSS_ATTR;
 static struct queue_sender_list codec_queue_sender_list SHAREDBSS_ATTR;
 static long codec_stack[(DEFAULT_STACK_SIZE + 0x2000)/sizeof(long)] IBSS_ATTR;
 static const char codec_thread_name[] = "codec";
+#ifdef HAVE_ADJUSTABLE_CPU_FREQ
+/* Decode time per second of output, for the frequency controller */
+static struct cpu_demand_meter codec_demand;
+static int codec_demand_type = AFMT_UNKNOWN;
+#else
+#define cpu_demand_begin(m)             do {} while (0)
+#define cpu_demand_end(m)               do {} while (0)
+#define cpu_demand_pause(m)             do {} while (0)
+#define cpu_demand_work(m, units, rate) do {} while (0)
+#endif
 
 static void unload_codec(void);
 
@@ -234,7 +244,9 @@ static void codec_pcmbuf_insert_callback(
 
             /* It may be awhile before space is available but we want
                "instant" response to any message */
+            cpu_demand_end(&codec_demand);
             queue_wait_w_tmo(&codec_queue, NULL, HZ/20);
+            cpu_demand_begin(&codec_demand);
         }
         else
         {
@@ -244,6 +256,8 @@ static void codec_pcmbuf_insert_callback(
             {
                 pcmbuf_write_complete(dst.remcount, ci.id3->elapsed,
                                       ci.id3->offset);
+                cpu_demand_work(&codec_demand, dst.remcount,
+                                pcmbuf_get_frequency());
             }
             else if (src.remcount <= 0)
             {
@@ -380,9 +394,11 @@ static enum codec_command_action
 
         case Q_CODEC_PAUSE: /* Stay here and wait */
             LOGFQUEUE("codec < Q_CODEC_PAUSE");
+            cpu_demand_pause(&codec_demand);
             queue_wait(&codec_queue, &ev);  /* Remove message */
             codec_queue_ack(Q_CODEC_PAUSE);
             queue_wait(&codec_queue, NULL); /* Wait for next (no remove) */
+            cpu_demand_begin(&codec_demand);
             continue;
 
         case Q_CODEC_SEEK:  /* Audio wants codec to seek */
@@ -516,8 +532,20 @@ static void run_codec(void)
         buf_pin_handle(ci.audio_hid, true);
     }
 
+#ifdef HAVE_ADJUSTABLE_CPU_FREQ
+    /* Another codec needs another estimate */
+    if (codec_type != codec_demand_type)
+    {
+        cpu_demand_reset(&codec_demand);
+        codec_demand_type = codec_type;
+    }
+#endif
+    cpu_demand_begin(&codec_demand);
+
     status = codec_run_proc();
 
+    cpu_demand_pause(&codec_demand);
+
     if (!encoder)
     {
         /* Codec is done with it - let it move */
@@ -640,6 +668,7 @@ void INIT_ATTR codec_thread_init(void)
 
     /* Init threading */
     queue_init(&codec_queue, false);
+    queue_enable_lockfree(&codec_queue);
     codec_thread_id = create_thread(
             codec_thread, codec_stack, sizeof(codec_stack), 0,
             codec_thread_name IF_PRIO(, PRIORITY_PLAYBACK)
@@ -742,3 +771,28 @@ int codec_loaded(void)
 {
     return codec_type;
 }
+
+#ifdef HAVE_CODEC_PRELOAD
+/* Open the codec for an upcoming format transition while the current one
+   keeps decoding - the codec thread only touches the standby slot while the
+   audio thread waits in codec_load() so no further locking is needed */
+void codec_preload(int cod_spec)
+{
+    if (type_is_encoder(cod_spec))
+        return;
+
+    const char *codec_fn = get_codec_filename(cod_spec);
+
+    if (codec_fn)
+    {
+        logf("Preloading codec: %d", cod_spec);
+        codec_preload_file(codec_fn);
+    }
+}
+
+/* Drop any codec opened by codec_preload() that wasn't used */
+void codec_preload_cancel(void)
+{
+    codec_preload_discard();
+}
+#endif /* HAVE_CODEC_PRELOAD */
@@ -25,6 +25,11 @@
 #include <stdbool.h>
 #include "config.h"
 
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+/* Hosted builds can't buffer codecs but can open the next one early */
+#define HAVE_CODEC_PRELOAD
+#endif
+
 /* codec identity */
 const char *get_codec_filename(int cod_spec);
 
@@ -51,6 +56,10 @@ size_t codec_finish_stream(void);
 #endif
 void codec_unload(void);
 int codec_loaded(void);
+#ifdef HAVE_CODEC_PRELOAD
+void codec_preload(int cod_spec);
+void codec_preload_cancel(void);
+#endif
 
 /* */
 
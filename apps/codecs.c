@@ -51,6 +51,7 @@
 #include "splash.h"
 #include "general.h"
 #include "rbpaths.h"
+#include "heap.h"
 
 #define LOGF_ENABLE
 #include "logf.h"
@@ -150,7 +151,12 @@ struct codec_api ci = {
 
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
-
+    codec_heap_create,
+    heap_destroy,
+    heap_malloc,
+    heap_calloc,
+    heap_realloc,
+    heap_free,
 };
 
 void codec_get_full_path(char *path, const char *codec_root_fn)
@@ -174,10 +180,57 @@ void *codec_get_buffer_callback(size_t *size)
     return buf;
 }
 
+int codec_heap_create(const char *name, void *buf, size_t size)
+{
+    return heap_create(name, buf, size, HEAP_OWNER_CODEC);
+}
+
 /** codec loading and call interface **/
 static void *curr_handle = NULL;
 static struct codec_header *c_hdr = NULL;
 
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+/* Standby slot - the codec for an upcoming format transition, opened ahead
+   of time so the track change doesn't wait on storage and the dynamic
+   loader. Hosted codecs live outside of codecbuf so two can be open. */
+static void *preload_handle = NULL;
+static char preload_path[MAX_PATH];
+
+int codec_preload_file(const char *plugin)
+{
+    char path[MAX_PATH];
+
+    codec_get_full_path(path, plugin);
+
+    if (preload_handle != NULL)
+    {
+        if (!strcmp(path, preload_path))
+            return CODEC_OK; /* Already waiting */
+
+        codec_preload_discard();
+    }
+
+    preload_handle = lc_open(path, codecbuf, CODEC_SIZE);
+
+    if (preload_handle == NULL) {
+        logf("Codec: cannot preload file");
+        return CODEC_ERROR;
+    }
+
+    strlcpy(preload_path, path, sizeof (preload_path));
+    logf("Codec: preloaded %s", plugin);
+    return CODEC_OK;
+}
+
+void codec_preload_discard(void)
+{
+    if (preload_handle != NULL) {
+        lc_close(preload_handle);
+        preload_handle = NULL;
+    }
+}
+#endif /* PLATFORM_HOSTED */
+
 static int codec_load_ram(struct codec_api *api)
 {
     struct lc_header *hdr;
@@ -249,6 +302,18 @@ int codec_load_file(const char *plugin, struct codec_api *api)
 
     codec_get_full_path(path, plugin);
 
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+    if (preload_handle != NULL && !strcmp(path, preload_path)) {
+        logf("Codec: using preloaded %s", plugin);
+        curr_handle = preload_handle;
+        preload_handle = NULL;
+        return codec_load_ram(api);
+    }
+
+    /* A stale preload must not share a mapping with the one opened now */
+    codec_preload_discard();
+#endif
+
     curr_handle = lc_open(path, codecbuf, CODEC_SIZE);
 
     if (curr_handle == NULL) {
@@ -277,6 +342,7 @@ int codec_close(void)
     if (curr_handle != NULL) {
         logf("Codec: cleaning up");
         status = c_hdr->entry_point(CODEC_UNLOAD);
+        heap_release_owner(HEAP_OWNER_CODEC);
         lc_close(curr_handle);
         curr_handle = NULL;
     }
@@ -90,6 +90,7 @@
 #endif
 #include "logfdisp.h"
 #include "core_alloc.h"
+#include "heap.h"
 #if CONFIG_CODEC == SWCODEC
 #include "pcmbuf.h"
 #include "buffering.h"
@@ -187,6 +188,147 @@ static bool dbg_os(void)
     return simplelist_show_list(&info);
 }
 
+#ifdef HAVE_SDL_THREADS
+#include "thread-sdl.h"
+
+/* Share of each thread's lifetime spent running and queueing for the
+ * kernel lock */
+static const char* dbg_contention_getname(int selected_item, void *data,
+                                          char *buffer, size_t buffer_len)
+{
+    (void)data;
+    struct thread_debug_info threadinfo;
+    struct sim_lock_stats stats;
+
+    if (thread_get_debug_info(selected_item, &threadinfo) <= 0 ||
+        !sim_thread_get_lock_stats(selected_item, &stats))
+    {
+        snprintf(buffer, buffer_len, "%2d: ---", selected_item);
+        return buffer;
+    }
+
+    uint64_t elapsed = stats.elapsed_us ? stats.elapsed_us : 1;
+    snprintf(buffer, buffer_len,
+             "%2d: run %2d%% wait %2d%% max %lums %lu/%lu %s",
+             selected_item,
+             (int)(stats.hold_us * 100 / elapsed),
+             (int)(stats.wait_us * 100 / elapsed),
+             (unsigned long)(stats.max_wait_us / 1000),
+             stats.contended, stats.acquires, threadinfo.name);
+    return buffer;
+}
+
+static bool dbg_contention(void)
+{
+    struct simplelist_info info;
+    simplelist_info_init(&info, "Kernel lock contention", MAXTHREADS, NULL);
+    info.hide_selection = true;
+    info.scroll_all = true;
+    info.action_callback = dbg_threads_action_callback;
+    info.get_name = dbg_contention_getname;
+    return simplelist_show_list(&info);
+}
+#endif
+
+#ifdef HAVE_SCHED_TRACE
+#include "sched_trace.h"
+
+/* CPU share per thread over the last refresh interval */
+static struct
+{
+    long tick;                          /* when last refreshed */
+    uint64_t clock;
+    uint64_t run[MAXTHREADS + 1];       /* last is the idle core */
+    unsigned char pct[MAXTHREADS + 1];
+} sched_view;
+
+static void dbg_sched_refresh(void)
+{
+    uint64_t now = sched_trace_clock();
+    uint64_t elapsed = now - sched_view.clock;
+
+    for (unsigned int i = 0; i <= MAXTHREADS; i++)
+    {
+        uint64_t run = sched_trace_run_time(i < MAXTHREADS ? i :
+                                            SCHED_TRACE_IDLE);
+        sched_view.pct[i] = elapsed && run >= sched_view.run[i] ?
+                            (run - sched_view.run[i]) * 100 / elapsed : 0;
+        sched_view.run[i] = run;
+    }
+
+    sched_view.clock = now;
+    sched_view.tick = current_tick;
+}
+
+static int dbg_sched_action_callback(int action, struct gui_synclist *lists)
+{
+    (void)lists;
+    if (action == ACTION_NONE)
+    {
+        if (TIME_AFTER(current_tick, sched_view.tick + HZ))
+            dbg_sched_refresh();
+        action = ACTION_REDRAW;
+    }
+    return action;
+}
+
+static const char* dbg_sched_getname(int selected_item, void *data,
+                                     char *buffer, size_t buffer_len)
+{
+    (void)data;
+    struct thread_debug_info threadinfo;
+
+    if (selected_item == 0)
+    {
+        snprintf(buffer, buffer_len, "Events: %lu", sched_trace_count());
+        return buffer;
+    }
+    if (selected_item == 1)
+    {
+        snprintf(buffer, buffer_len, "Idle: %2d%%",
+                 sched_view.pct[MAXTHREADS]);
+        return buffer;
+    }
+
+    selected_item -= 2;
+    if (thread_get_debug_info(selected_item, &threadinfo) > 0)
+        snprintf(buffer, buffer_len, "%2d: %s %2d%% %s", selected_item,
+                 threadinfo.statusstr, sched_view.pct[selected_item],
+                 threadinfo.name);
+    else
+        snprintf(buffer, buffer_len, "%2d: ---", selected_item);
+    return buffer;
+}
+
+static bool dbg_sched_trace(void)
+{
+    struct simplelist_info info;
+
+    dbg_sched_refresh();
+    simplelist_info_init(&info, "CPU use per thread", MAXTHREADS + 2, NULL);
+    info.hide_selection = true;
+    info.scroll_all = true;
+    info.action_callback = dbg_sched_action_callback;
+    info.get_name = dbg_sched_getname;
+    return simplelist_show_list(&info);
+}
+
+static bool dbg_sched_trace_dump(void)
+{
+    int fd = creat("/sched_trace.txt", 0666);
+    if (fd < 0)
+    {
+        splash(HZ, "Can't create /sched_trace.txt");
+        return false;
+    }
+
+    int events = sched_trace_dump(fd);
+    close(fd);
+    splashf(HZ, "%d events dumped", events);
+    return false;
+}
+#endif
+
 #ifdef __linux__
 #include "cpuinfo-linux.h"
 
@@ -536,6 +678,59 @@ static bool dbg_buflib_allocs(void)
     return simplelist_show_list(&info);
 }
 
+#ifdef HAVE_CORE_ALLOC_TRACE
+static bool dbg_alloc_trace_dump(void)
+{
+    int fd = creat("/core_alloc_trace.txt", 0666);
+    if (fd < 0)
+    {
+        splash(HZ, "Can't create /core_alloc_trace.txt");
+        return false;
+    }
+
+    int events = core_alloc_trace_dump(fd);
+    close(fd);
+    if (core_alloc_trace_dropped())
+        splashf(HZ*2, "%d events dumped, %lu lost", events,
+                core_alloc_trace_dropped());
+    else
+        splashf(HZ, "%d events dumped", events);
+    return false;
+}
+#endif
+
+static bool dbg_heaps(void)
+{
+    struct simplelist_info info;
+    struct heap_stats stats;
+    bool any = false;
+
+    simplelist_info_init(&info, "Heaps", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    for (int i = 0; i < HEAP_MAX_CLIENTS; i++)
+    {
+        if (!heap_get_stats(i, &stats))
+            continue;
+
+        any = true;
+        simplelist_addline("%s%s: %lu KiB", stats.name,
+                           stats.active ? "" : " (gone)",
+                           (unsigned long)stats.size / 1024);
+        simplelist_addline(" Used: %lu KiB, peak %lu KiB",
+                           (unsigned long)stats.used / 1024,
+                           (unsigned long)stats.peak / 1024);
+        simplelist_addline(" Largest free: %lu KiB, frag %d%%",
+                           (unsigned long)stats.largest_free / 1024,
+                           heap_fragmentation(&stats));
+        simplelist_addline(" Allocs: %lu, failed %lu", stats.allocs,
+                           stats.failed);
+    }
+    if (!any)
+        simplelist_addline("No heaps yet");
+    return simplelist_show_list(&info);
+}
+
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
 static const char* dbg_partitions_getname(int selected_item, void *data,
                                           char *buffer, size_t buffer_len)
@@ -792,6 +987,21 @@ static bool dbg_cpufreq(void)
         lcd_putsf(0, line++, "Frequency: %ld.%ld MHz", temp, (FREQ-temp*1000000)/100000);
         lcd_putsf(0, line++, "boost_counter: %d", get_cpu_boost_counter());
 
+        const struct cpu_freq_stats *stats = cpu_freq_get_stats();
+        lcd_putsf(0, line++, "Demand: %ld MHz", stats->demand / 1000000);
+        lcd_putsf(0, line++, "Time: %lds %lds %lds",
+                  stats->level_ticks[0] / HZ, stats->level_ticks[1] / HZ,
+                  stats->level_ticks[2] / HZ);
+        lcd_putsf(0, line++, "Changes: %lu boosts: %lu",
+                  stats->changes, stats->boosts);
+        lcd_putsf(0, line++, "Underruns: %lu", pcmbuf_get_underruns());
+
+        const struct cpu_freq_decision *d;
+        for (int i = 0; i < 4 && (d = cpu_freq_get_decision(i)); i++)
+            lcd_putsf(0, line++, "%c %ld.%02lds %ld MHz d%ld b%d", d->reason,
+                      d->tick / HZ, d->tick % HZ, d->freq / 1000000,
+                      d->demand / 1000000, d->boosts);
+
 #ifdef HAVE_ADJUSTABLE_CPU_VOLTAGE
         extern int get_cpu_voltage_setting(void);
         temp = get_cpu_voltage_setting();
@@ -812,9 +1022,11 @@ static bool dbg_cpufreq(void)
                 break;
 
             case ACTION_STD_OK:
+                /* the last unboost lets the controller pick the level for
+                 * the current demand; setting the clock here would leave
+                 * it believing in the old one */
                 while (get_cpu_boost_counter() > 0)
                     cpu_boost(false);
-                set_cpu_frequency(CPUFREQ_DEFAULT);
                 break;
 
             case ACTION_STD_CANCEL:
@@ -2514,12 +2726,15 @@ static bool dbg_skin_engine(void)
             {
                 simplelist_addline("Skin ID: %d, %d allocations",
                         i, stats->buflib_handles);
-                simplelist_addline("\tskin: %d bytes",
-                        stats->tree_size);
+                simplelist_addline("\tskin: %d bytes%s",
+                        stats->tree_size, stats->cached ? " (cached)" : "");
                 simplelist_addline("\tImages: %d bytes",
                         stats->images_size);
                 simplelist_addline("\tTotal: %d bytes",
                         stats->tree_size + stats->images_size);
+                simplelist_addline("\tRefreshes: %lu, lines drawn: %lu/%lu",
+                        stats->refreshes, stats->lines_drawn,
+                        stats->lines_rendered);
                 total += stats->tree_size + stats->images_size;
             }
         }
@@ -2545,6 +2760,163 @@ static bool dbg_skin_engine(void)
 }
 #endif
 
+#ifdef HAVE_LCD_BITMAP
+static bool dbg_font_cache(void)
+{
+    struct simplelist_info info;
+    int i;
+
+    simplelist_info_init(&info, "Font cache", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    for (i = 0; i < MAXFONTS; i++)
+    {
+        const char *name = font_filename(i);
+        if (!name)
+            continue;
+        struct font *pf = font_get(i);
+        struct font_cache *cache = &pf->cache;
+        unsigned long lookups = cache->hits + cache->misses;
+
+        simplelist_addline("Font %d: %s", i, name);
+        if (pf->fd < 0 && !pf->disabled)
+        {
+            simplelist_addline("\tfully loaded");
+            continue;
+        }
+        simplelist_addline("\tglyphs: %d/%d", cache->_size, cache->_capacity);
+        simplelist_addline("\thits: %lu, misses: %lu", cache->hits,
+                           cache->misses);
+        if (lookups)
+            simplelist_addline("\thit rate: %d%%",
+                               (int)(cache->hits * 100ULL / lookups));
+    }
+    return simplelist_show_list(&info);
+}
+#endif
+
+#ifdef HAVE_LCD_DIRTY_RECT
+static bool dbg_lcd_updates(void)
+{
+    struct simplelist_info info;
+    const struct lcd_update_stats *stats = lcd_get_update_stats();
+    unsigned long long full = (unsigned long long)stats->updates *
+                              LCD_WIDTH * LCD_HEIGHT * sizeof(fb_data);
+
+    simplelist_info_init(&info, "LCD updates", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    simplelist_addline("Updates: %lu", stats->updates);
+    simplelist_addline("Rectangles: %lu", stats->rects);
+    simplelist_addline("Sent: %lu KiB", (unsigned long)(stats->bytes / 1024));
+    simplelist_addline("Full screen: %lu KiB", (unsigned long)(full / 1024));
+    if (full)
+        simplelist_addline("Saved: %d%%",
+                           (int)(100 - stats->bytes * 100 / full));
+    return simplelist_show_list(&info);
+}
+#endif
+
+#ifdef HAVE_LCD_FRAME_PACING
+static void dbg_frame_hist(const char *title, const unsigned long *hist)
+{
+    int i;
+
+    simplelist_addline("%s", title);
+    for (i = 0; i < LCD_FRAME_HIST_BUCKETS; i++)
+    {
+        if (!hist[i])
+            continue;
+        if (i == LCD_FRAME_HIST_BUCKETS - 1)
+            simplelist_addline(" >=%d ms: %lu", 1 << i, hist[i]);
+        else
+            simplelist_addline(" %d-%d ms: %lu", i ? 1 << i : 0,
+                               (2 << i) - 1, hist[i]);
+    }
+}
+
+static bool dbg_frame_pacing(void)
+{
+    struct simplelist_info info;
+    const struct lcd_frame_stats *stats = lcd_get_frame_stats();
+
+    simplelist_info_init(&info, "Frame pacing", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    if (stats->fps > 0)
+        simplelist_addline("Target: %d fps", stats->fps);
+    else
+        simplelist_addline("Target: unpaced");
+    simplelist_addline("Frames: %lu", stats->frames);
+    simplelist_addline("Updates: %lu", stats->requests);
+    simplelist_addline("Deferred: %lu", stats->deferred);
+    if (stats->frames)
+        simplelist_addline("Updates/frame: %lu.%02lu",
+                           stats->requests / stats->frames,
+                           stats->requests * 100 / stats->frames % 100);
+    dbg_frame_hist("Frame time:", stats->frame_time);
+    dbg_frame_hist("Latency:", stats->latency);
+    return simplelist_show_list(&info);
+}
+#endif
+
+#ifdef HAVE_TICKLESS_IDLE
+static bool dbg_tick_idle(void)
+{
+    struct simplelist_info info;
+    const struct tick_idle_stats *stats = tick_get_idle_stats();
+    long ticks = current_tick;
+
+    simplelist_info_init(&info, "Tickless idle", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    simplelist_addline("Ticks: %ld", ticks);
+    simplelist_addline("Stopped: %lu", stats->sleeps);
+    simplelist_addline("Woken early: %lu", stats->early);
+    if (ticks > 0)
+        simplelist_addline("Skipped: %lu (%d%%)", stats->skipped,
+                           (int)(stats->skipped * 100ULL / ticks));
+    simplelist_addline("Longest: %ld ms", stats->longest * 1000 / HZ);
+    simplelist_addline("Next task: %ld ticks", tick_next_due());
+    return simplelist_show_list(&info);
+}
+#endif
+
+#ifdef HAVE_REALTIME_AUDIO
+static bool dbg_rt_audio(void)
+{
+    static const char * const names[RT_NUM_THREADS] =
+    {
+        [RT_THREAD_KERNEL] = "Kernel",
+        [RT_THREAD_TICK]   = "Tick",
+        [RT_THREAD_PCM]    = "PCM",
+    };
+    struct simplelist_info info;
+    const struct rt_audio_stats *stats = rt_audio_get_stats();
+
+    simplelist_info_init(&info, "Realtime audio", 0, NULL);
+    simplelist_set_line_count(0);
+    info.hide_selection = true;
+    for (int i = 0; i < RT_NUM_THREADS; i++)
+    {
+        if (!stats->thread[i].policy)
+            simplelist_addline("%s: not started", names[i]);
+        else if (stats->thread[i].cpu >= 0)
+            simplelist_addline("%s: %s %d, CPU %d", names[i],
+                               stats->thread[i].policy,
+                               stats->thread[i].priority,
+                               stats->thread[i].cpu);
+        else
+            simplelist_addline("%s: %s %d", names[i],
+                               stats->thread[i].policy,
+                               stats->thread[i].priority);
+    }
+    simplelist_addline("Locked: %lu KiB", (unsigned long)stats->locked / 1024);
+    simplelist_addline("Xruns: %lu (%lu recovered)", stats->xruns,
+                       stats->recovered);
+    return simplelist_show_list(&info);
+}
+#endif
 
 /****** The menu *********/
 static const struct {
@@ -2582,6 +2954,19 @@ static const struct {
         { "Catch mem accesses", dbg_set_memory_guard },
 #endif
         { "View OS stacks", dbg_os },
+#ifdef HAVE_SDL_THREADS
+        { "View thread contention", dbg_contention },
+#endif
+#ifdef HAVE_SCHED_TRACE
+        { "View CPU use per thread", dbg_sched_trace },
+        { "Dump scheduler trace", dbg_sched_trace_dump },
+#endif
+#ifdef HAVE_TICKLESS_IDLE
+        { "View tickless idle", dbg_tick_idle },
+#endif
+#ifdef HAVE_REALTIME_AUDIO
+        { "View realtime audio", dbg_rt_audio },
+#endif
 #ifdef __linux__
         { "View CPU stats", dbg_cpuinfo },
 #endif
@@ -2593,6 +2978,13 @@ static const struct {
         { "Screendump", dbg_screendump },
 #endif
         { "Skin Engine RAM usage", dbg_skin_engine },
+        { "View font cache", dbg_font_cache },
+#endif
+#ifdef HAVE_LCD_DIRTY_RECT
+        { "View LCD updates", dbg_lcd_updates },
+#endif
+#ifdef HAVE_LCD_FRAME_PACING
+        { "View frame pacing", dbg_frame_pacing },
 #endif
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
         { "View HW info", dbg_hw_info },
@@ -2627,6 +3019,10 @@ static const struct {
 #endif /* PM_DEBUG */
 #endif /* HAVE_LCD_BITMAP */
         { "View buflib allocs", dbg_buflib_allocs },
+#ifdef HAVE_CORE_ALLOC_TRACE
+        { "Dump allocation trace", dbg_alloc_trace_dump },
+#endif
+        { "View heaps", dbg_heaps },
 #ifndef SIMULATOR
 #if CONFIG_TUNER
         { "FM Radio", dbg_fm_radio },
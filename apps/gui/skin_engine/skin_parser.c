@@ -77,6 +77,12 @@
 #include "backdrop.h"
 #include "statusbar-skinned.h"
 
+#if !defined(__PCTOOL__) && defined(HAVE_LCD_BITMAP)
+#define HAVE_SKIN_CACHE
+#include "crc32.h"
+#include "version.h"
+#endif
+
 #define WPS_ERROR_INVALID_PARAM         -1
 
 static char* skin_buffer = NULL;
@@ -123,6 +129,11 @@ static struct line *curr_line;
 
 static int follow_lang_direction = 0;
 
+#ifdef HAVE_SKIN_CACHE
+/* the skin claimed the list title from the statusbar */
+static bool skin_has_title;
+#endif
+
 typedef int (*parse_function)(struct skin_element *element,
                               struct wps_token *token,
                               struct wps_data *wps_data);
@@ -2280,6 +2291,9 @@ static int skin_element_callback(struct skin_element* element, void* data)
                 case SKIN_TOKEN_LIST_TITLE_TEXT:
 #ifndef __PCTOOL__
                     sb_skin_has_title(curr_screen);
+#endif
+#ifdef HAVE_SKIN_CACHE
+                    skin_has_title = true;
 #endif
                     break;
 #endif
@@ -2389,6 +2403,7 @@ static int skin_element_callback(struct skin_element* element, void* data)
         {
             curr_line = skin_buffer_alloc(sizeof(*curr_line));
             curr_line->update_mode = SKIN_REFRESH_STATIC;
+            curr_line->drawn_hash = 0;
             element->data = PTRTOSKINOFFSET(skin_buffer, curr_line);
         }
         break;
@@ -2423,6 +2438,433 @@ static int skin_element_callback(struct skin_element* element, void* data)
     return CALLBACK_OK;
 }
 
+#ifdef HAVE_SKIN_CACHE
+/* Skin cache
+ *
+ * Parsing a big skin takes a while, so the result is saved in SKIN_CACHE_DIR,
+ * named after the skin's path and screen, and read back in one go as long as
+ * the skin source and the state the parser depends on are unchanged. Theme
+ * directories are left alone, they may be read-only or shared. The skin
+ * buffer only uses offsets apart from a few real pointers (tag table entries,
+ * settings, image filenames), those are saved as relocations and fixed up
+ * after loading. Bitmaps and fonts are loaded as usual afterwards.
+ */
+#define SKIN_CACHE_MAGIC    0x534b4331 /* "SKC1" */
+#define SKIN_CACHE_DIR      ROCKBOX_DIR "/skincache"
+
+/* pointers outside the plugin buffer are saved relative to this */
+#define SKIN_CACHE_ANCHOR   ((intptr_t)skinfonts)
+
+enum skin_cache_ptr_type {
+    SKIN_CACHE_NULL = 0,
+    SKIN_CACHE_BUFFER,      /* offset into the skin buffer */
+    SKIN_CACHE_STATIC,      /* offset from SKIN_CACHE_ANCHOR */
+    SKIN_CACHE_WPS_DATA,    /* the wps_data being loaded */
+};
+
+struct skin_cache_ptr {
+    uint32_t slot;          /* offset of the pointer in the skin buffer */
+    int32_t type;
+    int32_t value;
+};
+
+struct skin_cache_header {
+    uint32_t magic;
+    uint32_t build;         /* build and structure layout */
+    uint32_t env;           /* state the parser looks at */
+    uint32_t source_crc;
+    uint32_t source_size;
+    uint32_t buffer_size;   /* bytes of skin buffer following the header */
+    uint32_t reloc_count;   /* relocations following the skin buffer */
+    uint32_t data_crc;      /* of the skin buffer and relocations */
+    /* what the parser left outside the skin buffer */
+    skinoffset_t tree;
+    skinoffset_t images;
+    skinoffset_t touchregions;
+    skinoffset_t albumart;
+    skinoffset_t skinvars;
+    bool use_extra_framebuffer;
+    bool wps_sb_tag;
+    bool show_sb_on_wps;
+    bool has_title;
+    struct skin_cache_ptr backdrop;
+    struct skin_cache_ptr font_names[MAXUSERFONTS];
+    int font_glyphs[MAXUSERFONTS];
+};
+
+struct skin_cache_save {
+    const char *text;       /* start of the plugin buffer */
+    struct wps_data *data;
+    struct skin_cache_ptr *relocs;
+    int count;
+    int max;
+    bool ok;
+};
+
+typedef void (*skin_cache_walk_fn)(struct skin_element *element, void *data);
+
+static void skin_cache_walk(struct skin_element *element,
+                            skin_cache_walk_fn fn, void *data)
+{
+    int i;
+    while (element)
+    {
+        struct skin_tag_parameter *params =
+                SKINOFFSETTOPTR(skin_buffer, element->params);
+        skinoffset_t *children =
+                SKINOFFSETTOPTR(skin_buffer, element->children);
+
+        fn(element, data);
+        for (i = 0; i < element->params_count; i++)
+        {
+            if (params[i].type == CODE)
+                skin_cache_walk(SKINOFFSETTOPTR(skin_buffer,
+                                params[i].data.code), fn, data);
+        }
+        for (i = 0; i < element->children_count; i++)
+            skin_cache_walk(SKINOFFSETTOPTR(skin_buffer, children[i]),
+                            fn, data);
+        element = SKINOFFSETTOPTR(skin_buffer, element->next);
+    }
+}
+
+static uint32_t skin_cache_build_id(void)
+{
+    /* the static offsets change with the code layout, rbversion alone
+     * doesn't for modified builds */
+    const intptr_t layout[] = {
+        LCD_WIDTH, LCD_HEIGHT, LCD_DEPTH,
+        sizeof(struct skin_element), sizeof(struct skin_tag_parameter),
+        sizeof(struct wps_token), sizeof(struct skin_viewport),
+        sizeof(struct gui_img), sizeof(struct skin_cache_header),
+        (intptr_t)find_tag("V") - SKIN_CACHE_ANCHOR,
+        (intptr_t)settings - SKIN_CACHE_ANCHOR,
+        (intptr_t)skin_data_load - SKIN_CACHE_ANCHOR,
+    };
+    uint32_t crc = crc_32(layout, sizeof(layout), 0xffffffff);
+    return crc_32(rbversion, strlen(rbversion), crc);
+}
+
+static uint32_t skin_cache_env(enum screen_type screen)
+{
+    struct viewport vps[2];
+    /* viewports only carry FONT_UI, but its height goes into the parsed
+     * data (progress bars, line heights), so the font itself is part of it.
+     * Skin fonts are named in the source and measured at display time. */
+    int uifont = screens[screen].getuifont();
+    const struct font *pf = font_get(uifont);
+    const char *fontname = font_filename(uifont);
+    const int state[] = {
+        screen, lang_is_rtl(), global_settings.glyphs_to_cache,
+        pf->height, pf->maxwidth,
+#ifdef HAVE_LCD_COLOR
+        global_settings.lss_color, global_settings.lse_color,
+        global_settings.lst_color,
+#endif
+#if CONFIG_TUNER
+        radio_hardware_present(),
+#endif
+    };
+    /* these depend on the statusbar settings and the loaded sbs */
+    viewport_set_defaults(&vps[0], screen);
+    viewport_set_fullscreen(&vps[1], screen);
+    uint32_t crc = crc_32(vps, sizeof(vps), 0xffffffff);
+    if (fontname)
+        crc = crc_32(fontname, strlen(fontname), crc);
+    return crc_32(state, sizeof(state), crc);
+}
+
+static void skin_cache_init(struct skin_cache_header *header,
+                            enum screen_type screen,
+                            const char *source, size_t size)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = SKIN_CACHE_MAGIC;
+    header->build = skin_cache_build_id();
+    header->env = skin_cache_env(screen);
+    header->source_crc = crc_32(source, size, 0xffffffff);
+    header->source_size = size;
+}
+
+static void skin_cache_encode(struct skin_cache_save *s, const void *ptr,
+                              struct skin_cache_ptr *out)
+{
+    const char *p = ptr;
+    const char *end = skin_buffer + skin_buffer_usage();
+
+    out->type = SKIN_CACHE_NULL;
+    out->value = 0;
+    if (!p)
+        return;
+    if (p == (const char *)s->data)
+        out->type = SKIN_CACHE_WPS_DATA;
+    else if (p >= skin_buffer && p < end)
+    {
+        out->type = SKIN_CACHE_BUFFER;
+        out->value = p - skin_buffer;
+    }
+    else if (p >= s->text && p < end + skin_buffer_freespace())
+    {
+        /* the source text or scratch space, gone after loading */
+        s->ok = false;
+    }
+    else
+    {
+        intptr_t delta = (intptr_t)p - SKIN_CACHE_ANCHOR;
+        out->type = SKIN_CACHE_STATIC;
+        out->value = delta;
+        if (out->value != delta)
+            s->ok = false;
+    }
+}
+
+static void skin_cache_add_reloc(struct skin_cache_save *s, void *slot)
+{
+    void *ptr;
+    memcpy(&ptr, slot, sizeof(ptr));
+    if (!ptr)
+        return;
+    if (s->count >= s->max)
+    {
+        s->ok = false;
+        return;
+    }
+    struct skin_cache_ptr *reloc = &s->relocs[s->count++];
+    skin_cache_encode(s, ptr, reloc);
+    reloc->slot = (char *)slot - skin_buffer;
+}
+
+static void skin_cache_save_element(struct skin_element *element, void *data)
+{
+    struct skin_cache_save *s = data;
+    skin_cache_add_reloc(s, &element->tag);
+    if (element->type == TAG)
+    {
+        struct wps_token *token = SKINOFFSETTOPTR(skin_buffer, element->data);
+        if (token && token->type == SKIN_TOKEN_LIST_ITEM_CFG)
+        {
+            struct listitem_viewport_cfg *cfg =
+                    SKINOFFSETTOPTR(skin_buffer, token->value.data);
+            if (cfg)
+                skin_cache_add_reloc(s, &cfg->data);
+        }
+    }
+}
+
+/* Save the freshly parsed skin, before bitmaps and fonts are loaded */
+static void skin_cache_save(const char *path, struct skin_cache_header *header,
+                            struct wps_data *wps_data, const char *text)
+{
+    struct skin_cache_save s;
+    struct skin_token_list *list;
+    size_t usage = skin_buffer_usage();
+    int i, fd;
+
+    /* collect the relocations in the free space after the skin */
+    s.text = text;
+    s.data = wps_data;
+    s.relocs = (struct skin_cache_ptr *)(skin_buffer + usage);
+    s.count = 0;
+    s.max = skin_buffer_freespace() / sizeof(*s.relocs);
+    s.ok = true;
+
+    skin_cache_walk(SKINOFFSETTOPTR(skin_buffer, wps_data->tree),
+                    skin_cache_save_element, &s);
+    list = SKINOFFSETTOPTR(skin_buffer, wps_data->images);
+    while (list)
+    {
+        struct wps_token *token = SKINOFFSETTOPTR(skin_buffer, list->token);
+        struct gui_img *img = SKINOFFSETTOPTR(skin_buffer, token->value.data);
+        skin_cache_add_reloc(&s, &img->bm.data);
+        list = SKINOFFSETTOPTR(skin_buffer, list->next);
+    }
+#ifdef HAVE_TOUCHSCREEN
+    list = SKINOFFSETTOPTR(skin_buffer, wps_data->touchregions);
+    while (list)
+    {
+        struct wps_token *token = SKINOFFSETTOPTR(skin_buffer, list->token);
+        struct touchregion *r = SKINOFFSETTOPTR(skin_buffer, token->value.data);
+        if (r->action == ACTION_SETTINGS_INC ||
+            r->action == ACTION_SETTINGS_DEC ||
+            r->action == ACTION_SETTINGS_SET)
+            skin_cache_add_reloc(&s, &r->setting_data.setting);
+        list = SKINOFFSETTOPTR(skin_buffer, list->next);
+    }
+    header->touchregions = wps_data->touchregions;
+#else
+    header->touchregions = INVALID_OFFSET;
+#endif
+
+    header->buffer_size = usage;
+    header->reloc_count = s.count;
+    header->tree = wps_data->tree;
+    header->images = wps_data->images;
+#ifdef HAVE_ALBUMART
+    header->albumart = wps_data->albumart;
+#else
+    header->albumart = INVALID_OFFSET;
+#endif
+#ifdef HAVE_SKIN_VARIABLES
+    header->skinvars = wps_data->skinvars;
+#else
+    header->skinvars = INVALID_OFFSET;
+#endif
+#ifdef HAVE_BACKDROP_IMAGE
+    header->use_extra_framebuffer = wps_data->use_extra_framebuffer;
+#endif
+    header->wps_sb_tag = wps_data->wps_sb_tag;
+    header->show_sb_on_wps = wps_data->show_sb_on_wps;
+    header->has_title = skin_has_title;
+#if (LCD_DEPTH > 1) || (defined(HAVE_REMOTE_LCD) && (LCD_REMOTE_DEPTH > 1))
+    skin_cache_encode(&s, backdrop_filename, &header->backdrop);
+#endif
+    for (i = 0; i < MAXUSERFONTS; i++)
+    {
+        skin_cache_encode(&s, skinfonts[i].name, &header->font_names[i]);
+        header->font_glyphs[i] = skinfonts[i].glyphs;
+    }
+
+    if (!s.ok)
+    {
+        DEBUGF("skin cache: can't save %s\n", path);
+        remove(path);
+        return;
+    }
+
+    if (!dir_exists(SKIN_CACHE_DIR) && mkdir(SKIN_CACHE_DIR) < 0)
+        return;
+
+    fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd < 0)
+        return;
+    ssize_t size = usage + s.count * sizeof(*s.relocs);
+    header->data_crc = crc_32(skin_buffer, size, 0xffffffff);
+    bool ok = write(fd, header, sizeof(*header)) == sizeof(*header) &&
+              write(fd, skin_buffer, size) == size;
+    close(fd);
+    if (!ok)
+        remove(path);
+}
+
+static void *skin_cache_decode(const struct skin_cache_ptr *p,
+                               struct wps_data *wps_data)
+{
+    switch (p->type)
+    {
+        case SKIN_CACHE_BUFFER:
+            return skin_buffer + p->value;
+        case SKIN_CACHE_STATIC:
+            return (void *)(SKIN_CACHE_ANCHOR + p->value);
+        case SKIN_CACHE_WPS_DATA:
+            return wps_data;
+        default:
+            return NULL;
+    }
+}
+
+static void skin_cache_load_element(struct skin_element *element, void *data)
+{
+    (void)data;
+    if (element->type == LINE_ALTERNATOR)
+    {
+        struct line_alternator *alternator =
+                SKINOFFSETTOPTR(skin_buffer, element->data);
+        alternator->next_change_tick = current_tick;
+    }
+}
+
+/* Fill the skin buffer from the cache if it matches the wanted header,
+ * and redo what the parser would have done outside of it */
+static bool skin_cache_load(const char *path,
+                            const struct skin_cache_header *want,
+                            struct wps_data *wps_data)
+{
+    struct skin_cache_header header;
+    struct skin_cache_ptr *relocs;
+    size_t max = skin_buffer_freespace();
+    ssize_t size = 0;
+    unsigned i;
+    bool ok;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return false;
+    ok = read(fd, &header, sizeof(header)) == sizeof(header) &&
+         header.magic == want->magic && header.build == want->build &&
+         header.env == want->env && header.source_crc == want->source_crc &&
+         header.source_size == want->source_size &&
+         header.buffer_size >= sizeof(void *) && header.buffer_size <= max &&
+         header.reloc_count <= (max - header.buffer_size) / sizeof(*relocs);
+    if (ok)
+    {
+        size = header.buffer_size + header.reloc_count * sizeof(*relocs);
+        ok = read(fd, skin_buffer, size) == size &&
+             crc_32(skin_buffer, size, 0xffffffff) == header.data_crc;
+    }
+    close(fd);
+    if (!ok)
+        return false;
+
+    relocs = (struct skin_cache_ptr *)(skin_buffer + header.buffer_size);
+    for (i = 0; i < header.reloc_count; i++)
+    {
+        void *ptr = skin_cache_decode(&relocs[i], wps_data);
+        if (relocs[i].slot > header.buffer_size - sizeof(ptr))
+            return false;
+        memcpy(skin_buffer + relocs[i].slot, &ptr, sizeof(ptr));
+    }
+    skin_buffer_alloc(header.buffer_size);
+
+    wps_data->tree = header.tree;
+    wps_data->images = header.images;
+#ifdef HAVE_TOUCHSCREEN
+    wps_data->touchregions = header.touchregions;
+    struct skin_token_list *list =
+            SKINOFFSETTOPTR(skin_buffer, wps_data->touchregions);
+    while (list)
+    {
+        struct wps_token *token = SKINOFFSETTOPTR(skin_buffer, list->token);
+        struct touchregion *r = SKINOFFSETTOPTR(skin_buffer, token->value.data);
+        if (r->action == ACTION_TOUCH_VOLUME)
+            r->value = global_settings.volume;
+        list = SKINOFFSETTOPTR(skin_buffer, list->next);
+    }
+#endif
+#ifdef HAVE_SKIN_VARIABLES
+    wps_data->skinvars = header.skinvars;
+#endif
+#ifdef HAVE_BACKDROP_IMAGE
+    wps_data->use_extra_framebuffer = header.use_extra_framebuffer;
+#endif
+    wps_data->wps_sb_tag = header.wps_sb_tag;
+    wps_data->show_sb_on_wps = header.show_sb_on_wps;
+#if (LCD_DEPTH > 1) || (defined(HAVE_REMOTE_LCD) && (LCD_REMOTE_DEPTH > 1))
+    backdrop_filename = skin_cache_decode(&header.backdrop, wps_data);
+#endif
+    for (i = 0; i < MAXUSERFONTS; i++)
+    {
+        skinfonts[i].name = skin_cache_decode(&header.font_names[i], wps_data);
+        skinfonts[i].glyphs = header.font_glyphs[i];
+    }
+    if (header.has_title)
+        sb_skin_has_title(curr_screen);
+#ifdef HAVE_ALBUMART
+    wps_data->albumart = header.albumart;
+    struct skin_albumart *aa = SKINOFFSETTOPTR(skin_buffer, wps_data->albumart);
+    if (aa)
+    {
+        struct dim dimensions = { .width = aa->width, .height = aa->height };
+        int albumart_slot = playback_claim_aa_slot(&dimensions);
+        if (0 <= albumart_slot)
+            wps_data->playback_aa_slot = albumart_slot;
+    }
+#endif
+    skin_cache_walk(SKINOFFSETTOPTR(skin_buffer, wps_data->tree),
+                    skin_cache_load_element, NULL);
+    return true;
+}
+#endif /* HAVE_SKIN_CACHE */
+
 /* to setup up the wps-data from a format-buffer (isfile = false)
    from a (wps-)file (isfile = true)*/
 bool skin_data_load(enum screen_type screen, struct wps_data *wps_data,
@@ -2439,6 +2881,12 @@ bool skin_data_load(enum screen_type screen, struct wps_data *wps_data,
         skinfonts[i].name = NULL;
     }
 #endif
+#ifdef HAVE_SKIN_CACHE
+    struct skin_cache_header cache;
+    char cache_path[MAX_PATH];
+    bool cached = false;
+    skin_has_title = false;
+#endif
 #ifdef DEBUG_SKIN_ENGINE
     if (isfile && debug_wps)
     {
@@ -2485,6 +2933,11 @@ bool skin_data_load(enum screen_type screen, struct wps_data *wps_data,
         if (start <= 0)
             return false;
         start++;
+#ifdef HAVE_SKIN_CACHE
+        skin_cache_init(&cache, screen, wps_buffer, start);
+        snprintf(cache_path, sizeof(cache_path), SKIN_CACHE_DIR "/%08lx.%d",
+                 (unsigned long)crc_32(buf, strlen(buf), 0xffffffff), screen);
+#endif
         skin_buffer = &wps_buffer[start];
         buffersize -= start;
     }
@@ -2499,10 +2952,17 @@ bool skin_data_load(enum screen_type screen, struct wps_data *wps_data,
     backdrop_filename = "-";
     wps_data->backdrop_id = -1;
 #endif
-    /* parse the skin source */
+    /* parse the skin source, or take it from the cache */
     skin_buffer_init(skin_buffer, buffersize);
-    struct skin_element *tree = skin_parse(wps_buffer, skin_element_callback, wps_data);
-    wps_data->tree = PTRTOSKINOFFSET(skin_buffer, tree);
+#ifdef HAVE_SKIN_CACHE
+    if (isfile)
+        cached = skin_cache_load(cache_path, &cache, wps_data);
+    if (!cached)
+#endif
+    {
+        struct skin_element *tree = skin_parse(wps_buffer, skin_element_callback, wps_data);
+        wps_data->tree = PTRTOSKINOFFSET(skin_buffer, tree);
+    }
     if (!SKINOFFSETTOPTR(skin_buffer, wps_data->tree)) {
 #ifdef DEBUG_SKIN_ENGINE
         if (isfile && debug_wps)
@@ -2511,6 +2971,11 @@ bool skin_data_load(enum screen_type screen, struct wps_data *wps_data,
         skin_data_reset(wps_data);
         return false;
     }
+#ifdef HAVE_SKIN_CACHE
+    if (isfile && !cached)
+        skin_cache_save(cache_path, &cache, wps_data, wps_buffer);
+    stats->cached = cached;
+#endif
 
 #ifdef HAVE_LCD_BITMAP
     char bmpdir[MAX_PATH];
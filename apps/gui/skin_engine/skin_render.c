@@ -67,6 +67,7 @@ struct skin_draw_info {
     bool line_scrolls;
     bool force_redraw;
     bool viewport_change;
+    bool images_cleared; /* lines from here on may have been overdrawn */
     
     char *buf;
     size_t buf_size;
@@ -85,6 +86,8 @@ static void skin_render_playlistviewer(struct playlistviewer* viewer,
 #endif
 
 static char* skin_buffer;
+/* where the current skin_render() call counts its cost, may be NULL */
+static struct skin_stats *render_stats;
 
 static inline struct skin_element*
 get_child(OFFSETTYPE(struct skin_element**) children, int child)
@@ -284,6 +287,7 @@ static bool do_non_text_tags(struct gui_wps *gwps, struct skin_draw_info *info,
 
                     /* Clear the image, as in conditionals */
                     clear_image_pos(gwps, img);
+                    info->images_cleared = true;
 
                     /* If the token returned a value which is higher than
                      * the amount of subimages, don't draw it. */
@@ -410,6 +414,7 @@ static void do_tags_in_hidden_conditional(struct skin_element* branch,
                 struct gui_img *img = skin_find_item(SKINOFFSETTOPTR(skin_buffer, id->label), 
                                                      SKIN_FIND_IMAGE, data);
                 clear_image_pos(gwps, img);
+                info->images_cleared = true;
             }
             else if (token->type == SKIN_TOKEN_PEAKMETER)
             {
@@ -470,6 +475,7 @@ static void do_tags_in_hidden_conditional(struct skin_element* branch,
             {
                 draw_album_art(gwps,
                         playback_current_aa_hid(data->playback_aa_slot), true);
+                info->images_cleared = true;
             }
 #endif
             child = SKINOFFSETTOPTR(skin_buffer, child->next);
@@ -719,6 +725,66 @@ bool skin_render_alternator(struct skin_element* element, struct skin_draw_info
     return changed_lines || ret;
 }
 
+/* The line a LINE or LINE_ALTERNATOR element is currently showing */
+static struct line *get_drawn_line(struct skin_element *line)
+{
+    if (line->type == LINE_ALTERNATOR)
+    {
+        struct line_alternator *alternator = SKINOFFSETTOPTR(skin_buffer, line->data);
+        line = get_child(line->children, alternator->current_line);
+    }
+    return SKINOFFSETTOPTR(skin_buffer, line->data);
+}
+
+static inline unsigned hash_add(unsigned hash, unsigned value)
+{
+    return (hash ^ value) * 16777619; /* FNV-1a */
+}
+
+/* Hash everything write_line() uses to draw a line. Lines where this didn't
+ * change since they were last drawn are left alone on partial refreshes,
+ * most tags re-evaluate to the same text most of the time. */
+static unsigned get_line_hash(struct skin_draw_info *info)
+{
+    const char *align[3] = {
+        info->align.left, info->align.center, info->align.right
+    };
+    struct line_desc *linedes = &info->line_desc;
+    struct viewport *vp = &info->skin_vp->vp;
+    unsigned hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        const unsigned char *s = (const unsigned char *)align[i];
+        if (s)
+        {
+            while (*s)
+                hash = hash_add(hash, *s++);
+        }
+        hash = hash_add(hash, s ? 0x100 + i : 0x200 + i);
+    }
+    hash = hash_add(hash, info->line_number);
+    hash = hash_add(hash, info->line_scrolls);
+    hash = hash_add(hash, linedes->height);
+    hash = hash_add(hash, (linedes->nlines << 16) | (uint16_t)linedes->line);
+    hash = hash_add(hash, linedes->style);
+    hash = hash_add(hash, linedes->separator_height);
+#ifdef HAVE_LCD_COLOR
+    hash = hash_add(hash, linedes->text_color);
+    hash = hash_add(hash, linedes->line_color);
+    hash = hash_add(hash, linedes->line_end_color);
+#endif
+#ifdef HAVE_LCD_BITMAP
+    hash = hash_add(hash, vp->fg_pattern);
+    hash = hash_add(hash, vp->bg_pattern);
+    hash = hash_add(hash, vp->font);
+#else
+    (void)vp;
+#endif
+    return hash;
+}
+
 void skin_render_viewport(struct skin_element* viewport, struct gui_wps *gwps,
                         struct skin_viewport* skin_viewport, unsigned long refresh_type)
 {
@@ -788,6 +854,8 @@ void skin_render_viewport(struct skin_element* viewport, struct gui_wps *gwps,
             func = skin_render_line;
 
         needs_update = func(line, &info);
+        if (render_stats)
+            render_stats->lines_rendered++;
 #if (LCD_DEPTH > 1) || (defined(HAVE_REMOTE_LCD) && (LCD_REMOTE_DEPTH > 1))
         if (skin_viewport->fgbg_changed)
         {
@@ -804,12 +872,23 @@ void skin_render_viewport(struct skin_element* viewport, struct gui_wps *gwps,
         /* only update if the line needs to be, and there is something to write */
         if (refresh_type && (needs_update || update_all))
         {
-            if (info.force_redraw)
-                display->scroll_stop_viewport_rect(&skin_viewport->vp,
-                    0, info.line_number*display->getcharheight(),
-                    skin_viewport->vp.width, display->getcharheight());
-            write_line(display, align, info.line_number,
-                    info.line_scrolls, &info.line_desc);
+            struct line *drawn = get_drawn_line(line);
+            unsigned hash = get_line_hash(&info);
+            /* ...and it looks different from what is already there */
+            if (info.force_redraw || update_all || info.images_cleared ||
+                hash != drawn->drawn_hash ||
+                (refresh_type&SKIN_REFRESH_ALL) == SKIN_REFRESH_ALL)
+            {
+                if (info.force_redraw)
+                    display->scroll_stop_viewport_rect(&skin_viewport->vp,
+                        0, info.line_number*display->getcharheight(),
+                        skin_viewport->vp.width, display->getcharheight());
+                write_line(display, align, info.line_number,
+                        info.line_scrolls, &info.line_desc);
+                drawn->drawn_hash = hash;
+                if (render_stats)
+                    render_stats->lines_drawn++;
+            }
         }
         if (!info.no_line_break)
             info.line_number++;
@@ -820,7 +899,8 @@ void skin_render_viewport(struct skin_element* viewport, struct gui_wps *gwps,
 #endif
 }
 
-void skin_render(struct gui_wps *gwps, unsigned refresh_mode)
+void skin_render(struct gui_wps *gwps, unsigned refresh_mode,
+                 struct skin_stats *stats)
 {
     struct wps_data *data = gwps->data;
     struct screen *display = gwps->display;
@@ -831,6 +911,9 @@ void skin_render(struct gui_wps *gwps, unsigned refresh_mode)
     
     int old_refresh_mode = refresh_mode;
     skin_buffer = get_skin_buffer(gwps->data);
+    render_stats = stats;
+    if (stats)
+        stats->refreshes++;
     
 #ifdef HAVE_LCD_CHARCELLS
     int i;
@@ -913,6 +996,7 @@ void skin_render(struct gui_wps *gwps, unsigned refresh_mode)
     /* Restore the default viewport */
     display->set_viewport(NULL);
     display->update();
+    render_stats = NULL;
 }
 
 #ifdef HAVE_LCD_BITMAP
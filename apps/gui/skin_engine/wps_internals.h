@@ -35,6 +35,11 @@ struct skin_stats {
     size_t buflib_handles;
     size_t tree_size;
     size_t images_size;
+    bool cached; /* loaded from the skin cache instead of parsed */
+    /* rendering cost since the skin was loaded */
+    unsigned long refreshes;
+    unsigned long lines_rendered; /* lines whose tags were evaluated */
+    unsigned long lines_drawn;    /* lines which were (re)drawn */
 };
 
 int skin_get_num_skins(void);
@@ -280,6 +285,7 @@ struct skin_albumart {
 
 struct line {
     unsigned update_mode;
+    unsigned drawn_hash; /* what was last drawn, see skin_render_viewport() */
 };
 
 struct line_alternator {
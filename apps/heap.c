@@ -0,0 +1,224 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "system.h"
+#include "strlcpy.h"
+#include "debug.h"
+#include "tlsf.h"
+#include "heap.h"
+
+/* TLSF hands out blocks aligned to two pointers when the pool is */
+#define HEAP_ALIGN  (2*sizeof(void *))
+
+static struct heap
+{
+    void *pool;                 /* NULL when the slot holds no live heap */
+    enum heap_owner owner;
+    struct heap_stats stats;    /* kept after heap_destroy() */
+} heaps[HEAP_MAX_CLIENTS];
+
+static struct heap * get_heap(int heap)
+{
+    if (heap < 0 || heap >= HEAP_MAX_CLIENTS || !heaps[heap].pool)
+        return NULL;
+
+    return &heaps[heap];
+}
+
+/* Take the current figures out of the pool */
+static void update_stats(struct heap *h)
+{
+    size_t max = get_max_size(h->pool);
+
+    h->stats.used = get_used_size(h->pool);
+    h->stats.free = h->stats.size - h->stats.used;
+    h->stats.largest_free = get_largest_free(h->pool);
+
+    if (max > h->stats.peak)
+        h->stats.peak = max;
+}
+
+/* Reuse the figures of a previous heap by the same name, then a slot
+ * nobody had yet, then whatever isn't live */
+static int find_slot(const char *name)
+{
+    int unused = -1, inactive = -1;
+
+    for (int i = 0; i < HEAP_MAX_CLIENTS; i++)
+    {
+        struct heap *h = &heaps[i];
+
+        if (h->pool)
+            continue;
+
+        if (h->stats.name[0] == '\0')
+        {
+            if (unused < 0)
+                unused = i;
+        }
+        else if (!strcmp(h->stats.name, name))
+        {
+            return i;
+        }
+        else if (inactive < 0)
+        {
+            inactive = i;
+        }
+    }
+
+    return unused >= 0 ? unused : inactive;
+}
+
+int heap_create(const char *name, void *buf, size_t size,
+                enum heap_owner owner)
+{
+    int heap = find_slot(name);
+    if (heap < 0)
+    {
+        DEBUGF("heap_create(%s): no free slot\n", name);
+        return -1;
+    }
+
+    ALIGN_BUFFER(buf, size, HEAP_ALIGN);
+
+    /* a pool left in this buffer by an earlier client would otherwise
+     * be picked up again as it was */
+    destroy_memory_pool(buf);
+    if (init_memory_pool(size, buf) == (size_t)-1)
+        return -1;
+
+    struct heap *h = &heaps[heap];
+
+    if (strcmp(h->stats.name, name))
+    {
+        memset(&h->stats, 0, sizeof (h->stats));
+        strlcpy(h->stats.name, name, HEAP_NAME_LEN);
+    }
+
+    h->pool = buf;
+    h->owner = owner;
+    h->stats.active = true;
+    h->stats.size = size;
+    update_stats(h);
+
+    return heap;
+}
+
+void heap_destroy(int heap)
+{
+    struct heap *h = get_heap(heap);
+    if (!h)
+        return;
+
+    update_stats(h);
+    h->stats.active = false;
+
+    destroy_memory_pool(h->pool);
+    h->pool = NULL;
+}
+
+void heap_release_owner(enum heap_owner owner)
+{
+    for (int i = 0; i < HEAP_MAX_CLIENTS; i++)
+    {
+        if (heaps[i].pool && heaps[i].owner == owner)
+        {
+            DEBUGF("heap %s not destroyed by its owner\n",
+                   heaps[i].stats.name);
+            heap_destroy(i);
+        }
+    }
+}
+
+static void * count_alloc(struct heap *h, void *ptr)
+{
+    if (ptr)
+        h->stats.allocs++;
+    else
+        h->stats.failed++;
+
+    return ptr;
+}
+
+void * heap_malloc(int heap, size_t size)
+{
+    struct heap *h = get_heap(heap);
+    if (!h)
+        return NULL;
+
+    return count_alloc(h, malloc_ex(size, h->pool));
+}
+
+void * heap_calloc(int heap, size_t nmemb, size_t size)
+{
+    struct heap *h = get_heap(heap);
+    if (!h)
+        return NULL;
+
+    return count_alloc(h, calloc_ex(nmemb, size, h->pool));
+}
+
+void * heap_realloc(int heap, void *ptr, size_t size)
+{
+    struct heap *h = get_heap(heap);
+    if (!h)
+        return NULL;
+
+    /* realloc_ex() frees and returns NULL for size 0, which isn't a
+     * failure */
+    void *p = realloc_ex(ptr, size, h->pool);
+    if (size == 0)
+        return p;
+
+    return count_alloc(h, p);
+}
+
+void heap_free(int heap, void *ptr)
+{
+    struct heap *h = get_heap(heap);
+    if (h && ptr)
+        free_ex(ptr, h->pool);
+}
+
+int heap_fragmentation(const struct heap_stats *stats)
+{
+    if (stats->free == 0 || stats->largest_free >= stats->free)
+        return 0;
+
+    return (stats->free - stats->largest_free) * 100 / stats->free;
+}
+
+bool heap_get_stats(int heap, struct heap_stats *stats)
+{
+    if (heap < 0 || heap >= HEAP_MAX_CLIENTS)
+        return false;
+
+    struct heap *h = &heaps[heap];
+    if (h->stats.name[0] == '\0')
+        return false;
+
+    if (h->pool)
+        update_stats(h);
+
+    *stats = h->stats;
+    return true;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* General purpose heaps for plugins and codecs.
+ *
+ * A client hands in memory it already owns (plugin_get_buffer(),
+ * codec_get_buffer(), ...) and gets malloc/free on it, managed by TLSF.
+ * Heaps are referred to by a small id. Every heap keeps its statistics by
+ * name, across destruction and the next heap of the same name, so the peak
+ * shows how much of its buffer a client really needed.
+ *
+ * Heaps are created and destroyed by threads on the main core only. */
+
+#define HEAP_MAX_CLIENTS 4
+#define HEAP_NAME_LEN    16
+
+enum heap_owner
+{
+    HEAP_OWNER_PLUGIN = 0,  /* released when the plugin exits */
+    HEAP_OWNER_CODEC,       /* released when the codec is closed */
+};
+
+struct heap_stats
+{
+    char name[HEAP_NAME_LEN];
+    bool active;            /* false: the figures a destroyed heap left */
+    size_t size;            /* of the buffer, TLSF's own data included */
+    size_t used;            /* allocated, block headers included */
+    size_t peak;            /* highest 'used' for this name */
+    size_t free;
+    size_t largest_free;    /* biggest single free block */
+    unsigned long allocs;
+    unsigned long failed;
+};
+
+/* Returns the heap id, or -1 if the buffer is too small or all slots are
+ * taken by live heaps */
+int heap_create(const char *name, void *buf, size_t size,
+                enum heap_owner owner);
+void heap_destroy(int heap);
+/* destroys what a plugin or codec left behind */
+void heap_release_owner(enum heap_owner owner);
+
+void * heap_malloc(int heap, size_t size);
+void * heap_calloc(int heap, size_t nmemb, size_t size);
+void * heap_realloc(int heap, void *ptr, size_t size);
+void heap_free(int heap, void *ptr);
+
+/* 0-100, how much of the free space is not in the largest free block */
+int heap_fragmentation(const struct heap_stats *stats);
+/* false for an unused slot; 'heap' may be any id below HEAP_MAX_CLIENTS */
+bool heap_get_stats(int heap, struct heap_stats *stats);
+
+#endif /* _HEAP_H_ */
@@ -42,6 +42,9 @@
 #include "statusbar-skinned.h"
 #include "skin_engine/skin_engine.h"
 #include "icons.h"
+#ifdef HAVE_ALBUMART
+#include "albumart.h"
+#endif
 
 #ifdef HAVE_BACKDROP_IMAGE
 /**
@@ -60,6 +63,16 @@ static int clear_main_backdrop(void)
 MENUITEM_FUNCTION(clear_main_bd, 0, ID2P(LANG_CLEAR_BACKDROP),
                     clear_main_backdrop, NULL, NULL, Icon_NOICON);
 #endif
+#ifdef HAVE_ALBUMART
+/* Menu to remove the resized album art kept on disk */
+static int clear_albumart_cache(void)
+{
+    albumart_cache_clear();
+    return 0;
+}
+MENUITEM_FUNCTION(clear_aa_cache, 0, ID2P(LANG_CLEAR_ALBUMART_CACHE),
+                    clear_albumart_cache, NULL, NULL, Icon_NOICON);
+#endif
 #ifdef HAVE_LCD_COLOR
 
 enum Colors {
@@ -423,6 +436,9 @@ MAKE_MENU(theme_menu, ID2P(LANG_THEME_MENU),
 #ifdef HAVE_BACKDROP_IMAGE
             &clear_main_bd,
 #endif
+#ifdef HAVE_ALBUMART
+            &clear_aa_cache,
+#endif
 #ifdef HAVE_LCD_BITMAP
             &bars_menu,
             &cursor_style,
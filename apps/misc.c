@@ -493,7 +493,8 @@ static void car_adapter_tick(void)
 
 void car_adapter_mode_init(void)
 {
-    tick_add_task(car_adapter_tick);
+    /* the resume delay is seconds, no need to check on every tick */
+    tick_add_task_period(car_adapter_tick, HZ/10);
 }
 #endif
 
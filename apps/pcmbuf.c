@@ -133,6 +133,11 @@ static enum
 } fade_state = PCM_NOT_FADING;
 static bool fade_out_complete = false;
 
+/* The codec has no more data for us; running dry is expected */
+static bool end_of_data = false;
+/* Times playback ran dry when it shouldn't have */
+static unsigned long underruns = 0;
+
 /* Voice */
 static bool soft_mode = false;
 
@@ -478,10 +483,14 @@ void * pcmbuf_request_buffer(int *count)
                 return NULL;
         }
 
-        /* Boost CPU if necessary */
+        /* Boost CPU if necessary. Once the codec's demand is known it
+           already runs at a frequency that keeps up, so only boost as a
+           last resort */
         size_t realrem = pcmbuf_size - freespace;
+        size_t boost_level = get_cpu_demand() > 0 ? pcmbuf_watermark / 2 :
+                                                    pcmbuf_watermark;
 
-        if (realrem < pcmbuf_watermark)
+        if (realrem < boost_level)
             trigger_cpu_boost();
 
         boost_codec_thread(realrem*10 / pcmbuf_size);
@@ -571,6 +580,8 @@ static void init_buffer_state(void)
 
     /* Clear change notification */
     chunk_transidx = INVALID_BUF_INDEX;
+
+    end_of_data = false;
 }
 
 /* Initialize the PCM buffer. The structure looks like this:
@@ -603,6 +614,11 @@ size_t pcmbuf_init(void *bufend)
 
     pcmbuf_soft_mode(false);
 
+#ifdef HAVE_REALTIME_AUDIO
+    /* a page fault in the PCM callback is as good as an underrun */
+    rt_audio_lock(RT_BUFFER_PCMBUF, bufstart, bufend - bufstart);
+#endif
+
     return bufend - bufstart;
 }
 
@@ -691,6 +707,8 @@ void pcmbuf_start_track_change(enum pcm_track_change_type type)
     if (++position_key > POSITION_KEY_MAX)
         position_key = 1;
 
+    end_of_data = type == TRACK_CHANGE_END_OF_DATA;
+
     if (type == TRACK_CHANGE_END_OF_DATA)
     {
         crossfade_cancel();
@@ -806,6 +824,16 @@ static void pcmbuf_pcm_callback(const void **start, size_t *size)
                                            desc->pos_key);
         }
     }
+    else if (desc && !fade_out_complete && !end_of_data)
+    {
+        /* The codec didn't keep up */
+        underruns++;
+    }
+}
+
+unsigned long pcmbuf_get_underruns(void)
+{
+    return underruns;
 }
 
 /* Force playback */
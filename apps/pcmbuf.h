@@ -33,6 +33,7 @@ size_t pcmbuf_init(void *bufend);
 /* Playback */
 void pcmbuf_play_start(void);
 void pcmbuf_play_stop(void);
+unsigned long pcmbuf_get_underruns(void);
 void pcmbuf_pause(bool pause);
 
 /* Track change */
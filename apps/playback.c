@@ -1943,6 +1943,19 @@ static int audio_finish_load_track(struct track_info *info)
     }
 #endif /* HAVE_CODEC_BUFFERING */
 
+#ifdef HAVE_CODEC_PRELOAD
+    /* Open the next track's codec now if it brings a format transition so
+       the switch doesn't have to wait for it to load from storage */
+    if (info == track_list_current(1))
+    {
+        int codt = get_audio_base_codec_type(track_id3->codectype);
+        int codt_loaded = get_audio_base_codec_type(codec_loaded());
+
+        if (codt_loaded != AFMT_UNKNOWN && codt != codt_loaded)
+            codec_preload(track_id3->codectype);
+    }
+#endif /* HAVE_CODEC_PRELOAD */
+
     /** Finally, load the audio **/
     size_t file_offset = 0;
 
@@ -2625,6 +2638,9 @@ static void audio_stop_playback(void)
     halt_decoding_track(true);
     pcmbuf_play_stop();
     codec_unload();
+#ifdef HAVE_CODEC_PRELOAD
+    codec_preload_cancel();
+#endif
 
     /* Save resume information  - "filling" might have been set to
        "STATE_ENDED" by caller in order to facilitate end of playlist */
@@ -84,6 +84,7 @@ char *plugin_get_current_filename(void);
 static void* plugin_get_audio_buffer(size_t *buffer_size);
 static void plugin_release_audio_buffer(void);
 static void plugin_tsr(bool (*exit_callback)(bool));
+static int plugin_heap_create(const char *name, void *buf, size_t size);
 
 
 #ifdef HAVE_PLUGIN_CHECK_OPEN_CLOSE
@@ -181,7 +182,7 @@ static const struct plugin_api rockbox_api = {
 #ifdef HAVE_LCD_CONTRAST
     lcd_set_contrast,
 #endif
-    lcd_update,
+    lcd_update_full, /* plugins may write lcd_framebuffer directly */
     lcd_clear_display,
     lcd_getstringsize,
     lcd_putsxy,
@@ -838,6 +839,17 @@ static const struct plugin_api rockbox_api = {
 
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
+#ifdef HAVE_SAMPLING_PROFILER
+    profile_sample_start,
+    profile_sample_stop,
+#endif
+    plugin_heap_create,
+    heap_destroy,
+    heap_malloc,
+    heap_calloc,
+    heap_realloc,
+    heap_free,
+    heap_get_stats,
 };
 
 static int plugin_buffer_handle;
@@ -854,6 +866,9 @@ int plugin_load(const char* plugin, const void* parameter)
             /* not allowing another plugin to load */
             return PLUGIN_OK;
         }
+        /* a heap may live in the plugin's own storage, which lc_close()
+         * unmaps on hosted builds */
+        heap_release_owner(HEAP_OWNER_PLUGIN);
         lc_close(current_plugin_handle);
         current_plugin_handle = pfn_tsr_exit = NULL;
         if (plugin_buffer_handle > 0)
@@ -933,6 +948,7 @@ int plugin_load(const char* plugin, const void* parameter)
 
     if (!pfn_tsr_exit)
     {   /* close handle if plugin is no tsr one */
+        heap_release_owner(HEAP_OWNER_PLUGIN);
         lc_close(current_plugin_handle);
         current_plugin_handle = NULL;
         if (plugin_buffer_handle > 0)
@@ -1037,6 +1053,12 @@ static void plugin_tsr(bool (*exit_callback)(bool))
     pfn_tsr_exit = exit_callback; /* remember the callback for later */
 }
 
+/* Heaps a plugin creates are gone with it, whether or not it destroys them */
+static int plugin_heap_create(const char *name, void *buf, size_t size)
+{
+    return heap_create(name, buf, size, HEAP_OWNER_PLUGIN);
+}
+
 char *plugin_get_current_filename(void)
 {
     return current_plugin;
@@ -71,7 +71,7 @@ void* plugin_get_buffer(size_t *buffer_size);
 #include "mp3_playback.h"
 #include "root_menu.h"
 #include "talk.h"
-#ifdef RB_PROFILE
+#if defined(RB_PROFILE) || defined(HAVE_SAMPLING_PROFILER)
 #include "profile.h"
 #endif
 #include "misc.h"
@@ -115,6 +115,7 @@ void* plugin_get_buffer(size_t *buffer_size);
 #include "crc32.h"
 #include "rbpaths.h"
 #include "core_alloc.h"
+#include "heap.h"
 #include "screen_access.h"
 
 #ifdef HAVE_ALBUMART
@@ -160,12 +161,12 @@ void* plugin_get_buffer(size_t *buffer_size);
 #define PLUGIN_MAGIC 0x526F634B /* RocK */
 
 /* increase this every time the api struct changes */
-#define PLUGIN_API_VERSION 234
+#define PLUGIN_API_VERSION 238
 
 /* update this to latest version if a change to the api struct breaks
    backwards compatibility (and please take the opportunity to sort in any
    new function which are "waiting" at the end of the function table) */
-#define PLUGIN_MIN_API_VERSION 234
+#define PLUGIN_MIN_API_VERSION 236
 
 /* plugin return codes */
 /* internal returns start at 0x100 to make exit(1..255) work */
@@ -977,6 +978,17 @@ struct plugin_api {
 
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
+#ifdef HAVE_SAMPLING_PROFILER
+    bool (*profile_sample_start)(void);
+    int (*profile_sample_stop)(const char *name);
+#endif
+    int (*heap_create)(const char *name, void *buf, size_t size);
+    void (*heap_destroy)(int heap);
+    void * (*heap_malloc)(int heap, size_t size);
+    void * (*heap_calloc)(int heap, size_t nmemb, size_t size);
+    void * (*heap_realloc)(int heap, void *ptr, size_t size);
+    void (*heap_free)(int heap, void *ptr);
+    bool (*heap_get_stats)(int heap, struct heap_stats *stats);
 };
 
 /* plugin header */
@@ -103,7 +103,12 @@ enum plugin_status plugin_start(const void* parameter)
     rb->close(fd);
     bm.data = plugin_buf;
     struct dim jpeg_size;
-    get_jpeg_dim_mem(jpeg_buf, filesize, &jpeg_size);
+    ret = get_jpeg_dim_mem(jpeg_buf, filesize, &jpeg_size);
+    if (ret < 0)
+    {
+        lcd_printf("not a jpeg file: %d", ret);
+        goto wait;
+    }
     lcd_printf("jpeg file size: %dx%d",jpeg_size.width, jpeg_size.height);
     bm.width = jpeg_size.width;
     bm.height = jpeg_size.height;
@@ -140,8 +145,13 @@ enum plugin_status plugin_start(const void* parameter)
             bm.height >>= 1;
             if (!(bm.width && bm.height))
                 break;
-        } else
+        } else if (ret == -1)
             lcd_printf("insufficient memory");
+        else
+        {
+            lcd_printf("decode failed: %d", ret);
+            break;
+        }
     }
 
 wait:
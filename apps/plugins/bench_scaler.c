@@ -25,13 +25,14 @@
 #include "lib/jpeg_mem.h"
 
 
-static unsigned char output;
+static uint32_t checksum;
 static int output_y = 0;
 static int font_h;
 static unsigned char *plugin_buf;
 struct img_part part;
 
-/* a null output plugin to save memory and better isolate scale cost */
+/* a null output plugin to save memory and better isolate scale cost, it only
+   checksums the scaled rows so changes to the scaler output show up */
 static unsigned int get_size_null(struct bitmap *bm)
 {
     (void) bm;
@@ -41,7 +42,6 @@ static unsigned int get_size_null(struct bitmap *bm)
 static void output_row_null(uint32_t row, void * row_in,
                             struct scaler_context *ctx)
 {
-    (void) row;
     uint32_t *in = (uint32_t *)row_in;
 #ifdef HAVE_LCD_COLOR
     uint32_t *lim = in + ctx->bm->width * 3;
@@ -49,18 +49,41 @@ static void output_row_null(uint32_t row, void * row_in,
     uint32_t *lim = in + ctx->bm->width;
 #endif
     while (in < lim)
-        output = SC_OUT(*in++, ctx);
+        checksum = checksum * 31 + SC_OUT(*in++, ctx);
+    checksum += row;
     return;
 }
 
+/* the same test row over and over, kept apart from the scaler's buffer */
+#define SRC_PIXELS 256
+#define SRC_BYTES (SRC_PIXELS * sizeof(*part.buf))
+
 struct img_part *store_part_null(void *args)
 {
     (void) args;
-    part.len = 256;
+    part.len = SRC_PIXELS;
     part.buf = (typeof(part.buf))plugin_buf;
     return &part;
 }
 
+static void init_src_row(void)
+{
+    int i;
+#ifdef HAVE_LCD_COLOR
+    struct uint8_rgb *px = (struct uint8_rgb *)plugin_buf;
+    for (i = 0; i < SRC_PIXELS; i++, px++)
+    {
+        px->red = i;
+        px->green = (i * 7) ^ 0x55;
+        px->blue = 255 - i;
+        px->alpha = 255;
+    }
+#else
+    for (i = 0; i < SRC_PIXELS; i++)
+        plugin_buf[i] = (i * 7) ^ 0x55;
+#endif
+}
+
 const struct custom_format format_null = {
     .output_row_8 = NULL,
 #ifdef HAVE_LCD_COLOR
@@ -98,6 +121,7 @@ enum plugin_status plugin_start(const void* parameter)
     rb->lcd_fillrect(0, 0, LCD_WIDTH, LCD_HEIGHT);
     rb->lcd_set_drawmode(DRMODE_SOLID);
     rb->lcd_getstringsize("A", NULL, &font_h);
+    init_src_row();
     bm.data = plugin_buf;
     int in, out;
     for (in = 64; in < 1025; in <<= 2)
@@ -106,7 +130,8 @@ enum plugin_status plugin_start(const void* parameter)
         {
             if (in == out)
                 continue;
-            lcd_printf("timing %dx%d->%dx>%d scale", in, in, out, out);
+            lcd_printf("timing %dx%d->%dx%d %s scale", in, in, out, out,
+                       in > out ? "area" : "linear");
             long t1, t2, t_end;
             int count = 0;
             t2 = *(rb->current_tick);
@@ -115,7 +140,8 @@ enum plugin_status plugin_start(const void* parameter)
             while (t2 != (t1 = *(rb->current_tick)));
             t_end = t1 + 10 * HZ;
             do {
-                resize_on_load(&bm, false, &in_dim, &rset, (unsigned char *)plugin_buf, plugin_buf_len, &format_null, IF_PIX_FMT(0,) store_part_null, NULL);
+                checksum = 0;
+                resize_on_load(&bm, false, &in_dim, &rset, plugin_buf + SRC_BYTES, plugin_buf_len - SRC_BYTES, &format_null, IF_PIX_FMT(0,) store_part_null, NULL);
                 count++;
                 t2 = *(rb->current_tick);
             } while (TIME_BEFORE(t2, t_end) || count < 10);
@@ -125,7 +151,8 @@ enum plugin_status plugin_start(const void* parameter)
             t2 /= count;
             t1 = t2 / 1000;
             t2 -= t1 * 1000;
-            lcd_printf("%01d.%03d secs/scale", (int)t1, (int)t2);
+            lcd_printf("%01d.%03d secs/scale, output %08lx", (int)t1, (int)t2,
+                       (unsigned long)checksum);
             if (!(bm.width && bm.height))
                 break;
         }
@@ -29,10 +29,8 @@
 #include "mpegplayer.h"
 #include <system.h>
 
-/* Main allocator */
-static off_t mem_ptr;
-static size_t bufsize;
-static unsigned char* mallocbuf;
+/* Main allocator, a heap on what libmpeg2 leaves of the buffer */
+static int heap = -1;
 
 /* libmpeg2 allocator */
 static off_t mpeg2_mem_ptr SHAREDBSS_ATTR;
@@ -114,45 +112,87 @@ static void * mpeg_malloc_internal (unsigned char *mallocbuf,
 
 void *mpeg_malloc(size_t size, mpeg2_alloc_t reason)
 {
-    return mpeg_malloc_internal(mallocbuf, &mem_ptr, bufsize, size,
-                                reason);
+    void *x;
+
+    DEBUGF("mpeg_malloc: s:%lu reason:%s (%d)\n",
+           (unsigned long)size, mpeg_get_reason_str(reason), reason);
+
+    x = rb->heap_malloc(heap, size);
+    if (x == NULL)
+        DEBUGF("OUT OF MEMORY\n");
+
+    return x;
+    (void)reason;
 }
 
 void *mpeg_malloc_all(size_t *size_out, mpeg2_alloc_t reason)
 {
-    /* Can steal all but MIN_MEMMARGIN */
-    if (bufsize - mem_ptr < MIN_MEMMARGIN)
+    struct heap_stats stats;
+    size_t size;
+
+    /* Can steal all of the largest free block but MIN_MEMMARGIN */
+    if (!rb->heap_get_stats(heap, &stats) ||
+        stats.largest_free < 2*MIN_MEMMARGIN)
         return NULL;
 
-    *size_out = bufsize - mem_ptr - MIN_MEMMARGIN;
-    return mpeg_malloc(*size_out, reason);
+    /* TLSF rounds a request up to the next size class; back off until it
+       fits in the block */
+    for (size = stats.largest_free - MIN_MEMMARGIN; size >= MIN_MEMMARGIN;
+         size -= size / 32)
+    {
+        void *x = mpeg_malloc(size, reason);
+        if (x != NULL)
+        {
+            *size_out = size;
+            return x;
+        }
+    }
+
+    return NULL;
 }
 
 bool mpeg_alloc_init(unsigned char *buf, size_t mallocsize)
 {
-    mem_ptr = 0;
     /* Cache-align buffer or 4-byte align */
-    mallocbuf = buf;
-    bufsize = mallocsize;
-    ALIGN_BUFFER(mallocbuf, bufsize, CACHEALIGN_UP(4));
+    ALIGN_BUFFER(buf, mallocsize, CACHEALIGN_UP(4));
 
-    /* Separate allocator for video */
+    /* Separate allocator for video, off the start of the buffer */
     mpeg2_mem_ptr = 0;
-    mpeg2_mallocbuf = mallocbuf;
-    mpeg2_bufallocbuf = mallocbuf;
+    mpeg2_mallocbuf = buf;
+    mpeg2_bufallocbuf = buf;
     mpeg2_bufsize = CACHEALIGN_UP(LIBMPEG2_ALLOC_SIZE);
 
-    if (mpeg_malloc_internal(mallocbuf, &mem_ptr,
-                             bufsize, mpeg2_bufsize,
-                             MPEG_ALLOC_MPEG2_BUFFER) == NULL)
+    DEBUGF("mpeg_alloc_init: bs:%lu reason:%s (%d)\n",
+           (unsigned long)mallocsize,
+           mpeg_get_reason_str(MPEG_ALLOC_MPEG2_BUFFER),
+           MPEG_ALLOC_MPEG2_BUFFER);
+
+    if (mpeg2_bufsize > mallocsize)
     {
+        DEBUGF("OUT OF MEMORY\n");
         return false;
     }
 
+    if (heap >= 0)
+        rb->heap_destroy(heap);
+
+    heap = rb->heap_create("mpegplayer", buf + mpeg2_bufsize,
+                           mallocsize - mpeg2_bufsize);
+    if (heap < 0)
+        return false;
+
     IF_COP(rb->commit_discard_dcache());
     return true;
 }
 
+void mpeg_alloc_exit(void)
+{
+    if (heap >= 0)
+        rb->heap_destroy(heap);
+
+    heap = -1;
+}
+
 /* allocate non-dedicated buffer space which mpeg2_mem_reset will free */
 void * mpeg2_malloc(unsigned size, mpeg2_alloc_t reason)
 {
@@ -198,36 +238,22 @@ void mpeg2_mem_reset(void)
 /* The following are expected by libmad */
 void * codec_malloc(size_t size)
 {
-    void* ptr;
-
-    ptr = mpeg_malloc_internal(mallocbuf, &mem_ptr,
-                                bufsize, size, MPEG_ALLOC_CODEC_MALLOC);
-
-    if (ptr)
-        rb->memset(ptr,0,size);
+    DEBUGF("codec_malloc: s:%lu reason:%s\n", (unsigned long)size,
+           mpeg_get_reason_str(MPEG_ALLOC_CODEC_MALLOC));
 
-    return ptr;
+    return rb->heap_calloc(heap, 1, size);
 }
 
 void * codec_calloc(size_t nmemb, size_t size)
 {
-    void* ptr;
+    DEBUGF("codec_calloc: s:%lu reason:%s\n", (unsigned long)(nmemb*size),
+           mpeg_get_reason_str(MPEG_ALLOC_CODEC_CALLOC));
 
-    ptr = mpeg_malloc_internal(mallocbuf, &mem_ptr,
-                               bufsize, nmemb*size,
-                               MPEG_ALLOC_CODEC_CALLOC);
-
-    if (ptr)
-        rb->memset(ptr,0,size);
-
-    return ptr;
+    return rb->heap_calloc(heap, nmemb, size);
 }
 
 void codec_free(void* ptr)
 {
     DEBUGF("codec_free - %p\n", ptr);
-#if 0
-    mem_ptr = (void *)ptr - (void *)mallocbuf;
-#endif
-    (void)ptr;
+    rb->heap_free(heap, ptr);
 }
@@ -1155,6 +1155,8 @@ void stream_exit(void)
         stream_mgr.thread = 0;
     }
 
+    mpeg_alloc_exit();
+
 #ifndef HAVE_LCD_COLOR
     grey_release();
 #endif
@@ -122,6 +122,9 @@ static volatile bool codec_playing;
 static volatile enum codec_command_action codec_action;
 static volatile long endtick;
 static volatile long rebuffertick;
+#ifdef HAVE_SAMPLING_PROFILER
+static int profile_samples = -1; /* -1: nothing written */
+#endif
 struct wavinfo_t wavinfo;
 
 static unsigned char wav_header[44] =
@@ -572,6 +575,14 @@ static void init_ci(void)
 
     ci.qsort = rb->qsort;
 
+    /* heaps; the ones the codec leaves are released when this plugin exits */
+    ci.heap_create = rb->heap_create;
+    ci.heap_destroy = rb->heap_destroy;
+    ci.heap_malloc = rb->heap_malloc;
+    ci.heap_calloc = rb->heap_calloc;
+    ci.heap_realloc = rb->heap_realloc;
+    ci.heap_free = rb->heap_free;
+
 #ifdef RB_PROFILE
     ci.profile_thread = rb->profile_thread;
     ci.profstop = rb->profstop;
@@ -607,10 +618,20 @@ static void codec_thread(void)
     /* Load the codec */
     res = rb->codec_load_file(codecname, &ci);
 
+#ifdef HAVE_SAMPLING_PROFILER
+    profile_samples = -1;
+#endif
+
     if (res >= 0)
     {
         /* Decode the file */
+#ifdef HAVE_SAMPLING_PROFILER
+        rb->profile_sample_start();
+#endif
         res = rb->codec_run_proc();
+#ifdef HAVE_SAMPLING_PROFILER
+        profile_samples = rb->profile_sample_stop("test_codec");
+#endif
     }
 
     /* Clean up */
@@ -765,6 +786,14 @@ static enum plugin_status test_track(const char* filename)
             (int)speed/100,(int)speed%100);
             log_text(str,true);
         }   
+#endif
+#ifdef HAVE_SAMPLING_PROFILER
+        if (profile_samples >= 0)
+        {
+            rb->snprintf(str,sizeof(str),"%d samples in /test_codec.out",
+                         profile_samples);
+            log_text(str,true);
+        }
 #endif
     }
 
@@ -403,6 +403,9 @@ enum plugin_status plugin_start(const void* parameter)
 #endif
     backlight_ignore_timeout();
 
+#ifdef HAVE_SAMPLING_PROFILER
+    rb->profile_sample_start();
+#endif
     time_main_update();
     rb->sleep(HZ);
 #if defined(HAVE_LCD_COLOR) && (MEMORYSIZE > 2)
@@ -414,6 +417,17 @@ enum plugin_status plugin_start(const void* parameter)
 #ifdef HAVE_REMOTE_LCD
     time_remote_update();
 #endif
+#ifdef HAVE_SAMPLING_PROFILER
+    {
+        char prof[32];
+        int samples = rb->profile_sample_stop("test_fps");
+        if (samples >= 0)
+        {
+            rb->snprintf(prof, sizeof(prof), "%d samples profiled", samples);
+            log_text(prof);
+        }
+    }
+#endif
 
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
     if (*rb->cpu_frequency != cpu_freq)
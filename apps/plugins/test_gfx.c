@@ -453,6 +453,89 @@ static void time_put_line(void) /* tests put_line performance */
                  count1, count2, count3, count4);
 }
 
+#if defined(HAVE_LCD_COLOR) && !defined(TEST_GREYLIB)
+#define ALPHA_BMP_SIZE 32
+/* native image followed by its 4 bit alpha channel */
+static fb_data alpha_bmp_data[ALPHA_BMP_SIZE * ALPHA_BMP_SIZE +
+                              ALPHA_BMP_SIZE * ALPHA_BMP_SIZE / 2 /
+                              sizeof(fb_data)];
+
+/* an anti-aliased disc, i.e. mostly opaque or transparent pixels with a
+ * blended edge, like a skin icon or a large glyph */
+static void init_alpha_bmp(struct bitmap *bm)
+{
+    unsigned char *alpha = (unsigned char *)alpha_bmp_data +
+                           ALPHA_BMP_SIZE * ALPHA_BMP_SIZE * sizeof(fb_data);
+    const int r = ALPHA_BMP_SIZE / 2;
+    int x, y;
+
+    for (y = 0; y < ALPHA_BMP_SIZE; y++)
+    {
+        for (x = 0; x < ALPHA_BMP_SIZE; x++)
+        {
+            int dx = 2 * x + 1 - ALPHA_BMP_SIZE, dy = 2 * y + 1 - ALPHA_BMP_SIZE;
+            /* about half pixels past the inner edge, 0 (opaque) to 15 */
+            int a = (dx * dx + dy * dy - 4 * (r - 2) * (r - 2)) / (4 * r);
+            int i = y * ALPHA_BMP_SIZE + x;
+
+            a = MAX(0, MIN(a, 15));
+            alpha_bmp_data[i] = FB_RGBPACK(x * 8, y * 8, 128);
+            if (i & 1)
+                alpha[i / 2] |= a << 4;
+            else
+                alpha[i / 2] = a;
+        }
+    }
+
+    bm->width = bm->height = ALPHA_BMP_SIZE;
+    bm->format = FORMAT_NATIVE;
+    bm->maskdata = NULL;
+    bm->alpha_offset = ALPHA_BMP_SIZE * ALPHA_BMP_SIZE * sizeof(fb_data);
+    bm->data = (unsigned char *)alpha_bmp_data;
+}
+
+static void time_alpha(void) /* tests alpha blending performance */
+{
+    long time_start;  /* start tickcount */
+    long time_end;    /* end tickcount */
+    int count1, count2;
+    struct bitmap bm;
+
+    init_alpha_bmp(&bm);
+
+    /* Test 1: alpha bitmap over the framebuffer */
+    rb->lcd_set_drawmode(DRMODE_SOLID);
+    count1 = 0;
+    rb->sleep(0); /* sync to tick */
+    time_start = *rb->current_tick;
+    while((time_end = *rb->current_tick) - time_start < DURATION)
+    {
+        unsigned rnd = rand_table[count1++ & 0x3ff];
+        rb->lcd_bmp_part(&bm, 0, 0, (rnd >> 8) & 0x3f, rnd & 0x3f,
+                         ALPHA_BMP_SIZE, ALPHA_BMP_SIZE);
+    }
+    rb->fdprintf(log_fd, "lcd_bmp_part (alpha bitmaps/s): %d\n", count1);
+
+    /* Test 2: text in the UI font, only blended if it is anti-aliased */
+    rb->lcd_setfont(FONT_UI);
+    if (!rb->font_get(FONT_UI)->depth)
+    {
+        rb->fdprintf(log_fd, "lcd_putsxy   (alpha): no anti-aliased UI font\n");
+        return;
+    }
+    rb->lcd_set_drawmode(DRMODE_FG);
+    count2 = 0;
+    rb->sleep(0); /* sync to tick */
+    time_start = *rb->current_tick;
+    while((time_end = *rb->current_tick) - time_start < DURATION)
+    {
+        unsigned rnd = rand_table[count2++ & 0x3ff];
+        rb->lcd_putsxy((rnd >> 8) & 0x3f, rnd & 0x3f, "Rockbox!");
+    }
+    rb->fdprintf(log_fd, "lcd_putsxy   (alpha strings/s): %d\n", count2);
+}
+#endif
+
 /* plugin entry point */
 enum plugin_status plugin_start(const void* parameter)
 {
@@ -498,7 +581,7 @@ enum plugin_status plugin_start(const void* parameter)
     backlight_ignore_timeout();
 
     rb->splashf(0, "LCD driver performance test, please wait %d sec",
-                7*4*DURATION/HZ);
+                (7*4+2)*DURATION/HZ);
     init_rand_table();
 
 #ifdef HAVE_ADJUSTABLE_CPU_FREQ
@@ -512,6 +595,9 @@ enum plugin_status plugin_start(const void* parameter)
     time_fillrect();
     time_text();
     time_put_line();
+#if defined(HAVE_LCD_COLOR) && !defined(TEST_GREYLIB)
+    time_alpha();
+#endif
 
 #ifdef HAVE_ADJUSTABLE_CPU_FREQ
     if (*rb->cpu_frequency != cpu_freq)
@@ -27,6 +27,9 @@
 #include "buffering.h"
 #include "dircache.h"
 #include "misc.h"
+#include "dir.h"
+#include "file.h"
+#include "crc32.h"
 #include "pathfuncs.h"
 #include "settings.h"
 #include "wps.h"
@@ -367,4 +370,211 @@ void draw_album_art(struct gui_wps *gwps, int handle_id, bool clear)
     }
 }
 
+/* Resized album art cache
+ *
+ * Every decode of the same cover to the same skin size gives the same
+ * bitmap, so the result is written to ALBUMART_CACHE_DIR and read back
+ * the next time. The file name is made from the path of the image (the
+ * track itself for embedded art) and the requested size, the header
+ * identifies the source data so a changed cover is decoded again. */
+
+#define AA_CACHE_MAGIC      (0x41414330 | LCD_DEPTH << 8) /* "AA<depth>0" */
+#define AA_CACHE_SAMPLE     512 /* bytes hashed at each end of the image */
+
+struct albumart_cache_header
+{
+    uint32_t magic;
+    struct albumart_cache_key key;
+    int32_t width;
+    int32_t height;
+    int32_t alpha_offset;
+    int32_t data_size;
+};
+
+static void albumart_cache_path(const struct albumart_cache_key *key,
+                                char *buf, int buflen)
+{
+    snprintf(buf, buflen, ALBUMART_CACHE_DIR "/%08lx.%dx%d.aac",
+             (unsigned long)key->path_crc, key->width, key->height);
+}
+
+/* Fills in the key of the image at the current position of fd, size bytes
+ * long. The file position is restored. */
+void albumart_cache_key(int fd, const char *path, off_t size,
+                        const struct dim *dim, struct albumart_cache_key *key)
+{
+    unsigned char sample[AA_CACHE_SAMPLE];
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    int n;
+
+    memset(key, 0, sizeof(*key));
+    key->path_crc = crc_32(path, strlen(path), 0xffffffff);
+    key->src_pos = pos;
+    key->src_size = size;
+    key->width = dim->width;
+    key->height = dim->height;
+
+    /* the head holds the tables, the tail the last scans of the image */
+    n = read(fd, sample, MIN(size, AA_CACHE_SAMPLE));
+    if (n > 0)
+        key->src_crc = crc_32(sample, n, 0xffffffff);
+    if (size > AA_CACHE_SAMPLE)
+    {
+        lseek(fd, pos + size - AA_CACHE_SAMPLE, SEEK_SET);
+        n = read(fd, sample, AA_CACHE_SAMPLE);
+        if (n > 0)
+            key->src_crc = crc_32(sample, n, key->src_crc);
+    }
+    lseek(fd, pos, SEEK_SET);
+}
+
+/* Reads the cached bitmap for key into bmp, whose data pointer must be set
+ * up with maxsize bytes of room. Returns the data size or 0 on a miss. */
+int albumart_cache_load(const struct albumart_cache_key *key,
+                        struct bitmap *bmp, int maxsize)
+{
+    struct albumart_cache_header hdr;
+    char path[MAX_PATH];
+    int fd, rc = 0;
+
+    albumart_cache_path(key, path, sizeof(path));
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    if (read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+        hdr.magic == AA_CACHE_MAGIC &&
+        !memcmp(&hdr.key, key, sizeof(*key)) &&
+        hdr.data_size > 0 && hdr.data_size <= maxsize &&
+        filesize(fd) == (off_t)(sizeof(hdr) + hdr.data_size) &&
+        read(fd, bmp->data, hdr.data_size) == hdr.data_size)
+    {
+        bmp->width = hdr.width;
+        bmp->height = hdr.height;
+#if (LCD_DEPTH > 1) || defined(HAVE_REMOTE_LCD) && (LCD_REMOTE_DEPTH > 1)
+        bmp->format = FORMAT_NATIVE;
+#endif
+#ifdef HAVE_LCD_COLOR
+        bmp->alpha_offset = hdr.alpha_offset;
+#endif
+        rc = hdr.data_size;
+        logf("Album art cache hit: %s", path);
+    }
+
+    close(fd);
+    return rc;
+}
+
+static bool albumart_cache_file(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && !strcasecmp(ext, ".aac");
+}
+
+/* Removes the oldest cached files until another one of size bytes fits in
+ * the limits. One pass over the directory per file removed, which is
+ * normally none or one. */
+static void albumart_cache_trim(off_t size)
+{
+    char path[MAX_PATH];
+
+    while (1)
+    {
+        DIR *dir = opendir(ALBUMART_CACHE_DIR);
+        struct dirent *entry;
+        int count = 0;
+        off_t total = 0;
+        time_t oldest_time = 0;
+
+        if (!dir)
+            return;
+
+        path[0] = '\0';
+        while ((entry = readdir(dir)))
+        {
+            struct dirinfo info = dir_get_info(dir, entry);
+            if ((info.attribute & ATTR_DIRECTORY) ||
+                !albumart_cache_file(entry->d_name))
+                continue;
+
+            count++;
+            total += info.size;
+            if (!path[0] || info.mtime < oldest_time)
+            {
+                oldest_time = info.mtime;
+                snprintf(path, sizeof(path), ALBUMART_CACHE_DIR "/%s",
+                         entry->d_name);
+            }
+        }
+        closedir(dir);
+
+        if (!path[0] || (count < ALBUMART_CACHE_MAX_FILES &&
+                         total + size <= ALBUMART_CACHE_MAX_SIZE))
+            return;
+
+        logf("Album art cache full, removing %s", path);
+        if (remove(path) < 0)
+            return;
+    }
+}
+
+void albumart_cache_clear(void)
+{
+    char path[MAX_PATH];
+    DIR *dir = opendir(ALBUMART_CACHE_DIR);
+    struct dirent *entry;
+
+    if (!dir)
+        return;
+
+    while ((entry = readdir(dir)))
+    {
+        if (!albumart_cache_file(entry->d_name))
+            continue;
+        snprintf(path, sizeof(path), ALBUMART_CACHE_DIR "/%s", entry->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+/* Stores a freshly decoded bitmap of size bytes under key */
+void albumart_cache_save(const struct albumart_cache_key *key,
+                         const struct bitmap *bmp, int size)
+{
+    struct albumart_cache_header hdr;
+    char path[MAX_PATH];
+    int fd;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = AA_CACHE_MAGIC;
+    hdr.key = *key;
+    hdr.width = bmp->width;
+    hdr.height = bmp->height;
+#ifdef HAVE_LCD_COLOR
+    hdr.alpha_offset = bmp->alpha_offset;
+#endif
+    hdr.data_size = size;
+
+    if (!dir_exists(ALBUMART_CACHE_DIR) && mkdir(ALBUMART_CACHE_DIR) < 0)
+        return;
+
+    albumart_cache_path(key, path, sizeof(path));
+    remove(path); /* an outdated copy doesn't count against the limits */
+    albumart_cache_trim(sizeof(hdr) + size);
+
+    fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd < 0)
+        return;
+
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        write(fd, bmp->data, size) != size)
+    {
+        /* a short file fails the size check, but don't leave it around */
+        close(fd);
+        remove(path);
+        return;
+    }
+    close(fd);
+}
+
 #endif /* PLUGIN */
@@ -39,6 +39,31 @@ bool find_albumart(const struct mp3entry *id3, char *buf, int buflen,
 /* Draw the album art bitmap from the given handle ID onto the given Skin.
    Call with clear = true to clear the bitmap instead of drawing it. */
 void draw_album_art(struct gui_wps *gwps, int handle_id, bool clear);
+
+/* Resized album art is cached in this directory, up to this many files and
+ * bytes; the oldest files make room for new ones */
+#define ALBUMART_CACHE_DIR ROCKBOX_DIR "/albumart"
+#define ALBUMART_CACHE_MAX_FILES 256
+#define ALBUMART_CACHE_MAX_SIZE  (8*1024*1024)
+
+/* Identifies an album art image and the size it is loaded for */
+struct albumart_cache_key {
+    uint32_t path_crc;  /* crc of the image or track path */
+    uint32_t src_crc;   /* crc of the start and end of the image data */
+    int32_t src_pos;    /* position and size of the image data in the file */
+    int32_t src_size;
+    int32_t width;      /* requested size */
+    int32_t height;
+};
+
+void albumart_cache_key(int fd, const char *path, off_t size,
+                        const struct dim *dim, struct albumart_cache_key *key);
+int albumart_cache_load(const struct albumart_cache_key *key,
+                        struct bitmap *bmp, int maxsize);
+void albumart_cache_save(const struct albumart_cache_key *key,
+                         const struct bitmap *bmp, int size);
+/* Removes every cached bitmap */
+void albumart_cache_clear(void);
 #endif
 
 bool search_albumart_files(const struct mp3entry *id3, const char *size_string,
@@ -104,7 +104,7 @@ static inline void yuv_to_rgb(int y, int u, int v, unsigned *r, unsigned *g, uns
 
 /* for type of Huffman table */
 #define DC_LEN 28
-#define AC_LEN 178
+#define AC_LEN 192 /* 162 baseline symbols plus the progressive EOBn runs */
 
 struct huffman_table
 {   /* length and code according to JFIF format */
@@ -139,6 +139,7 @@ struct bitstream
 #define HUFFTAB   0x0001 /* with huffman table */
 #define QUANTTAB  0x0002 /* with quantization table */
 #define APP0_JFIF 0x0004 /* with APP0 segment following JFIF standard */
+#define EOI       0x0008 /* with End-of-Image marker */
 #define SOF0      0x0010 /* with SOF0-Segment */
 #define DHT       0x0020 /* with Definition of huffman tables */
 #define SOS       0x0040 /* with Start-of-Scan segment */
@@ -113,6 +113,22 @@ struct jpeg
 #endif
     jpeg_pix_t *img_buf;
 
+    /* progressive images are decoded scan by scan into coefficient buffers,
+     * which only keep the coefficients the selected IDCT size uses */
+    bool progressive;
+    int components; /* number of components in the frame */
+    int scan_components; /* number of components in the current scan */
+    int scan_ci[3]; /* frame component index of each scan component */
+    int ss, se; /* spectral selection of the current scan */
+    int ah, al; /* successive approximation bit positions */
+    int eobrun; /* blocks left in the current end-of-band run */
+    int dc_pred[3]; /* DC predictors of the current scan */
+    int mcu_y; /* MCU row to output next */
+    int ncoef[3]; /* per component number of buffered coefficients */
+    int coef_w[3]; /* per component coefficient buffer width in blocks */
+    int16_t *coef[3]; /* buffered coefficients, zig-zag order, quantized */
+    uint64_t *coef_nz[3]; /* nonzero flags of coefficients not buffered */
+
     int16_t quanttable[4][QUANT_TABLE_LENGTH];/* raw quantization tables 0-3 */
 
     struct huffman_table hufftable[2]; /* Huffman tables  */
@@ -949,6 +965,18 @@ do {\
     c; \
 })
 
+/* Check that the code counts per length of a Huffman table describe a
+ * prefix code, a damaged table would send the decoder out of its tables.
+ */
+static bool huff_counts_valid(const int *counts)
+{
+    long space = 1L << 16;
+    int l;
+    for (l = 0; l < 16; l++)
+        space -= (long)counts[l] << (15 - l);
+    return space >= 0;
+}
+
 /* Preprocess the JPEG JFIF file */
 static int process_markers(struct jpeg* p_jpeg)
 {
@@ -958,15 +986,22 @@ static int process_markers(struct jpeg* p_jpeg)
     int ret = 0; /* returned flags */
     bool done = false;
 
-    while (!done && (c = e_getc(p_jpeg, -1)))
+    while (!done)
     {
-        if (c != 0xFF) /* no marker? */
+        if (p_jpeg->marker)
+        {   /* marker already read by the entropy decoder at the scan end */
+            c = p_jpeg->marker;
+            p_jpeg->marker = 0;
+        }
+        else
         {
-            JDEBUGF("Non-marker data\n");
-            continue; /* discard */
+            if (e_getc(p_jpeg, -1) != 0xFF) /* no marker? */
+            {
+                JDEBUGF("Non-marker data\n");
+                continue; /* discard */
+            }
+            c = e_getc(p_jpeg, -1);
         }
-
-        c = e_getc(p_jpeg, -1);
         JDEBUGF("marker value %X\n",c);
         switch (c)
         {
@@ -976,9 +1011,14 @@ static int process_markers(struct jpeg* p_jpeg)
         case 0x00: /* Zero stuffed byte */
             break; /* discard */
 
+        case 0xC2: /* SOF Huff  - Progressive DCT*/
+            p_jpeg->progressive = true;
+            /* fall through */
         case 0xC0: /* SOF Huff  - Baseline DCT */
             {
                 JDEBUGF("SOF marker ");
+                if (p_jpeg->components)
+                    return -4; /* more than one frame */
                 ret |= SOF0;
                 marker_size = e_getc(p_jpeg, -1) << 8; /* Highbyte */
                 marker_size |= e_getc(p_jpeg, -1); /* Lowbyte */
@@ -1010,15 +1050,17 @@ static int process_markers(struct jpeg* p_jpeg)
                     p_jpeg->frameheader[i].quanttable_select =
                         e_getc(p_jpeg, -1);
                     if (p_jpeg->frameheader[i].horizontal_sampling > 2
-                     || p_jpeg->frameheader[i].vertical_sampling > 2)
+                     || p_jpeg->frameheader[i].vertical_sampling > 2
+                     || !p_jpeg->frameheader[i].horizontal_sampling
+                     || !p_jpeg->frameheader[i].vertical_sampling)
                     return -3; /* Unsupported SOF0 subsampling */
                 }
                 p_jpeg->blocks = n;
+                p_jpeg->components = n;
             }
             break;
 
         case 0xC1: /* SOF Huff  - Extended sequential DCT*/
-        case 0xC2: /* SOF Huff  - Progressive DCT*/
         case 0xC3: /* SOF Huff  - Spatial (sequential) lossless*/
         case 0xC5: /* SOF Huff  - Differential sequential DCT*/
         case 0xC6: /* SOF Huff  - Differential progressive DCT*/
@@ -1062,6 +1104,9 @@ static int process_markers(struct jpeg* p_jpeg)
                             }
                             if(16 + sum > AC_LEN)
                                 return -10; /* longer than allowed */
+                            if (!huff_counts_valid(
+                                    p_jpeg->hufftable[i].huffmancodes_ac))
+                                return -10; /* codes don't fit their lengths */
 
                             for (; j < 16 + sum; j++)
                             {
@@ -1081,6 +1126,9 @@ static int process_markers(struct jpeg* p_jpeg)
                             }
                             if(16 + sum > DC_LEN)
                                 return -11; /* longer than allowed */
+                            if (!huff_counts_valid(
+                                    p_jpeg->hufftable[i].huffmancodes_dc))
+                                return -11; /* codes don't fit their lengths */
 
                             for (; j < 16 + sum; j++)
                             {
@@ -1103,6 +1151,8 @@ static int process_markers(struct jpeg* p_jpeg)
             break;
         case 0xD9: /* End of Image */
             JDEBUGF("EOI\n");
+            ret |= EOI;
+            done = true;
             break;
         case 0x01: /* for temp private use arith code */
             JDEBUGF("private\n");
@@ -1117,11 +1167,13 @@ static int process_markers(struct jpeg* p_jpeg)
                 marker_size -= 2;
 
                 n = (marker_size-1-3)/2;
-                if (e_getc(p_jpeg, -1) != n || (n != 1 && n != 3))
+                if (e_getc(p_jpeg, -1) != n || (p_jpeg->progressive ?
+                    (n < 1 || n > p_jpeg->components) : (n != 1 && n != 3)))
                 {
                     return (-7); /* Unsupported SOS component specification */
                 }
                 marker_size--;
+                p_jpeg->scan_components = n;
                 for (i=0; i<n; i++)
                 {
                     p_jpeg->scanheader[i].ID = e_getc(p_jpeg, -1);
@@ -1129,8 +1181,26 @@ static int process_markers(struct jpeg* p_jpeg)
                         >> 4;
                     p_jpeg->scanheader[i].AC_select = c & 0x0F;
                     marker_size -= 2;
+                    for (j = 0; j < p_jpeg->components; j++)
+                        if (p_jpeg->frameheader[j].ID ==
+                            p_jpeg->scanheader[i].ID)
+                            break;
+                    p_jpeg->scan_ci[i] = j;
+                    if (p_jpeg->progressive && (j == p_jpeg->components ||
+                        p_jpeg->scanheader[i].DC_select > 1 ||
+                        p_jpeg->scanheader[i].AC_select > 1))
+                        return (-7);
                 }
-                /* skip spectral information */
+                /* spectral selection and successive approximation */
+                p_jpeg->ss = e_getc(p_jpeg, -1);
+                p_jpeg->se = e_getc(p_jpeg, -1);
+                p_jpeg->ah = (c = e_getc(p_jpeg, -1)) >> 4;
+                p_jpeg->al = c & 0x0F;
+                marker_size -= 3;
+                if (p_jpeg->progressive && (p_jpeg->al > 13 || (p_jpeg->ss ?
+                    (p_jpeg->se < p_jpeg->ss || p_jpeg->se > 63 || n != 1) :
+                    p_jpeg->se != 0)))
+                    return (-7); /* invalid progressive scan */
                 e_skip_bytes(p_jpeg, marker_size);
                 done = true;
             }
@@ -1568,33 +1638,54 @@ INLINE void fix_quant_tables(struct jpeg *p_jpeg)
 * is evaluated multiple times.
 */
 
+/* Read the code following an 0xFF in entropy coded data, skipping any fill
+ * bytes. 0 means a stuffed 0xFF data byte.
+ */
+static unsigned char get_marker_code(struct jpeg* p_jpeg)
+{
+    unsigned char marker;
+    while ((marker = d_getc(p_jpeg, 0)) == 0xFF);
+    return marker;
+}
+
 static void fill_bit_buffer(struct jpeg* p_jpeg)
 {
     unsigned char byte, marker;
 
     if (p_jpeg->marker_val)
         p_jpeg->marker_ind += 16;
-    byte = d_getc(p_jpeg, 0);
+    /* once a marker ends the scan, feed zeros until it is processed */
+    byte = p_jpeg->marker ? 0 : d_getc(p_jpeg, 0);
     if (UNLIKELY(byte == 0xFF)) /* legal marker can be byte stuffing or RSTm */
     {   /* simplification: just skip the (one-byte) marker code */
-        marker = d_getc(p_jpeg, 0);
+        marker = get_marker_code(p_jpeg);
         if ((marker & ~7) == 0xD0)
         {
             p_jpeg->marker_val = marker;
             p_jpeg->marker_ind = 8;
         }
+        else if (marker)
+        {
+            p_jpeg->marker = marker;
+            byte = 0;
+        }
     }
     p_jpeg->bitbuf = (p_jpeg->bitbuf << 8) | byte;
 
-    byte = d_getc(p_jpeg, 0);
+    byte = p_jpeg->marker ? 0 : d_getc(p_jpeg, 0);
     if (UNLIKELY(byte == 0xFF)) /* legal marker can be byte stuffing or RSTm */
     {   /* simplification: just skip the (one-byte) marker code */
-        marker = d_getc(p_jpeg, 0);
+        marker = get_marker_code(p_jpeg);
         if ((marker & ~7) == 0xD0)
         {
             p_jpeg->marker_val = marker;
             p_jpeg->marker_ind = 0;
         }
+        else if (marker)
+        {
+            p_jpeg->marker = marker;
+            byte = 0;
+        }
     }
     p_jpeg->bitbuf = (p_jpeg->bitbuf << 8) | byte;
     p_jpeg->bitbuf_bits += 16;
@@ -1664,6 +1755,8 @@ static void search_restart(struct jpeg *p_jpeg)
     }
     unsigned char byte;
     p_jpeg->bitbuf_bits = 0;
+    if (p_jpeg->marker) /* ran into the end of the scan instead */
+        return;
     while ((byte = d_getc(p_jpeg, 0xFF)))
     {
         if (byte == 0xff)
@@ -1778,6 +1871,267 @@ static const int extend_offset[16] = /* entry n is (-1 << n) + 1 */
     } /* end slow decode */ \
 }
 
+/* Successive approximation refinement of coefficient k of a block, which only
+ * applies if the coefficient is nonzero already. Returns whether it was.
+ */
+static bool refine_coef(struct jpeg *p_jpeg, int16_t *coef, uint64_t *nz,
+                        int n, int k)
+{
+    if (k < n)
+    {
+        if (!coef[k])
+            return false;
+        check_bit_buffer(p_jpeg, 1);
+        if (get_bits(p_jpeg, 1) && !(coef[k] & BIT_N(p_jpeg->al)))
+            coef[k] += coef[k] >= 0 ? BIT_N(p_jpeg->al) : -BIT_N(p_jpeg->al);
+        return true;
+    }
+    /* not buffered, but the correction bit has to be consumed */
+    if (!(*nz & (1ULL << k)))
+        return false;
+    check_bit_buffer(p_jpeg, 1);
+    drop_bits(p_jpeg, 1);
+    return true;
+}
+
+/* Decode the part of block (bx, by) of scan component i that the current
+ * progressive scan carries, Section G.1.2.
+ */
+static void decode_prog_block(struct jpeg *p_jpeg, int i, int bx, int by)
+{
+    int ci = p_jpeg->scan_ci[i];
+    int n = p_jpeg->ncoef[ci];
+    int16_t *coef = NULL;
+    uint64_t *nz = NULL;
+    int k, s, r;
+
+    if (n)
+    {
+        int b = by * p_jpeg->coef_w[ci] + bx;
+        coef = p_jpeg->coef[ci] + b * n;
+        if (p_jpeg->coef_nz[ci])
+            nz = p_jpeg->coef_nz[ci] + b;
+    }
+
+    if (!p_jpeg->ss)
+    {
+        if (!p_jpeg->ah)
+        {   /* first DC scan: differential, as in a baseline image */
+            struct derived_tbl* dctbl =
+                &p_jpeg->dc_derived_tbls[p_jpeg->scanheader[i].DC_select];
+            huff_decode_dc(p_jpeg, dctbl, s, r);
+            p_jpeg->dc_pred[ci] += HUFF_EXTEND(r, s);
+            if (coef)
+                coef[0] = p_jpeg->dc_pred[ci] * BIT_N(p_jpeg->al);
+        }
+        else
+        {   /* DC refinement: one raw bit per block */
+            check_bit_buffer(p_jpeg, 1);
+            if (get_bits(p_jpeg, 1) && coef)
+                coef[0] |= BIT_N(p_jpeg->al);
+        }
+        return;
+    }
+
+    struct derived_tbl* actbl =
+        &p_jpeg->ac_derived_tbls[p_jpeg->scanheader[i].AC_select];
+    if (!p_jpeg->ah)
+    {   /* first AC scan of a band */
+        if (p_jpeg->eobrun)
+        {
+            p_jpeg->eobrun--;
+            return;
+        }
+        for (k = p_jpeg->ss; k <= p_jpeg->se; k++)
+        {
+            huff_decode_ac(p_jpeg, actbl, s);
+            r = s >> 4;
+            s &= 15;
+            if (s)
+            {
+                k += r;
+                check_bit_buffer(p_jpeg, s);
+                r = get_bits(p_jpeg, s);
+                r = HUFF_EXTEND(r, s);
+                if (k < n)
+                    coef[k] = r * BIT_N(p_jpeg->al);
+                else if (k < 64)
+                    *nz |= 1ULL << k;
+            }
+            else if (r == 15)
+                k += 15;
+            else
+            {   /* this block ends a run of 2**r + bits blocks */
+                p_jpeg->eobrun = BIT_N(r) - 1;
+                if (r)
+                {
+                    check_bit_buffer(p_jpeg, r);
+                    p_jpeg->eobrun += get_bits(p_jpeg, r);
+                }
+                break;
+            }
+        }
+        return;
+    }
+
+    /* AC refinement: new coefficients are +-1 << al, and every nonzero one
+     * passed over gets a correction bit
+     */
+    k = p_jpeg->ss;
+    if (!p_jpeg->eobrun)
+    {
+        for (; k <= p_jpeg->se; k++)
+        {
+            huff_decode_ac(p_jpeg, actbl, s);
+            r = s >> 4;
+            s &= 15;
+            if (s)
+            {
+                check_bit_buffer(p_jpeg, 1);
+                s = get_bits(p_jpeg, 1) ? BIT_N(p_jpeg->al)
+                                        : -BIT_N(p_jpeg->al);
+            }
+            else if (r != 15)
+            {
+                p_jpeg->eobrun = BIT_N(r);
+                if (r)
+                {
+                    check_bit_buffer(p_jpeg, r);
+                    p_jpeg->eobrun += get_bits(p_jpeg, r);
+                }
+                break;
+            }
+            /* skip r zero coefficients */
+            for (; k <= p_jpeg->se; k++)
+            {
+                if (!refine_coef(p_jpeg, coef, nz, n, k) && --r < 0)
+                    break;
+            }
+            if (s)
+            {
+                if (k < n)
+                    coef[k] = s;
+                else if (k < 64)
+                    *nz |= 1ULL << k;
+            }
+        }
+    }
+    if (p_jpeg->eobrun)
+    {   /* the rest of the band only gets correction bits */
+        for (; k <= p_jpeg->se; k++)
+            refine_coef(p_jpeg, coef, nz, n, k);
+        p_jpeg->eobrun--;
+    }
+}
+
+/* Skip the entropy coded data of a scan nothing is buffered for */
+static void skip_scan(struct jpeg *p_jpeg)
+{
+    unsigned char *c;
+    while ((c = jpeg_getc(p_jpeg)))
+    {
+        if (*c == 0xFF)
+        {
+            unsigned char marker = get_marker_code(p_jpeg);
+            if (marker && (marker & ~7) != 0xD0)
+            {
+                p_jpeg->marker = marker;
+                return;
+            }
+        }
+    }
+}
+
+/* Decode one progressive scan into the coefficient buffers */
+static void decode_prog_scan(struct jpeg *p_jpeg)
+{
+    int ci = p_jpeg->scan_ci[0];
+    int mcus_x = p_jpeg->x_mbl;
+    int mcus_y = p_jpeg->y_mbl;
+    int mx, my, i, h, v;
+
+    if (p_jpeg->ss && !p_jpeg->ncoef[ci])
+    {
+        skip_scan(p_jpeg);
+        return;
+    }
+    if (p_jpeg->scan_components == 1)
+    {   /* non-interleaved scans only cover the component's own blocks */
+        int hmax = p_jpeg->frameheader[0].horizontal_sampling;
+        int vmax = p_jpeg->frameheader[0].vertical_sampling;
+        mcus_x = ((p_jpeg->x_size *
+                   p_jpeg->frameheader[ci].horizontal_sampling + hmax - 1)
+                  / hmax + 7) >> 3;
+        mcus_y = ((p_jpeg->y_size *
+                   p_jpeg->frameheader[ci].vertical_sampling + vmax - 1)
+                  / vmax + 7) >> 3;
+    }
+    p_jpeg->bitbuf_bits = 0;
+    p_jpeg->marker_val = 0;
+    p_jpeg->marker_ind = 0;
+    p_jpeg->eobrun = 0;
+    p_jpeg->dc_pred[0] = p_jpeg->dc_pred[1] = p_jpeg->dc_pred[2] = 0;
+    p_jpeg->restart = p_jpeg->restart_interval;
+    for (my = 0; my < mcus_y; my++)
+    {
+        for (mx = 0; mx < mcus_x; mx++)
+        {
+            if (p_jpeg->restart_interval && p_jpeg->restart-- == 0)
+            {
+                p_jpeg->restart = p_jpeg->restart_interval - 1;
+                search_restart(p_jpeg);
+                p_jpeg->eobrun = 0;
+                p_jpeg->dc_pred[0] = p_jpeg->dc_pred[1] =
+                                     p_jpeg->dc_pred[2] = 0;
+            }
+            if (p_jpeg->scan_components == 1)
+            {
+                decode_prog_block(p_jpeg, 0, mx, my);
+                continue;
+            }
+            for (i = 0; i < p_jpeg->scan_components; i++)
+            {
+                struct frame_component *fc =
+                    &p_jpeg->frameheader[p_jpeg->scan_ci[i]];
+                for (v = 0; v < fc->vertical_sampling; v++)
+                    for (h = 0; h < fc->horizontal_sampling; h++)
+                        decode_prog_block(p_jpeg, i,
+                            mx * fc->horizontal_sampling + h,
+                            my * fc->vertical_sampling + v);
+            }
+        }
+        yield();
+    }
+}
+
+/* Fetch a buffered block of a progressive image into the IDCT workspace,
+ * dequantized and laid out as store_row_jpeg's Huffman decode would.
+ */
+static void load_prog_block(struct jpeg *p_jpeg, int16_t *block, int ci,
+                            int bx, int by, bool transpose)
+{
+    int n = p_jpeg->ncoef[ci];
+    int16_t *coef = p_jpeg->coef[ci] + (by * p_jpeg->coef_w[ci] + bx) * n;
+    int16_t *quant = p_jpeg->quanttable[!!ci];
+    int k;
+
+    block[0] = MULTIPLY16(coef[0], quant[0]);
+    MEMSET(block+1, 0, p_jpeg->zero_need[!!ci] * sizeof(int));
+    for (k = 1; k < n; k++)
+    {
+        if (coef[k])
+#ifdef JPEG_IDCT_TRANSPOSE
+            block[zag[transpose ? k : k + 64]] =
+                MULTIPLY16(coef[k], quant[k]);
+#else
+            block[zag[k]] = MULTIPLY16(coef[k], quant[k]);
+#endif
+    }
+#ifndef JPEG_IDCT_TRANSPOSE
+    (void)transpose;
+#endif
+}
+
 static struct img_part *store_row_jpeg(void *jpeg_args)
 {
     struct jpeg *p_jpeg = (struct jpeg*) jpeg_args;
@@ -1824,6 +2178,28 @@ static struct img_part *store_row_jpeg(void *jpeg_args)
                 struct derived_tbl* dctbl = &p_jpeg->dc_derived_tbls[ti];
                 struct derived_tbl* actbl = &p_jpeg->ac_derived_tbls[ti];
 
+                if (p_jpeg->progressive)
+                {
+#ifndef HAVE_LCD_COLOR
+                    if (ci)
+                        continue;
+#endif
+                    int bx = x, by = p_jpeg->mcu_y;
+                    if (!ci)
+                    {   /* luma blocks of an MCU are in raster order */
+                        int hs = p_jpeg->frameheader[0].horizontal_sampling;
+                        int vs = p_jpeg->frameheader[0].vertical_sampling;
+                        bx = x * hs + (blkn & (hs - 1));
+                        by = by * vs + (blkn >> (hs - 1));
+                    }
+#ifdef JPEG_IDCT_TRANSPOSE
+                    load_prog_block(p_jpeg, block, ci, bx, by, transpose);
+#else
+                    load_prog_block(p_jpeg, block, ci, bx, by, false);
+#endif
+                    goto block_end;
+                }
+
                 /* Section F.2.2.1: decode the DC coefficient difference */
                 huff_decode_dc(p_jpeg, dctbl, s, r);
 
@@ -1855,7 +2231,7 @@ static struct img_part *store_row_jpeg(void *jpeg_args)
                         if (s)
                         {
                             check_bit_buffer(p_jpeg, s);
-                            if (k >= p_jpeg->k_need[!!ci])
+                            if (k > p_jpeg->k_need[!!ci])
                                 goto skip_rest;
                             r = get_bits(p_jpeg, s);
                             r = HUFF_EXTEND(r, s);
@@ -1950,6 +2326,7 @@ block_end:
 #endif
             }
         }
+        p_jpeg->mcu_y++;
     } /* if !p_jpeg->mcu_row */
     p_jpeg->mcu_row = (p_jpeg->mcu_row + 1) & (height - 1);
     p_jpeg->part.len = width;
@@ -1958,6 +2335,63 @@ block_end:
     return &(p_jpeg->part);
 }
 
+/* Decode all scans of a progressive image into coefficient buffers taken
+ * from buf. Only the coefficients the chosen IDCT size uses are kept, so a
+ * downscaled decode needs a fraction of the full coefficient memory.
+ * Returns the number of bytes used, or a negative value on error.
+ */
+static int decode_prog_scans(struct jpeg *p_jpeg, char *buf, int size)
+{
+    char *buf_start = buf;
+    int ci, status;
+
+    for (ci = 0; ci < p_jpeg->components; ci++)
+    {
+        struct frame_component *fc = &p_jpeg->frameheader[ci];
+        int blocks, n;
+#ifdef HAVE_LCD_COLOR
+        n = p_jpeg->k_need[!!ci] + 1;
+#else
+        n = ci ? 0 : p_jpeg->k_need[0] + 1;
+#endif
+        p_jpeg->ncoef[ci] = n;
+        p_jpeg->coef_w[ci] = p_jpeg->x_mbl * fc->horizontal_sampling;
+        if (!n)
+            continue;
+        blocks = p_jpeg->coef_w[ci] * p_jpeg->y_mbl * fc->vertical_sampling;
+        ALIGN_BUFFER(buf, size, sizeof(uint64_t));
+        if (n < 64)
+        {
+            if (size < (int)(blocks * sizeof(uint64_t)))
+                return -1;
+            p_jpeg->coef_nz[ci] = (uint64_t *)buf;
+            buf += blocks * sizeof(uint64_t);
+            size -= blocks * sizeof(uint64_t);
+        }
+        if (size < (int)(blocks * n * sizeof(int16_t)))
+            return -1;
+        p_jpeg->coef[ci] = (int16_t *)buf;
+        buf += blocks * n * sizeof(int16_t);
+        size -= blocks * n * sizeof(int16_t);
+    }
+    memset(buf_start, 0, buf - buf_start);
+    JDEBUGF("coefficient buffers: %d bytes\n", (int)(buf - buf_start));
+
+    while (true)
+    {
+        decode_prog_scan(p_jpeg);
+        status = process_markers(p_jpeg);
+        /* a truncated or damaged file still shows the scans read so far */
+        if (status < 0 || !(status & SOS))
+            break;
+        if (status & DHT)
+            fix_huff_tables(p_jpeg);
+    }
+    /* the output pass reads the buffers, no restart markers there */
+    p_jpeg->restart_interval = 0;
+    return buf - buf_start;
+}
+
 /******************************************************************************
  * read_jpeg_file()
  *
@@ -2071,7 +2505,7 @@ int clip_jpeg_fd(int fd,
 #endif
     if (status < 0)
         return status;
-    if ((status & (DQT | SOF0)) != (DQT | SOF0))
+    if ((status & (DQT | SOF0 | SOS)) != (DQT | SOF0 | SOS))
         return -(status * 16);
     if (!(status & DHT)) /* if no Huffman table present: */
         default_huff_tbl(p_jpeg); /* use default */
@@ -2176,6 +2610,14 @@ int clip_jpeg_fd(int fd,
     buf_start += decode_buf_size;
     maxsize = buf_end - buf_start;
     memset(p_jpeg->img_buf, 0, decode_buf_size);
+    if (p_jpeg->progressive)
+    {
+        int coef_size = decode_prog_scans(p_jpeg, buf_start, maxsize);
+        if (coef_size < 0)
+            return -1;
+        buf_start += coef_size;
+        maxsize = buf_end - buf_start;
+    }
     p_jpeg->mcu_row = 0;
     p_jpeg->restart = p_jpeg->restart_interval;
     rset.rowstart = 0;
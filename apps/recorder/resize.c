@@ -35,6 +35,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "general.h"
 #include "kernel.h"
@@ -165,6 +168,71 @@ static inline uint32_t mul_u16_u16(uint16_t op1, uint16_t op2)
 }
 #endif
 
+/* Row kernels for the vertical scalers, which mix whole rows of 32-bit
+   channel values. Unsigned arithmetic wraps, so the signed increments of the
+   linear scaler go through them unchanged. A colour pixel is exactly one
+   SSE2 vector. */
+#if defined(__SSE2__)
+/* low 32 bits of the product of each lane of a with the broadcast in m */
+static inline __m128i sc_mullo(__m128i a, __m128i m)
+{
+    __m128i even = _mm_mul_epu32(a, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), m);
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+}
+#endif
+
+/* acc = acc * a + tmp * b */
+static inline void sc_row_madd(uint32_t *acc, const uint32_t *tmp, int n,
+                               uint32_t a, uint32_t b)
+{
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi32(a), vb = _mm_set1_epi32(b);
+    for (; n >= 4; n -= 4, acc += 4, tmp += 4)
+    {
+        __m128i x = _mm_loadu_si128((__m128i *)acc);
+        __m128i y = _mm_loadu_si128((const __m128i *)tmp);
+        _mm_storeu_si128((__m128i *)acc,
+                         _mm_add_epi32(sc_mullo(x, va), sc_mullo(y, vb)));
+    }
+#endif
+    for (; n > 0; n--, acc++, tmp++)
+        *acc = *acc * a + *tmp * b;
+}
+
+/* acc += tmp * b */
+static inline void sc_row_mac(uint32_t *acc, const uint32_t *tmp, int n,
+                              uint32_t b)
+{
+#if defined(__SSE2__)
+    const __m128i vb = _mm_set1_epi32(b);
+    for (; n >= 4; n -= 4, acc += 4, tmp += 4)
+    {
+        __m128i x = _mm_loadu_si128((__m128i *)acc);
+        __m128i y = _mm_loadu_si128((const __m128i *)tmp);
+        _mm_storeu_si128((__m128i *)acc, _mm_add_epi32(x, sc_mullo(y, vb)));
+    }
+#endif
+    for (; n > 0; n--, acc++, tmp++)
+        *acc += *tmp * b;
+}
+
+/* acc += tmp */
+static inline void sc_row_add(uint32_t *acc, const uint32_t *tmp, int n)
+{
+#if defined(__SSE2__)
+    for (; n >= 4; n -= 4, acc += 4, tmp += 4)
+    {
+        __m128i x = _mm_loadu_si128((__m128i *)acc);
+        __m128i y = _mm_loadu_si128((const __m128i *)tmp);
+        _mm_storeu_si128((__m128i *)acc, _mm_add_epi32(x, y));
+    }
+#endif
+    for (; n > 0; n--, acc++, tmp++)
+        *acc += *tmp;
+}
+
 /* horizontal area average scaler */
 static bool scale_h_area(void *out_line_ptr,
                          struct scaler_context *ctx, bool accum)
@@ -358,9 +426,9 @@ static inline bool scale_v_area(struct rowset *rset, struct scaler_context *ctx)
     mul = 0;
     oy = rset->rowstart;
     oye = 0;
+    const int row_len = ctx->bm->width * CHANNEL_BYTES;
     uint32_t *rowacc = (uint32_t *) ctx->buf,
-             *rowtmp = rowacc + ctx->bm->width * CHANNEL_BYTES,
-             *rowacc_px, *rowtmp_px;
+             *rowtmp = rowacc + row_len;
     memset((void *)ctx->buf, 0, ctx->bm->width * 2 * sizeof(uint32_t)*CHANNEL_BYTES);
     SDEBUGF("scale_v_area\n");
     /* zero the accumulator and temp rows */
@@ -375,9 +443,7 @@ static inline bool scale_v_area(struct rowset *rset, struct scaler_context *ctx)
             */
             oye -= v_i_val;
             /* add stored partial row to accumulator */
-            for(rowacc_px = rowacc, rowtmp_px = rowtmp; rowacc_px != rowtmp;
-                rowacc_px++, rowtmp_px++)
-                *rowacc_px = *rowacc_px * v_o_val + *rowtmp_px * mul;
+            sc_row_madd(rowacc, rowtmp, row_len, v_o_val, mul);
             /* store new scaled row in temp row */
             if(!ctx->h_scaler(rowtmp, ctx, false))
                 return false;
@@ -385,9 +451,7 @@ static inline bool scale_v_area(struct rowset *rset, struct scaler_context *ctx)
                scale to final value
             */
             mul = v_o_val - oye;
-            for(rowacc_px = rowacc, rowtmp_px = rowtmp; rowacc_px != rowtmp;
-                rowacc_px++, rowtmp_px++)
-                *rowacc_px += mul * *rowtmp_px;
+            sc_row_mac(rowacc, rowtmp, row_len, mul);
             ctx->output_row(oy, (void*)rowacc, ctx);
             /* clear accumulator row, store partial coverage for next row */
             memset((void *)rowacc, 0, ctx->bm->width * sizeof(uint32_t) * CHANNEL_BYTES);
@@ -649,9 +713,7 @@ static inline bool scale_v_linear(struct rowset *rset,
                 }
             }
         } else
-            for(rowinc_px = rowinc, rowval_px = rowval; rowinc_px < rowval;
-                rowinc_px++, rowval_px++)
-                *rowval_px += *rowinc_px;
+            sc_row_add(rowval, rowinc, ctx->bm->width * CHANNEL_BYTES);
         ctx->output_row(oy, (void*)rowval, ctx);
         iye += v_i_val;
     }
@@ -35,6 +35,9 @@
 #include "panic.h"
 #include "crc32.h"
 #include "system.h" /* for ALIGN_*() */
+#ifdef HAVE_CORE_ALLOC_TRACE
+#include "core_alloc.h" /* core_alloc_trace_move() */
+#endif
 
 /* The main goal of this design is fast fetching of the pointer for a handle.
  * For that reason, the handles are stored in a table at the end of the buffer
@@ -76,6 +79,15 @@
  * union buflib_data* L;
  * for(L = start; L < end; L += abs(L->val)) { .... }
  *
+ * To find room without walking, free blocks before alloc_end are also kept
+ * on doubly linked lists, one per power of two size class, with a bitmap of
+ * the non-empty ones in the context. A free block stores the offsets (from
+ * buf_start, so buffer shifting doesn't affect them) of its neighbours in
+ * the two slots after its length marker:
+ * |-L|N|P|YYYYYY|
+ * Blocks too short for that can't satisfy any allocation and are left off.
+ * Compaction rebuilds the lists from scratch.
+ *
  * 
  * The allocator functions are passed a context struct so that two allocators
  * can be run, for example, one per core may be used, with convenience wrappers
@@ -102,6 +114,110 @@ static union buflib_data* find_first_free(struct buflib_context *ctx);
 static union buflib_data* find_block_before(struct buflib_context *ctx,
                                             union buflib_data* block,
                                             bool is_free);
+
+/* Free block lists */
+#define FREE_NONE     (-1)
+#define FREE_MIN_LEN  3     /* length marker and the two links */
+#define FREE_NEXT(b)  ((b)[1].val)
+#define FREE_PREV(b)  ((b)[2].val)
+
+static inline int free_list_index(intptr_t len)
+{
+    int i = 0;
+    while (len >>= 1)
+        i++;
+    return MIN(i, BUFLIB_FREE_LISTS - 1);
+}
+
+static void free_list_init(struct buflib_context *ctx)
+{
+    ctx->free_map = 0;
+    for (int i = 0; i < BUFLIB_FREE_LISTS; i++)
+        ctx->free_list[i] = FREE_NONE;
+}
+
+/* block must be marked free with its final length */
+static void free_list_add(struct buflib_context *ctx, union buflib_data *block)
+{
+    intptr_t len = -block->val;
+    if (len < FREE_MIN_LEN)
+        return;
+
+    int i = free_list_index(len);
+    intptr_t offset = block - ctx->buf_start;
+    intptr_t head = ctx->free_list[i];
+
+    FREE_NEXT(block) = head;
+    FREE_PREV(block) = FREE_NONE;
+    if (head != FREE_NONE)
+        FREE_PREV(ctx->buf_start + head) = offset;
+
+    ctx->free_list[i] = offset;
+    ctx->free_map |= 1u << i;
+}
+
+/* Must be called before the length of a listed block changes */
+static void free_list_remove(struct buflib_context *ctx,
+                             union buflib_data *block)
+{
+    intptr_t len = -block->val;
+    if (len < FREE_MIN_LEN)
+        return;
+
+    int i = free_list_index(len);
+    intptr_t next = FREE_NEXT(block), prev = FREE_PREV(block);
+
+    if (prev != FREE_NONE)
+        FREE_NEXT(ctx->buf_start + prev) = next;
+    else if ((ctx->free_list[i] = next) == FREE_NONE)
+        ctx->free_map &= ~(1u << i);
+
+    if (next != FREE_NONE)
+        FREE_PREV(ctx->buf_start + next) = prev;
+}
+
+/* After moving blocks around */
+static void free_list_rebuild(struct buflib_context *ctx)
+{
+    free_list_init(ctx);
+    for (union buflib_data *block = ctx->buf_start;
+         block < ctx->alloc_end; block += labs(block->val))
+    {
+        if (block->val < 0)
+            free_list_add(ctx, block);
+    }
+}
+
+/* Find a listed free block of at least size units. Every block in a class
+ * at or above the first one whose smallest member fits will do, so the
+ * bitmap answers right away; only when nothing is there the class below
+ * is searched. */
+static union buflib_data*
+free_list_find(struct buflib_context *ctx, size_t size)
+{
+    int fit = free_list_index(size - 1) + 1;
+    int i = fit < BUFLIB_FREE_LISTS ?
+            find_first_set_bit(ctx->free_map & ~((1u << fit) - 1)) : 32;
+
+    if (i < BUFLIB_FREE_LISTS - 1)
+        return ctx->buf_start + ctx->free_list[i];
+
+    /* The last class is open ended, anything in it may be short */
+    if (i == 32)
+        i = fit - 1;
+    if (i >= BUFLIB_FREE_LISTS)
+        i = BUFLIB_FREE_LISTS - 1;
+
+    for (intptr_t offset = ctx->free_list[i]; offset != FREE_NONE;)
+    {
+        union buflib_data *block = ctx->buf_start + offset;
+        if ((size_t)-block->val >= size)
+            return block;
+        offset = FREE_NEXT(block);
+    }
+
+    return NULL;
+}
 /* Initialize buffer manager */
 void
 buflib_init(struct buflib_context *ctx, void *buf, size_t size)
@@ -123,6 +239,7 @@ buflib_init(struct buflib_context *ctx, void *buf, size_t size)
      */
     ctx->alloc_end = bd_buf;
     ctx->compact = true;
+    free_list_init(ctx);
 }
 
 bool buflib_context_relocate(struct buflib_context *ctx, void *buf)
@@ -277,6 +394,10 @@ move_block(struct buflib_context* ctx, union buflib_data* block, int shift)
     if (!ops || ops->move_callback(handle, tmp->alloc, new_start)
                     != BUFLIB_CB_CANNOT_MOVE)
     {
+#ifdef HAVE_CORE_ALLOC_TRACE
+        core_alloc_trace_move(ctx, handle, new_start,
+                              block->val * sizeof(union buflib_data));
+#endif
         tmp->alloc = new_start; /* update handle table */
         memmove(new_block, block, block->val * sizeof(union buflib_data));
         retval = true;
@@ -368,9 +489,109 @@ buflib_compact(struct buflib_context *ctx)
      */
     ctx->alloc_end += shift;
     ctx->compact = true;
+    free_list_rebuild(ctx);
     return ret || shift;
 }
 
+/* Make a free run of at least size units, moving as few bytes as possible.
+ *
+ * Looks for the stretch of the buffer with enough free space in it (the
+ * space at the end counts) that holds the fewest allocated units, then
+ * slides the allocations in there together so that the free space ends up
+ * in one piece. Unmovable blocks bound the stretches. If a move is refused
+ * the buffer stays consistent but the caller has to try harder.
+ */
+static bool
+buflib_compact_for(struct buflib_context *ctx, size_t size)
+{
+    union buflib_data *start = NULL, *end = NULL, *left, *right, *block;
+    size_t free_len = 0, used_len = 0, best = SIZE_MAX;
+    intptr_t len, shift = 0;
+
+    for (left = right = ctx->buf_start; ; right += labs(len))
+    {
+        /* The space at the end is a free block as far as this goes */
+        if (right == ctx->alloc_end)
+            len = right - ctx->last_handle;
+        else
+            len = right->val;
+
+        if (len > 0 && !IS_MOVABLE(right))
+        {
+            left = right + len;
+            free_len = used_len = 0;
+            continue;
+        }
+
+        if (len < 0)
+            free_len += -len;
+        else
+            used_len += len;
+
+        /* Drop from the left what the stretch can do without */
+        while (left < right)
+        {
+            intptr_t l = left->val;
+            if (l > 0)
+                used_len -= l;
+            else if (free_len + l >= size)
+                free_len += l;
+            else
+                break;
+            left += labs(l);
+        }
+
+        if (free_len >= size && used_len < best)
+        {
+            best = used_len;
+            start = left;
+            end = right + labs(len);
+        }
+
+        if (right == ctx->alloc_end)
+            break;
+    }
+
+    if (!start)
+        return false;
+
+    BDEBUGF("%s(): %lu units wanted, moving %lu\n", __func__,
+            (unsigned long)size, (unsigned long)best);
+
+    bool ret = true;
+    for (block = start; block < end && block < ctx->alloc_end; block += len)
+    {
+        len = block->val;
+        if (len < 0)
+        {
+            shift += len;
+            len = -len;
+        }
+        else if (shift && !move_block(ctx, block, shift))
+        {
+            /* leave the gap in front of it as a free block */
+            block[shift].val = shift;
+            shift = 0;
+            ret = false;
+            break;
+        }
+    }
+
+    if (shift)
+    {
+        if (block >= ctx->alloc_end)
+            ctx->alloc_end += shift;
+        else if (block->val < 0)
+            block[shift].val = shift + block->val;
+        else
+            block[shift].val = shift;
+    }
+
+    ctx->compact = false;
+    free_list_rebuild(ctx);
+    return ret;
+}
+
 /* Compact the buffer by trying both shrinking and moving.
  *
  * Try to move first. If unsuccesfull, try to shrink. If that was successful
@@ -546,10 +767,16 @@ handle_alloc:
     }
 
 buffer_alloc:
-    /* need to re-evaluate last before the loop because the last allocation
-     * possibly made room in its front to fit this, so last would be wrong */
-    last = false;
-    for (block = find_first_free(ctx);;block += block_len)
+    /* Holes first, from the free lists; any fragmentation this causes will
+     * be handled at compaction. */
+    block = free_list_find(ctx, size);
+    if (block)
+    {
+        last = false;
+        free_list_remove(ctx, block);
+        block_len = -block->val;
+    }
+    else
     {
         /* If the last used block extends all the way to the handle table, the
          * block "after" it doesn't have a header. Because of this, it's easier
@@ -557,27 +784,18 @@ buffer_alloc:
          * calculate the free space at the end by comparing it to the
          * last_handle pointer.
          */
-        if(block == ctx->alloc_end)
-        {
-            last = true;
-            block_len = ctx->last_handle - block;
-            if ((size_t)block_len < size)
-                block = NULL;
-            break;
-        }
-        block_len = block->val;
-        /* blocks with positive length are already allocated. */
-        if(block_len > 0)
-            continue;
-        block_len = -block_len;
-        /* The search is first-fit, any fragmentation this causes will be
-         * handled at compaction.
-         */
-        if ((size_t)block_len >= size)
-            break;
+        last = true;
+        block = ctx->alloc_end;
+        block_len = ctx->last_handle - block;
+        if ((size_t)block_len < size)
+            block = NULL;
     }
     if (!block)
     {
+        /* Make room by moving as little as possible */
+        if (buflib_compact_for(ctx, size))
+            goto buffer_alloc;
+
         /* Try compacting if allocation failed */
         unsigned hint = BUFLIB_SHRINK_POS_FRONT |
                     ((size*sizeof(union buflib_data))&BUFLIB_SHRINK_SIZE_MASK);
@@ -618,7 +836,10 @@ buffer_alloc:
         ctx->alloc_end = block;
     /* Only free blocks *before* alloc_end have tagged length. */
     else if ((size_t)block_len > size)
+    {
         block->val = size - block_len;
+        free_list_add(ctx, block);
+    }
     /* Return the handle index as a positive integer. */
     return ctx->handle_table - handle;
 }
@@ -677,6 +898,7 @@ buflib_free(struct buflib_context *ctx, int handle_num)
     block = find_block_before(ctx, freed_block, true);
     if (block)
     {
+        free_list_remove(ctx, block);
         block->val -= freed_block->val;
     }
     else
@@ -698,7 +920,11 @@ buflib_free(struct buflib_context *ctx, int handle_num)
     else {
         ctx->compact = false;
         if (next_block->val < 0)
+        {
+            free_list_remove(ctx, next_block);
             block->val += next_block->val;
+        }
+        free_list_add(ctx, block);
     }
     handle_free(ctx, handle);
     handle->alloc = NULL;
@@ -866,7 +1092,13 @@ buflib_shrink(struct buflib_context* ctx, int handle, void* new_start, size_t ne
         /* find the block before in order to merge with the new free space */
         union buflib_data *free_before = find_block_before(ctx, block, true);
         if (free_before)
+        {
+            free_list_remove(ctx, free_before);
             free_before->val += block->val;
+            free_list_add(ctx, free_before);
+        }
+        else
+            free_list_add(ctx, block);
 
         /* We didn't handle size changes yet, assign block to the new one
          * the code below the wants block whether it changed or not */
@@ -885,12 +1117,15 @@ buflib_shrink(struct buflib_context* ctx, int handle, void* new_start, size_t ne
             ctx->alloc_end = new_next_block;
         else if (old_next_block->val < 0)
         {   /* enlarge next block by moving it up */
+            free_list_remove(ctx, old_next_block);
             new_next_block->val = old_next_block->val - (old_next_block - new_next_block);
+            free_list_add(ctx, new_next_block);
         }
         else if (old_next_block != new_next_block)
         {   /* creating a hole */
             /* must be negative to indicate being unallocated */
             new_next_block->val = new_next_block - old_next_block;
+            free_list_add(ctx, new_next_block);
         }
     }
 
@@ -4,6 +4,11 @@
 #include "system.h"
 #include "core_alloc.h"
 #include "buflib.h"
+#ifdef HAVE_CORE_ALLOC_TRACE
+#include "kernel.h"
+#include "file.h"
+#include "string-extra.h"
+#endif
 
 /* not static so it can be discovered by core_get_data() */
 struct buflib_context core_ctx;
@@ -24,6 +29,137 @@ unsigned char *audiobufend = audiobuffer + sizeof(audiobuffer);
 extern unsigned char *audiobufend;
 #endif
 
+#ifdef HAVE_CORE_ALLOC_TRACE
+#define TRACE_MAXIMUM   0x1     /* core_alloc_maximum() */
+#define TRACE_PINNED    0x2     /* no move callback, never moves */
+#define TRACE_SHRINKS   0x4     /* has a shrink callback */
+
+struct alloc_trace_entry
+{
+    long     tick;
+    void    *caller;            /* return address into the client */
+    uint32_t size;
+    uint32_t offset;            /* of the data from the buffer start */
+    int16_t  handle;
+    uint8_t  event;             /* CORE_TRACE_* */
+    uint8_t  flags;             /* TRACE_* */
+    char     name[12];          /* only for allocations */
+};
+
+static struct alloc_trace_entry alloc_trace[CORE_ALLOC_TRACE_EVENTS];
+static unsigned long trace_count, trace_dropped;
+
+static uint32_t trace_offset(const void *data)
+{
+    return (const char *)data - (const char *)core_ctx.buf_start;
+}
+
+static struct alloc_trace_entry *
+trace_event(unsigned int event, int handle, size_t size, void *caller)
+{
+    if (trace_count >= CORE_ALLOC_TRACE_EVENTS)
+    {
+        trace_dropped++;
+        return NULL;
+    }
+
+    struct alloc_trace_entry *e = &alloc_trace[trace_count++];
+    e->tick = current_tick;
+    e->caller = caller;
+    e->size = size;
+    e->offset = handle > 0 ? trace_offset(buflib_get_data(&core_ctx, handle))
+                           : 0;
+    e->handle = handle > 0 ? handle : 0;
+    e->event = event;
+    e->flags = 0;
+    e->name[0] = '\0';
+    return e;
+}
+
+static void trace_alloc(int handle, const char *name, size_t size,
+                        struct buflib_callbacks *ops, unsigned int flags,
+                        void *caller)
+{
+    struct alloc_trace_entry *e =
+        trace_event(handle > 0 ? CORE_TRACE_ALLOC : CORE_TRACE_FAIL,
+                    handle, size, caller);
+    if (!e)
+        return;
+
+    if (ops && !ops->move_callback)
+        flags |= TRACE_PINNED;
+    if (ops && ops->shrink_callback)
+        flags |= TRACE_SHRINKS;
+    e->flags = flags;
+    strlcpy(e->name, name ?: "", sizeof(e->name));
+}
+
+void core_alloc_trace_move(struct buflib_context *ctx, int handle,
+                           void *new_start, size_t bytes)
+{
+    if (ctx != &core_ctx)
+        return;
+
+    struct alloc_trace_entry *e =
+        trace_event(CORE_TRACE_MOVE, handle, bytes, NULL);
+    if (e) /* handle table isn't updated yet */
+        e->offset = trace_offset(new_start);
+}
+
+unsigned long core_alloc_trace_dropped(void)
+{
+    return trace_dropped;
+}
+
+int core_alloc_trace_dump(int fd)
+{
+    static const char * const event_names[CORE_TRACE_NUM] =
+    {
+        [CORE_TRACE_ALLOC]  = "alloc",
+        [CORE_TRACE_FAIL]   = "fail",
+        [CORE_TRACE_FREE]   = "free",
+        [CORE_TRACE_SHRINK] = "shrink",
+        [CORE_TRACE_MOVE]   = "move",
+    };
+    /* Leave out whatever gets logged while the file is written */
+    unsigned long count = trace_count;
+
+    fdprintf(fd, "# Rockbox core_alloc trace\n");
+    fdprintf(fd, "buffer %lu\n", (unsigned long)((char *)audiobufend -
+                                    (char *)core_ctx.buf_start));
+    fdprintf(fd, "clock %d\n", HZ);
+    fdprintf(fd, "dropped %lu\n", trace_dropped);
+
+    for (unsigned long n = 0; n < count; n++)
+    {
+        const struct alloc_trace_entry *e = &alloc_trace[n];
+        char flags[4], *f = flags;
+
+        if (e->flags & TRACE_MAXIMUM)
+            *f++ = 'm';
+        if (e->flags & TRACE_PINNED)
+            *f++ = 'p';
+        if (e->flags & TRACE_SHRINKS)
+            *f++ = 's';
+        if (f == flags)
+            *f++ = '-';
+        *f = '\0';
+
+        fdprintf(fd, "%ld %s %d %lu %lu %s 0x%lx %s\n", e->tick,
+                 event_names[e->event], e->handle, (unsigned long)e->size,
+                 (unsigned long)e->offset, flags, (unsigned long)e->caller,
+                 e->name[0] ? e->name : "-");
+    }
+
+    return count;
+}
+
+#define TRACE_CALLER __builtin_return_address(0)
+#else
+#define trace_alloc(handle, name, size, ops, flags, caller) do { } while (0)
+#define trace_event(event, handle, size, caller)             do { } while (0)
+#endif /* HAVE_CORE_ALLOC_TRACE */
+
 /* debug test alloc */
 static int test_alloc;
 void core_allocator_init(void)
@@ -60,12 +196,16 @@ bool core_test_free(void)
  *       like disc input/output. */
 int core_alloc(const char* name, size_t size)
 {
-    return buflib_alloc_ex(&core_ctx, size, name, NULL);
+    int handle = buflib_alloc_ex(&core_ctx, size, name, NULL);
+    trace_alloc(handle, name, size, NULL, 0, TRACE_CALLER);
+    return handle;
 }
 
 int core_alloc_ex(const char* name, size_t size, struct buflib_callbacks *ops)
 {
-    return buflib_alloc_ex(&core_ctx, size, name, ops);
+    int handle = buflib_alloc_ex(&core_ctx, size, name, ops);
+    trace_alloc(handle, name, size, ops, 0, TRACE_CALLER);
+    return handle;
 }
 
 size_t core_available(void)
@@ -80,17 +220,23 @@ size_t core_allocatable(void)
 
 int core_free(int handle)
 {
+    trace_event(CORE_TRACE_FREE, handle, 0, TRACE_CALLER);
     return buflib_free(&core_ctx, handle);
 }
 
 int core_alloc_maximum(const char* name, size_t *size, struct buflib_callbacks *ops)
 {
-    return buflib_alloc_maximum(&core_ctx, name, size, ops);
+    int handle = buflib_alloc_maximum(&core_ctx, name, size, ops);
+    trace_alloc(handle, name, *size, ops, TRACE_MAXIMUM, TRACE_CALLER);
+    return handle;
 }
 
 bool core_shrink(int handle, void* new_start, size_t new_size)
 {
-    return buflib_shrink(&core_ctx, handle, new_start, new_size);
+    bool ret = buflib_shrink(&core_ctx, handle, new_start, new_size);
+    if (ret)
+        trace_event(CORE_TRACE_SHRINK, handle, new_size, TRACE_CALLER);
+    return ret;
 }
 
 const char* core_get_name(int handle)
@@ -60,6 +60,11 @@ static bool remote_filter_first_keypress;
 static bool phones_present = false;
 #endif
 
+#ifdef HAVE_BUTTON_WAKE
+/* how often to poll while no button is held */
+#define BUTTON_IDLE_POLL  (HZ/20)
+#endif
+
 /* how long until repeat kicks in, in centiseconds */
 #define REPEAT_START      (30*HZ/100)
 
@@ -368,8 +373,21 @@ static void button_tick(void)
 #ifdef HAVE_BUTTON_DATA
     lastdata = data;
 #endif
+#ifdef HAVE_BUTTON_WAKE
+    /* Repeats count ticks, but with nothing held a slower poll will do and
+     * lets an idle system stop the tick */
+    tick_add_task_period(button_tick, lastbtn ? 1 : BUTTON_IDLE_POLL);
+#endif
 }
 
+#ifdef HAVE_TICKLESS_IDLE
+/* For drivers that get an interrupt on input: poll on the next tick */
+void button_wake(void)
+{
+    tick_task_due(button_tick, current_tick);
+}
+#endif
+
 #ifdef HAVE_ADJUSTABLE_CPU_FREQ
 static bool button_boosted = false;
 static long button_unboost_tick;
@@ -512,7 +530,11 @@ void button_init(void)
     last_touchscreen_touch = 0xffff;
 #endif    
     /* Start polling last */
+#ifdef HAVE_TICKLESS_IDLE
+    tick_add_task_period(button_tick, 1);
+#else
     tick_add_task(button_tick);
+#endif
 }
 
 #ifdef BUTTON_DRIVER_CLOSE
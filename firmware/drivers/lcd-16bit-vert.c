@@ -102,6 +102,7 @@ void lcd_hline(int x1, int x2, int y)
         x2 = LCD_WIDTH-1;
 #endif
 
+    lcd_mark_dirty(x1, y, x2 - x1 + 1, 1);
     dst = FBADDR(x1 , y );
     dst_end = dst + (x2 - x1) * LCD_HEIGHT;
 
@@ -187,6 +188,7 @@ void lcd_vline(int x, int y1, int y2)
     if (fillopt == OPT_NONE && current_vp->drawmode != DRMODE_COMPLEMENT)
         return;
 
+    lcd_mark_dirty(x, y1, 1, y2 - y1 + 1);
     dst = FBADDR(x, y1);
 
     switch (fillopt)
@@ -271,6 +273,7 @@ void ICODE_ATTR lcd_bitmap_part(const fb_data *src, int src_x, int src_y,
 #endif
 
     src += stride * src_x + src_y; /* move starting point */
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
     fb_data *dst_end = dst + width * LCD_HEIGHT;
 
@@ -345,6 +348,7 @@ void ICODE_ATTR lcd_bitmap_transparent_part(const fb_data *src, int src_x,
 #endif
 
     src += stride * src_x + src_y; /* move starting point */
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
     dst_end = dst + width * LCD_HEIGHT;
 
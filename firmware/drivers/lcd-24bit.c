@@ -94,6 +94,7 @@ void lcd_clear_viewport(void)
     len  = STRIDE_MAIN(width, height);
     step = STRIDE_MAIN(ROW_INC, COL_INC);
 
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
     dst_end = FBADDR(x + width - 1 , y + height - 1);
 
@@ -265,6 +266,7 @@ void lcd_fillrect(int x, int y, int width, int height)
     if (fillopt == OPT_NONE && current_vp->drawmode != DRMODE_COMPLEMENT)
         return;
 
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
     dst_end = FBADDR(x + width - 1, y + height - 1);
 
@@ -385,6 +387,7 @@ void ICODE_ATTR lcd_mono_bitmap_part(const unsigned char *src, int src_x,
     src += stride * (src_y >> 3) + src_x; /* move starting point */
     src_y  &= 7;
     src_end = src + width;
+    lcd_mark_dirty(x, y, width, height);
     dst_col = FBADDR(x, y);
 
 
@@ -534,6 +537,12 @@ void lcd_mono_bitmap(const unsigned char *src, int x, int y, int width, int heig
 /* This is based on SDL (src/video/SDL_RLEaccel.c) ALPHA_BLIT32_888() macro */
 static inline fb_data blend_two_colors(unsigned c1, unsigned c2, unsigned a)
 {
+    /* nothing to mix at either end of the alpha range */
+    if (a == 0)
+        return FB_SCALARPACK(c2 & 0xffffff);
+    if (a == ALPHA_COLOR_LOOKUP_SIZE)
+        return FB_SCALARPACK(c1 & 0xffffff);
+
     unsigned s = c1;
     unsigned d = c2;
     unsigned s1 = s & 0xff00ff;
@@ -640,6 +649,7 @@ static void ICODE_ATTR lcd_alpha_bitmap_part_mix(const fb_data* image,
     if ((drmode & DRMODE_BG) && lcd_backdrop)
         drmode |= DRMODE_INT_BD;
 
+    lcd_mark_dirty(x, y, width, height);
     dst_row = FBADDR(x, y);
 
     int col, row = height;
@@ -897,6 +907,7 @@ void lcd_hline(int x1, int x2, int y)
 
     width = x2 - x1 + 1;
 
+    lcd_mark_dirty(x1, y, x2 - x1 + 1, 1);
     dst = FBADDR(x1 , y);
     dst_end = dst + width;
     do
@@ -952,6 +963,7 @@ void lcd_vline(int x, int y1, int y2)
         y2 = LCD_HEIGHT-1;
 #endif
 
+    lcd_mark_dirty(x, y1, 1, y2 - y1 + 1);
     dst = FBADDR(x , y1);
     dst_end = dst + (y2 - y1) * LCD_WIDTH;
 
@@ -1025,6 +1037,7 @@ void ICODE_ATTR lcd_bitmap_part(const fb_data *src, int src_x, int src_y,
 #endif
     
     src += stride * src_y + src_x; /* move starting point */
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
 
     do
@@ -1099,6 +1112,7 @@ void ICODE_ATTR lcd_bitmap_transparent_part(const fb_data *src, int src_x,
 #endif
 
     src += stride * src_y + src_x; /* move starting point */
+    lcd_mark_dirty(x, y, width, height);
     dst = FBADDR(x, y);
 
     transparent = FB_SCALARPACK(TRANSPARENT_COLOR);
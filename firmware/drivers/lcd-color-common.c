@@ -57,6 +57,183 @@ static struct viewport default_vp =
 
 static struct viewport* current_vp IDATA_ATTR = &default_vp;
 
+#ifdef HAVE_LCD_DIRTY_RECT
+/*** damage tracking ***/
+
+/* Areas of the screen drawn to since the last lcd_update(), in screen
+ * coordinates with exclusive right and bottom edges. Rectangles which
+ * overlap or touch are merged as they come in, so a typical redraw (lines
+ * of text, a progress bar, an album art) ends up as a few rectangles. */
+#define LCD_DIRTY_RECTS 8
+
+struct lcd_dirty_rect
+{
+    short x1, y1, x2, y2;
+};
+
+static struct lcd_dirty_rect lcd_dirty[LCD_DIRTY_RECTS];
+static int lcd_dirty_count = 0;
+static struct lcd_update_stats lcd_stats;
+
+static inline long lcd_dirty_area(int x1, int y1, int x2, int y2)
+{
+    return (long)(x2 - x1) * (y2 - y1);
+}
+
+/* Record that the area x,y,width,height (screen coordinates) was drawn to.
+ * Called by every primitive right before it touches the framebuffer. */
+static void lcd_mark_dirty(int x, int y, int width, int height)
+{
+    struct lcd_dirty_rect r;
+    int i;
+
+    /* drawing into a backdrop or plugin buffer doesn't reach the panel */
+    if (lcd_framebuffer != &lcd_static_framebuffer[0][0])
+        return;
+
+    r.x1 = MAX(x, 0);
+    r.y1 = MAX(y, 0);
+    r.x2 = MIN(x + width, LCD_WIDTH);
+    r.y2 = MIN(y + height, LCD_HEIGHT);
+    if (r.x1 >= r.x2 || r.y1 >= r.y2)
+        return;
+
+    i = 0;
+    while (i < lcd_dirty_count)
+    {
+        struct lcd_dirty_rect *d = &lcd_dirty[i];
+
+        if (d->x1 <= r.x1 && d->y1 <= r.y1 && d->x2 >= r.x2 && d->y2 >= r.y2)
+            return; /* already covered */
+
+        if (d->x1 <= r.x2 && r.x1 <= d->x2 && d->y1 <= r.y2 && r.y1 <= d->y2)
+        {
+            /* overlapping or adjacent: absorb it and look again, the
+             * grown rectangle may now reach others */
+            r.x1 = MIN(r.x1, d->x1);
+            r.y1 = MIN(r.y1, d->y1);
+            r.x2 = MAX(r.x2, d->x2);
+            r.y2 = MAX(r.y2, d->y2);
+            *d = lcd_dirty[--lcd_dirty_count];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+
+    if (lcd_dirty_count == LCD_DIRTY_RECTS)
+    {
+        /* no free slot, fold it into the rectangle which grows least */
+        long cost, best_cost = -1;
+        int best = 0;
+
+        for (i = 0; i < LCD_DIRTY_RECTS; i++)
+        {
+            struct lcd_dirty_rect *d = &lcd_dirty[i];
+            cost = lcd_dirty_area(MIN(r.x1, d->x1), MIN(r.y1, d->y1),
+                                  MAX(r.x2, d->x2), MAX(r.y2, d->y2))
+                 - lcd_dirty_area(d->x1, d->y1, d->x2, d->y2);
+            if (best_cost < 0 || cost < best_cost)
+            {
+                best_cost = cost;
+                best = i;
+            }
+        }
+
+        /* the union may overlap others now, which only costs a few
+         * pixels sent twice */
+        lcd_dirty[best].x1 = MIN(r.x1, lcd_dirty[best].x1);
+        lcd_dirty[best].y1 = MIN(r.y1, lcd_dirty[best].y1);
+        lcd_dirty[best].x2 = MAX(r.x2, lcd_dirty[best].x2);
+        lcd_dirty[best].y2 = MAX(r.y2, lcd_dirty[best].y2);
+        return;
+    }
+
+    lcd_dirty[lcd_dirty_count++] = r;
+}
+
+/* Same for an area given in viewport coordinates, clipped to the viewport */
+static void lcd_mark_dirty_vp(int x, int y, int width, int height)
+{
+    int x2 = MIN(x + width, current_vp->width);
+    int y2 = MIN(y + height, current_vp->height);
+
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    lcd_mark_dirty(current_vp->x + x, current_vp->y + y, x2 - x, y2 - y);
+}
+
+/* Transfer what was drawn since the last call with lcd_update_rect().
+ * This is what a driver's lcd_update() does when it supports partial
+ * updates. */
+void lcd_update_dirty(void)
+{
+    struct lcd_dirty_rect dirty[LCD_DIRTY_RECTS];
+    int i, count;
+
+    lcd_stats.updates++;
+
+    if (lcd_framebuffer != &lcd_static_framebuffer[0][0])
+    {
+        /* someone else's buffer is shown, nothing is known about it */
+        lcd_dirty_count = 0;
+        lcd_update_rect(0, 0, LCD_WIDTH, LCD_HEIGHT);
+        return;
+    }
+
+    /* lcd_update_rect() prunes the list, work on a copy */
+    count = lcd_dirty_count;
+    memcpy(dirty, lcd_dirty, count * sizeof(*dirty));
+    lcd_dirty_count = 0;
+
+    for (i = 0; i < count; i++)
+        lcd_update_rect(dirty[i].x1, dirty[i].y1,
+                        dirty[i].x2 - dirty[i].x1, dirty[i].y2 - dirty[i].y1);
+}
+
+/* For callers which write the framebuffer behind the driver's back, e.g.
+ * plugins poking rb->lcd_framebuffer */
+void lcd_update_full(void)
+{
+    lcd_mark_dirty(0, 0, LCD_WIDTH, LCD_HEIGHT);
+    lcd_update();
+}
+
+/* Called by the driver's lcd_update_rect() once the area is on the panel:
+ * accounts for it and drops the dirty rectangles it covered */
+void lcd_rect_updated(int x, int y, int width, int height)
+{
+    int x2 = MIN(x + width, LCD_WIDTH);
+    int y2 = MIN(y + height, LCD_HEIGHT);
+    int i;
+
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+    if (x >= x2 || y >= y2)
+        return;
+
+    lcd_stats.rects++;
+    lcd_stats.bytes += lcd_dirty_area(x, y, x2, y2) * sizeof(fb_data);
+
+    for (i = 0; i < lcd_dirty_count; )
+    {
+        struct lcd_dirty_rect *d = &lcd_dirty[i];
+        if (x <= d->x1 && y <= d->y1 && x2 >= d->x2 && y2 >= d->y2)
+            *d = lcd_dirty[--lcd_dirty_count];
+        else
+            i++;
+    }
+}
+
+const struct lcd_update_stats *lcd_get_update_stats(void)
+{
+    return &lcd_stats;
+}
+#else
+#define lcd_mark_dirty(x, y, width, height) do { } while (0)
+#define lcd_mark_dirty_vp(x, y, width, height) do { } while (0)
+#endif /* HAVE_LCD_DIRTY_RECT */
+
 /* LCD init */
 void lcd_init(void)
 {
@@ -173,7 +350,10 @@ void lcd_drawpixel(int x, int y)
         && ((unsigned)y < (unsigned)LCD_HEIGHT)
 #endif
         )
+    {
+        lcd_mark_dirty(current_vp->x + x, current_vp->y + y, 1, 1);
         lcd_fastpixelfuncs[current_vp->drawmode](FBADDR(current_vp->x+x, current_vp->y+y));
+    }
 }
 
 /* Draw a line */
@@ -236,6 +416,8 @@ void lcd_drawline(int x1, int y1, int x2, int y2)
         yinc2 = -yinc2;
     }
 
+    lcd_mark_dirty_vp(MIN(x1, x2), MIN(y1, y2), deltax + 1, deltay + 1);
+
     x = x1;
     y = y1;
 
@@ -50,6 +50,9 @@ bool remote_button_hold(void);
 
 void button_init (void) INIT_ATTR;
 void button_close(void);
+#ifdef HAVE_TICKLESS_IDLE
+void button_wake(void);
+#endif
 int button_queue_count(void);
 long button_get (bool block);
 long button_get_w_tmo(int ticks);
@@ -800,6 +800,20 @@ Lyre prototype 1 */
 #define HAVE_BACKDROP_IMAGE
 #endif
 
+/* The colour drivers record which parts of the framebuffer were drawn to,
+ * so lcd_update() only has to transfer those. Native drivers can opt in
+ * once their lcd_update() goes through lcd_update_dirty(). */
+#if (LCD_DEPTH >= 16) && (CONFIG_PLATFORM & PLATFORM_SDL) \
+    && !defined(BOOTLOADER)
+#define HAVE_LCD_DIRTY_RECT
+#endif
+
+/* The simulator window is presented from the event thread, paced to a
+ * fixed frame rate */
+#if (CONFIG_PLATFORM & PLATFORM_SDL) && !defined(BOOTLOADER)
+#define HAVE_LCD_FRAME_PACING
+#endif
+
 #if (CONFIG_TUNER & (CONFIG_TUNER - 1)) != 0
 /* Multiple possible tuners */
 #define CONFIG_TUNER_MULTI
@@ -929,6 +943,14 @@ Lyre prototype 1 */
 #define HAVE_SCHEDULER_BOOSTCTRL
 #endif /* PLATFORM_NATIVE */
 
+/* Single consumer queues that are posted to with atomics instead of the
+ * irq lock; native targets disable interrupts for less than that costs */
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED) && defined(__GCC_ATOMIC_INT_LOCK_FREE)
+#if __GCC_ATOMIC_INT_LOCK_FREE == 2
+#define HAVE_LOCKFREE_QUEUE
+#endif
+#endif
+
 
 #ifdef HAVE_USBSTACK
 #if CONFIG_USBOTG == USBOTG_ARC
@@ -1014,6 +1036,37 @@ Lyre prototype 1 */
 #define NO_PROF_ATTR
 #endif
 
+/* Hosted Linux builds can profile by sampling instead, see profile.h */
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED) && defined(__linux__) && \
+    !(CONFIG_PLATFORM & PLATFORM_ANDROID) && !defined(RB_PROFILE) && \
+    !defined(BOOTLOADER) && !defined(__PCTOOL__)
+#define HAVE_SAMPLING_PROFILER
+#endif
+
+/* SDL builds running the native scheduler idle in wait_for_interrupt();
+ * kernel-sdl.c can stop its timer until the next deadline, see tick.h.
+ * kernel-unix.c (Android, YP-R0/R1, DX50/DX90) keeps ticking */
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED) && defined(HAVE_SDL) && \
+    !defined(HAVE_SDL_THREADS) && !defined(BOOTLOADER) && !defined(__PCTOOL__)
+#define HAVE_TICKLESS_IDLE
+#endif
+
+/* Button drivers calling button_wake() as input arrives (button-sdl.c) can
+ * be polled slowly while nothing is held. Drivers reading GPIO state are
+ * polled every tick so short presses aren't missed */
+#if defined(HAVE_TICKLESS_IDLE) && defined(HAVE_SDL)
+#define HAVE_BUTTON_WAKE
+#endif
+
+/* Linux players running on kernel-unix.c: ask the host for realtime
+ * scheduling and resident memory for the audio path, see kernel-unix.h.
+ * Maemo and Pandora are Linux too, but run on kernel-sdl.c */
+#if (defined(SAMSUNG_YPR0) || defined(SAMSUNG_YPR1) || \
+     defined(DX50) || defined(DX90)) && \
+    !defined(BOOTLOADER) && !defined(__PCTOOL__)
+#define HAVE_REALTIME_AUDIO
+#endif
+
 /* IRAM usage */
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE) &&   /* Not for hosted environments */ \
     (((CONFIG_CPU == SH7034) && !defined(PLUGIN)) || /* SH1 archos: core only */ \
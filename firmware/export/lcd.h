@@ -189,6 +189,40 @@ extern bool lcd_putsxy_scroll_func(int x, int y, const unsigned char *string,
                                    void (*scroll_func)(struct scrollinfo *),
                                    void *data, int x_offset);
 
+#ifdef HAVE_LCD_DIRTY_RECT
+struct lcd_update_stats
+{
+    unsigned long updates;      /* lcd_update() calls */
+    unsigned long rects;        /* rectangles sent to the panel */
+    unsigned long long bytes;   /* framebuffer bytes sent to the panel */
+};
+
+extern void lcd_update_dirty(void);
+extern void lcd_update_full(void);
+extern void lcd_rect_updated(int x, int y, int width, int height);
+extern const struct lcd_update_stats *lcd_get_update_stats(void);
+#else
+#define lcd_update_full lcd_update
+#endif
+
+#ifdef HAVE_LCD_FRAME_PACING
+/* Histogram buckets are powers of two in ms: 0-1, 2-3, 4-7, ... and the
+ * last one takes everything above */
+#define LCD_FRAME_HIST_BUCKETS 10
+
+struct lcd_frame_stats
+{
+    unsigned long frames;       /* window presents */
+    unsigned long requests;     /* updates folded into them */
+    unsigned long deferred;     /* updates held back to the next frame */
+    unsigned long frame_time[LCD_FRAME_HIST_BUCKETS]; /* between presents */
+    unsigned long latency[LCD_FRAME_HIST_BUCKETS];    /* update to present */
+    int fps;                    /* target presents per second, 0 = unpaced */
+};
+
+extern const struct lcd_frame_stats *lcd_get_frame_stats(void);
+#endif
+
 #ifdef HAVE_LCD_BITMAP
 
 /* performance function */
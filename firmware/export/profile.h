@@ -23,6 +23,7 @@
 #ifndef _SYS_PROFILE_H
 #define _SYS_PROFILE_H
 
+#ifdef RB_PROFILE
 /* Initialize and start profiling */
 void profstart(int current_thread)
   NO_PROF_ATTR;
@@ -43,5 +44,22 @@ void __cyg_profile_func_exit(void *this_fn, void *call_site)
   NO_PROF_ATTR ICODE_ATTR;
 void __cyg_profile_func_enter(void *this_fn, void *call_site)
   NO_PROF_ATTR ICODE_ATTR;
+#endif /* RB_PROFILE */
+
+#ifdef HAVE_SAMPLING_PROFILER
+/* Sampling profiler for hosted builds, no instrumentation needed: the
+ * stack of whichever thread uses the CPU is sampled PROFILE_SAMPLE_HZ
+ * times per second of CPU time. */
+#define PROFILE_SAMPLE_HZ 1000
+
+/* Start sampling, throwing away what an earlier run collected */
+bool profile_sample_start(void);
+/* Stop and write /<name>.out in the format above, for profile_reader.pl,
+ * and /<name>.folded, stacks per thread for flame graphs. Returns the
+ * number of samples or -1. */
+int profile_sample_stop(const char *name);
+/* Host thread backends: the calling host thread runs this thread slot */
+void profile_sample_thread(int slot);
+#endif /* HAVE_SAMPLING_PROFILER */
 
 #endif /*_SYS_PROFILE_H*/
@@ -63,6 +63,60 @@ void cpu_boost(bool on_off);
 #endif
 void cpu_idle_mode(bool on_off);
 int get_cpu_boost_counter(void);
+
+/* Besides the boost count, the frequency follows the CPU demand threads
+ * declare with set_cpu_demand(): the lowest of CPUFREQ_DEFAULT/NORMAL/MAX
+ * that leaves 1/CPU_DEMAND_HEADROOM to spare is chosen. */
+#define CPU_FREQ_LEVELS     3
+#define CPU_DEMAND_HEADROOM 4
+#define CPU_FREQ_LOG_SIZE   32  /* power of 2 */
+
+/* called by the scheduler when a thread's demand changes */
+void cpu_boost_demand(long old_cycles, long new_cycles);
+
+struct cpu_freq_stats
+{
+    long level_ticks[CPU_FREQ_LEVELS]; /* time spent at each level */
+    unsigned long changes;      /* frequency switches */
+    unsigned long boosts;       /* times the boost count went up from 0 */
+    long demand;                /* total declared demand, cycles/s */
+};
+
+struct cpu_freq_decision
+{
+    long tick;
+    long freq;
+    long demand;
+    unsigned char boosts;       /* boost count at the time */
+    char reason;                /* B/U: boost/unboost, I: idle, D: demand */
+};
+
+const struct cpu_freq_stats * cpu_freq_get_stats(void);
+/* n-th most recent frequency change, NULL when there are no more */
+const struct cpu_freq_decision * cpu_freq_get_decision(int n);
+
+/* Work out a thread's demand: call begin/end around the stretches it is
+ * busy and report the work done, e.g. samples decoded at 'rate' per second.
+ * Every CPU_DEMAND_WINDOW seconds of work the prediction is updated and
+ * declared for the calling thread. */
+#define CPU_DEMAND_WINDOW   1
+
+struct cpu_demand_meter
+{
+    bool busy;
+    long since;                 /* tick the busy stretch began */
+    uint64_t cycles;            /* busy ticks * frequency this window */
+    long units;                 /* work done this window */
+    long average;               /* smoothed demand, cycles/s */
+    long deviation;             /* smoothed deviation from the average */
+    long predicted;             /* what is declared */
+};
+
+void cpu_demand_begin(struct cpu_demand_meter *m);
+void cpu_demand_end(struct cpu_demand_meter *m);
+void cpu_demand_pause(struct cpu_demand_meter *m);
+void cpu_demand_work(struct cpu_demand_meter *m, long units, long rate);
+void cpu_demand_reset(struct cpu_demand_meter *m);
 #else /* ndef HAVE_ADJUSTABLE_CPU_FREQ */
 #ifndef FREQ
 #define FREQ CPU_FREQ
@@ -71,6 +125,7 @@ int get_cpu_boost_counter(void);
 #define cpu_boost(on_off)
 #define cpu_boost_id(on_off, id)
 #define cpu_idle_mode(on_off)
+#define cpu_boost_demand(old_cycles, new_cycles)
 #define get_cpu_boost_counter()
 #define get_cpu_boost_tracker()
 #endif /* HAVE_ADJUSTABLE_CPU_FREQ */
@@ -120,6 +120,7 @@ static int buflibmove_callback(int handle, void* current, void* new)
     UPDATE(alloc->font.buffer_position);
 
     UPDATE(alloc->font.cache._index);
+    UPDATE(alloc->font.cache._hash);
     UPDATE(alloc->font.cache._lru._base);
 
     return BUFLIB_CB_OK;
@@ -356,8 +357,7 @@ static size_t font_glyphs_to_bufsize(struct font *pf, int glyphs)
     size_t bufsize;
 
     /* LRU bytes per glyph */
-    bufsize = LRU_SLOT_OVERHEAD + sizeof(struct font_cache_entry) + 
-        sizeof( unsigned short);
+    bufsize = FONT_CACHE_SLOT_OVERHEAD + sizeof(struct font_cache_entry);
     /* Image bytes per glyph */
     bufsize += glyph_bytes(pf, pf->maxwidth);
     bufsize *= glyphs;
@@ -993,6 +993,8 @@ static void glyph_cache_load(const char *font_path, struct font *pf)
             for ( ch = 32 ; ch < 256  && ch < pf->cache._capacity + 32; ch++ )
                 font_get_bits(pf, ch);
         }
+        /* only count lookups made while drawing */
+        pf->cache.hits = pf->cache.misses = 0;
     }
     return;
 }
@@ -48,19 +48,30 @@ void font_cache_create(
         font_cache_entry_size++;
 
     int cache_size = buf_size /
-        (font_cache_entry_size + LRU_SLOT_OVERHEAD + sizeof(short));
+        (font_cache_entry_size + FONT_CACHE_SLOT_OVERHEAD);
+
+    /* the hash gets the largest power of 2 not above the capacity */
+    int hash_size = 1;
+    while (hash_size * 2 <= cache_size)
+        hash_size *= 2;
 
     fcache->_size = 1;
     fcache->_capacity = cache_size;
     fcache->_prev_result = 0;
     fcache->_prev_char_code = 0;
+    fcache->_hash_mask = hash_size - 1;
+    fcache->hits = 0;
+    fcache->misses = 0;
 
     /* set up index */
     fcache->_index = buf;
 
+    /* set up hash, every bucket initially points at an invalid entry */
+    fcache->_hash = fcache->_index + cache_size;
+    memset(fcache->_hash, 0, sizeof(short) * hash_size);
+
     /* set up lru list */
-    unsigned char* lru_buf = buf;
-    lru_buf += sizeof(short) * cache_size;
+    unsigned char* lru_buf = (unsigned char*)(fcache->_hash + hash_size);
     lru_create(&fcache->_lru, lru_buf, cache_size, font_cache_entry_size);
 
     /* initialise cache */
@@ -132,7 +143,18 @@ struct font_cache_entry* font_cache_get(
     struct font_cache_entry* p;
     int insertion_point;
     int index_to_replace;
-    
+    short *bucket = &fcache->_hash[char_code & fcache->_hash_mask];
+
+    /* try the glyph last seen in this bucket before searching the index,
+     * strings mostly repeat the glyphs they have just drawn */
+    p = lru_data(&fcache->_lru, *bucket);
+    if (p->_char_code == char_code)
+    {
+        fcache->hits++;
+        lru_touch(&fcache->_lru, *bucket);
+        return p;
+    }
+
     /* check bounds */
     p = lru_data(&fcache->_lru, fcache->_index[0]);
     if( char_code < p->_char_code )
@@ -152,6 +174,8 @@ struct font_cache_entry* font_cache_get(
                 p = lru_data(&fcache->_lru, lru_handle);
                 if (p->_char_code == char_code)
                 {
+                    fcache->hits++;
+                    *bucket = lru_handle;
                     lru_touch(&fcache->_lru, lru_handle);
                     return lru_data(&fcache->_lru, lru_handle);
                 }
@@ -167,6 +191,7 @@ struct font_cache_entry* font_cache_get(
     }
     
     /* not found */
+    fcache->misses++;
     if (cache_only)
         return NULL;
 
@@ -202,6 +227,7 @@ struct font_cache_entry* font_cache_get(
         fcache->_size++;
 
     p->_char_code = char_code;
+    *bucket = lru_handle_to_replace;
     /* fill bitmap */
     callback(p, callback_data);
     return p;
@@ -46,6 +46,10 @@ union buflib_data
     uint32_t crc;                 /* checksum of this data to detect corruption */
 };
 
+/* Number of size classes free blocks are sorted into, class n holding
+ * blocks of 2^n up to 2^(n+1)-1 units (the last one everything bigger) */
+#define BUFLIB_FREE_LISTS 24
+
 struct buflib_context
 {
     union buflib_data *handle_table;
@@ -54,6 +58,9 @@ struct buflib_context
     union buflib_data *buf_start;
     union buflib_data *alloc_end;
     bool compact;
+    uint32_t free_map;            /* bit n set if free_list[n] isn't empty */
+    intptr_t free_list[BUFLIB_FREE_LISTS]; /* first block of each class, as
+                                     offset from buf_start, or -1 */
 };
 
 /**
@@ -38,6 +38,32 @@ void core_print_block_at(int block_num, char* buf, size_t bufsize);
  * since this is the first any further alloc should force a compaction run */
 bool core_test_free(void);
 
+#ifdef HAVE_CORE_ALLOC_TRACE
+/* Allocation trace: every alloc, free, shrink and move in the core
+ * context is logged from boot until the log fills up. Built with the
+ * "Allocation trace" developer option; firmware/test/buflib/alloc_replay
+ * replays a dump through buflib. */
+#define CORE_ALLOC_TRACE_EVENTS ((MEMORYSIZE) > 8 ? 8192 : 1024)
+
+enum core_alloc_trace_event
+{
+    CORE_TRACE_ALLOC = 0,   /* size requested, offset of the data */
+    CORE_TRACE_FAIL,        /* allocation that returned no handle */
+    CORE_TRACE_FREE,
+    CORE_TRACE_SHRINK,      /* new size and offset */
+    CORE_TRACE_MOVE,        /* bytes moved and new offset */
+    CORE_TRACE_NUM
+};
+
+/* Called by buflib whenever it moved a block of the core context */
+void core_alloc_trace_move(struct buflib_context *ctx, int handle,
+                           void *new_start, size_t bytes);
+/* Events that didn't fit in the log */
+unsigned long core_alloc_trace_dropped(void);
+/* Write the log as text, oldest event first */
+int core_alloc_trace_dump(int fd);
+#endif /* HAVE_CORE_ALLOC_TRACE */
+
 static inline void* core_get_data(int handle)
 {
     extern struct buflib_context core_ctx;
@@ -34,8 +34,15 @@ struct font_cache
     int _prev_char_code;
     int _prev_result;
     short *_index; /* index of lru handles in char_code order */
+    short *_hash;  /* lru handle last seen per char_code bucket */
+    int _hash_mask;
+    unsigned long hits;   /* lookups served from the cache */
+    unsigned long misses; /* lookups that had to load the glyph */
 };
 
+/* Bytes of index and hash needed per cached glyph, on top of the entry */
+#define FONT_CACHE_SLOT_OVERHEAD (LRU_SLOT_OVERHEAD + 2 * sizeof(short))
+
 struct font_cache_entry
 {
     unsigned short _char_code;
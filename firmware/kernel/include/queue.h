@@ -119,6 +119,12 @@ struct event_queue
     struct blocker *blocker_p;          /* priority inheritance info
                                            for sync message senders */
 #endif
+#endif
+#ifdef HAVE_LOCKFREE_QUEUE
+    unsigned int volatile ready[QUEUE_LENGTH]; /* position + 1 once the
+                                           event in the slot is written */
+    bool lockfree;                      /* see queue_enable_lockfree */
+    bool volatile waiting;              /* consumer is about to block */
 #endif
     IF_COP( struct corelock cl; )       /* multiprocessor sync */
 };
@@ -129,6 +135,11 @@ extern void queue_wait(struct event_queue *q, struct queue_event *ev);
 extern void queue_wait_w_tmo(struct event_queue *q, struct queue_event *ev,
                              int ticks);
 extern void queue_post(struct event_queue *q, long id, intptr_t data);
+#ifdef HAVE_LOCKFREE_QUEUE
+extern void queue_enable_lockfree(struct event_queue *q);
+#else
+#define queue_enable_lockfree(q) ((void)(q))
+#endif
 #ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
 extern void queue_enable_queue_send(struct event_queue *q,
                                     struct queue_sender_list *send,
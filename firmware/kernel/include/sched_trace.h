@@ -0,0 +1,76 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef SCHED_TRACE_H
+#define SCHED_TRACE_H
+
+#include "config.h"
+
+#ifdef HAVE_SCHED_TRACE
+#include <stdint.h>
+#include "thread.h"
+
+/* Scheduler trace: a ring of the most recent scheduling events and the
+ * time each thread spent on the CPU. Built with the "Scheduler trace"
+ * developer option; utils/analysis/sched_trace.py turns a dump into a
+ * Chrome trace (chrome://tracing, Perfetto). */
+
+#define SCHED_TRACE_EVENTS  4096 /* power of two */
+#define SCHED_TRACE_IDLE    0xff /* slot number standing for the idle core */
+
+enum sched_trace_event
+{
+    SCHED_EV_CREATE = 0, /* thread slot got a new thread */
+    SCHED_EV_SWITCH,     /* thread starts running, arg = previous slot */
+    SCHED_EV_IDLE,       /* nothing to run, arg = slot that ran last */
+    SCHED_EV_BLOCK,      /* thread blocks, arg = SCHED_BLOCK_* */
+    SCHED_EV_WAKE,       /* thread woken explicitly, arg = waker's slot */
+    SCHED_EV_TIMEOUT,    /* thread woken because its timeout expired */
+    SCHED_EV_BOOST,      /* thread's boost request, arg = 1 on, 0 off */
+    SCHED_EV_NUM
+};
+
+enum sched_block_reason
+{
+    SCHED_BLOCK_QUEUE = 0,  /* queue_wait */
+    SCHED_BLOCK_SEND,       /* queue_send waiting for the reply */
+    SCHED_BLOCK_MUTEX,
+    SCHED_BLOCK_MRSW,
+    SCHED_BLOCK_SEMAPHORE,
+    SCHED_BLOCK_THREAD,     /* thread_wait */
+    SCHED_BLOCK_SLEEP,
+    SCHED_BLOCK_NUM
+};
+#define SCHED_BLOCK_TMO 0x80 /* or'ed in when the block has a timeout */
+
+/* Record an event; thread and arg are slot numbers where applicable */
+void sched_trace(unsigned int event, unsigned int slot, unsigned int arg);
+
+/* Time the thread in slot (or SCHED_TRACE_IDLE) spent on the CPU since
+ * it was created, in sched_trace_clock_hz() units */
+uint64_t sched_trace_run_time(unsigned int slot);
+uint64_t sched_trace_clock(void);
+unsigned long sched_trace_clock_hz(void);
+/* Number of events recorded since boot */
+unsigned long sched_trace_count(void);
+/* Write the thread list and the ring as text, oldest event first */
+int sched_trace_dump(int fd);
+
+#endif /* HAVE_SCHED_TRACE */
+
+#endif /* SCHED_TRACE_H */
@@ -152,9 +152,15 @@ unsigned int create_thread(void (*function)(void),
 #ifdef HAVE_SCHEDULER_BOOSTCTRL
 void trigger_cpu_boost(void);
 void cancel_cpu_boost(void);
+/* Declare the CPU cycles per second the calling thread needs to keep up,
+ * 0 for none; see cpu_demand_begin() for measuring it */
+void set_cpu_demand(long cycles);
+long get_cpu_demand(void);
 #else
 #define trigger_cpu_boost() do { } while(0)
 #define cancel_cpu_boost() do { } while(0)
+#define set_cpu_demand(cycles) do { } while(0)
+#define get_cpu_demand() 0L
 #endif
 /* Make a frozen thread runnable (when started with CREATE_THREAD_FROZEN).
  * Has no effect on a thread not frozen. */
@@ -61,7 +61,39 @@ static inline void call_tick_tasks(void)
 /* implemented in target tree */
 extern void tick_start(unsigned int interval_in_ms) INIT_ATTR;
 
+/* Tasks added with tick_add_task() run on every tick. Those added with
+ * tick_add_task_period() run every 'period' ticks, aligned so that tasks
+ * with the same period share a tick; adding one again changes its period.
+ * A period of 0 calls the task only when tick_task_due() asks for it. */
 extern int tick_add_task(void (*f)(void));
+extern int tick_add_task_period(void (*f)(void), int period);
+extern void tick_task_due(void (*f)(void), long tick);
 extern int tick_remove_task(void (*f)(void));
+/* Ticks until some tick task must run next, 1 if any runs every tick */
+extern long tick_next_due(void);
+
+#ifdef HAVE_TICKLESS_IDLE
+/* Longest time the tick is stopped for, bounds a missed wakeup */
+#define TICK_IDLE_MAX   HZ
+
+struct tick_idle_stats
+{
+    unsigned long sleeps;       /* times the tick was stopped */
+    unsigned long early;        /* ... and restarted by an interrupt */
+    unsigned long skipped;      /* ticks that needed no timer wakeup */
+    long longest;               /* longest stop, in ticks */
+};
+
+/* Scheduler idle: sleep with the tick stopped until the next tick task or
+ * the thread timeout due at 'next_tmo', whichever comes first */
+extern void tick_idle(long next_tmo);
+/* Called by the target with the tick running again after 'elapsed' ticks */
+extern void tick_idle_resume(long ticks, long elapsed);
+extern const struct tick_idle_stats * tick_get_idle_stats(void);
+
+/* implemented in target tree: stop the tick, wait for an interrupt or for
+ * 'ticks' ticks, then call tick_idle_resume() and restart the tick */
+extern void tick_idle_sleep(long ticks);
+#endif /* HAVE_TICKLESS_IDLE */
 
 #endif /* TICK_H */
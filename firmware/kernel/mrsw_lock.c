@@ -199,6 +199,7 @@ void mrsw_read_acquire(struct mrsw_lock *mrsw)
     current->retval = 1; /* indicate multi-wake candidate */
 
     disable_irq();
+    SCHED_TRACE_BLOCK(current, SCHED_BLOCK_MRSW, TIMEOUT_BLOCK);
     block_thread(current, TIMEOUT_BLOCK, &mrsw->queue, &mrsw->splay.blocker);
 
     corelock_unlock(&mrsw->cl);
@@ -298,6 +299,7 @@ void mrsw_write_acquire(struct mrsw_lock *mrsw)
     current->retval = 0; /* indicate single-wake candidate */
 
     disable_irq();
+    SCHED_TRACE_BLOCK(current, SCHED_BLOCK_MRSW, TIMEOUT_BLOCK);
     block_thread(current, TIMEOUT_BLOCK, &mrsw->queue, &mrsw->splay.blocker);
 
     corelock_unlock(&mrsw->cl);
@@ -64,6 +64,7 @@ void mutex_lock(struct mutex *m)
 
     /* block until the lock is open... */
     disable_irq();
+    SCHED_TRACE_BLOCK(current, SCHED_BLOCK_MUTEX, TIMEOUT_BLOCK);
     block_thread(current, TIMEOUT_BLOCK, &m->queue, &m->blocker);
 
     corelock_unlock(&m->cl);
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef QUEUE_LOCKFREE_H
+#define QUEUE_LOCKFREE_H
+
+#include <stdbool.h>
+
+/* Building blocks of the lock-free event queues (HAVE_LOCKFREE_QUEUE).
+ * Kept free of kernel headers so firmware/test/kernel can benchmark the
+ * same code on the host.
+ *
+ * Positions count up forever and are masked to index the ring. Producers
+ * reserve a position by bumping the write index, fill in the slot, then
+ * publish it by storing position + 1 in the slot's ready word; the
+ * consumer only ever looks at ready words, so a slot reserved but not yet
+ * written stops it just like an empty queue does. A ready word can never
+ * hold position + 1 for a position that hasn't been published, since
+ * positions only grow.
+ *
+ * Blocking is a handshake on a "waiting" word: the consumer checks in
+ * before it takes a last look at the ring, producers look for it after
+ * publishing. Either the consumer sees the event or the producer sees the
+ * consumer and wakes it the slow way. */
+
+/* Reserve the next position; any number of producers */
+static inline unsigned int lfq_reserve(unsigned int volatile *write)
+{
+    return __atomic_fetch_add(write, 1, __ATOMIC_RELAXED);
+}
+
+/* Make the event written at pos visible to the consumer */
+static inline void lfq_publish(unsigned int volatile *ready, unsigned int pos)
+{
+    __atomic_store_n(ready, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* Has the event at pos been published? Its contents may be read if so. */
+static inline bool lfq_ready(unsigned int volatile *ready, unsigned int pos)
+{
+    return __atomic_load_n(ready, __ATOMIC_ACQUIRE) == pos + 1;
+}
+
+/* Advance the read index past pos, unless someone else moved it first
+ * (queue_clear, for one); pos is reloaded on failure */
+static inline bool lfq_claim(unsigned int volatile *read, unsigned int *pos)
+{
+    return __atomic_compare_exchange_n(read, pos, *pos + 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/* Consumer: announce that it's about to block; look at the ring again
+ * afterwards */
+static inline void lfq_check_in(bool volatile *waiting)
+{
+    *waiting = true;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* Producer, after lfq_publish: does the consumer need a wakeup? */
+static inline bool lfq_waiter(bool volatile *waiting)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return *waiting;
+}
+
+#endif /* QUEUE_LOCKFREE_H */
@@ -22,6 +22,9 @@
 #include "kernel-internal.h"
 #include "queue.h"
 #include "general.h"
+#ifdef HAVE_LOCKFREE_QUEUE
+#include "queue-lockfree.h"
+#endif
 
 /* This array holds all queues that are initiated. It is used for broadcast. */
 static struct
@@ -190,8 +193,162 @@ static inline void queue_wake_waiter(struct event_queue *q)
     struct thread_entry *thread = WQ_THREAD_FIRST(&q->queue);
     if(thread != NULL)
         queue_wake_waiter_inner(thread);
+#ifdef HAVE_LOCKFREE_QUEUE
+    q->waiting = false;
+#endif
+}
+
+#ifdef HAVE_LOCKFREE_QUEUE
+/****************************************************************************
+ * Lock-free queues
+ *
+ * Hosted targets run their "interrupts" on threads of their own. In the
+ * simulator, disabling them means taking a host mutex, so every message
+ * cost two of those plus contention with the tick and the audio callback;
+ * applications don't disable anything and posts from timer threads were
+ * simply unprotected. A queue
+ * with a single consumer can instead be posted to with atomics only (see
+ * queue-lockfree.h); the consumer takes events the same way and only goes
+ * through the lock to block, to hand over a queue_send sender or to
+ * auto-reply. Anything else that touches the queue keeps locking as
+ * before, but removing events (queue_peek_ex with QPEEK_REMOVE_EVENTS,
+ * queue_remove_from_head) is then for the consumer alone.
+ ****************************************************************************/
+
+/* Switch a queue over; its owner must be the only thread to remove events */
+void queue_enable_lockfree(struct event_queue *q)
+{
+    int oldlevel = disable_irq_save();
+    corelock_lock(&q->cl);
+
+    /* Whatever is queued already counts as published, nothing else may
+     * look like it */
+    for(unsigned int i = 0; i < QUEUE_LENGTH; i++)
+    {
+        unsigned int pos = q->read + i;
+        bool queued = i < q->write - q->read;
+        q->ready[pos & QUEUE_LENGTH_MASK] = queued ? pos + 1 : pos;
+    }
+
+    /* A consumer may already be blocked the old way */
+    q->waiting = WQ_THREAD_FIRST(&q->queue) != NULL;
+    q->lockfree = true;
+
+    corelock_unlock(&q->cl);
+    restore_irq(oldlevel);
+}
+
+/* Take the event at the head without locking, if the lock isn't needed
+ * for it */
+static bool queue_fetch_lockfree(struct event_queue *q,
+                                 struct queue_event *ev)
+{
+    unsigned int rd = q->read;
+
+#ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
+    if(!ev || (q->send && q->send->curr_sender))
+        return false; /* not taking anything, or owes an auto-reply */
+#endif
+
+    while(lfq_ready(&q->ready[rd & QUEUE_LENGTH_MASK], rd))
+    {
+        unsigned int slot = rd & QUEUE_LENGTH_MASK;
+        struct queue_event e = q->events[slot];
+
+#ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
+        if(q->send && q->send->senders[slot])
+            return false; /* synchronous message */
+#endif
+        if(lfq_claim(&q->read, &rd))
+        {
+            *ev = e;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void queue_post_lockfree(struct event_queue *q, long id,
+                                intptr_t data)
+{
+    unsigned int pos = lfq_reserve(&q->write);
+    unsigned int wr = pos & QUEUE_LENGTH_MASK;
+
+    KERNEL_ASSERT((pos + 1 - q->read) <= QUEUE_LENGTH,
+                  "queue_post ovf q=%p", q);
+
+#ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
+    if(UNLIKELY(q->send && q->send->senders[wr]))
+    {
+        /* overflow protect - before the slot is reused */
+        int oldlevel = disable_irq_save();
+        corelock_lock(&q->cl);
+        queue_do_unblock_sender(q->send, wr);
+        corelock_unlock(&q->cl);
+        restore_irq(oldlevel);
+    }
+#endif
+
+    q->events[wr].id   = id;
+    q->events[wr].data = data;
+    lfq_publish(&q->ready[wr], pos);
+
+    if(lfq_waiter(&q->waiting))
+    {
+        int oldlevel = disable_irq_save();
+        corelock_lock(&q->cl);
+        queue_wake_waiter(q);
+        corelock_unlock(&q->cl);
+        restore_irq(oldlevel);
+    }
+}
+
+/* Reserve the tail position; with the queue locked */
+static inline unsigned int queue_reserve(struct event_queue *q)
+{
+    if(q->lockfree)
+        return lfq_reserve(&q->write);
+    return q->write++;
+}
+
+static inline void queue_publish(struct event_queue *q, unsigned int pos)
+{
+    if(q->lockfree)
+        lfq_publish(&q->ready[pos & QUEUE_LENGTH_MASK], pos);
+}
+
+/* Is there an event at position rd? wr is q->write as last read */
+static inline bool queue_has_event(struct event_queue *q, unsigned int rd,
+                                   unsigned int wr)
+{
+    if(q->lockfree)
+        return lfq_ready(&q->ready[rd & QUEUE_LENGTH_MASK], rd);
+    return rd != wr;
+}
+
+/* The consumer found the queue empty and is going to block; true if an
+ * event arrived meanwhile after all */
+static inline bool queue_check_in(struct event_queue *q, unsigned int rd)
+{
+    if(!q->lockfree)
+        return false;
+    lfq_check_in(&q->waiting);
+    return queue_has_event(q, rd, rd);
 }
 
+static inline void queue_check_out(struct event_queue *q)
+{
+    q->waiting = false;
+}
+#else /* !HAVE_LOCKFREE_QUEUE */
+#define queue_reserve(q)                ((q)->write++)
+#define queue_publish(q, pos)           ((void)(pos))
+#define queue_has_event(q, rd, wr)      ((rd) != (wr))
+#define queue_check_in(q, rd)           (false)
+#define queue_check_out(q)
+#endif /* HAVE_LOCKFREE_QUEUE */
+
 /* Queue must not be available for use during this call */
 void queue_init(struct event_queue *q, bool register_queue)
 {
@@ -207,6 +364,10 @@ void queue_init(struct event_queue *q, bool register_queue)
      * queue_count and queue_empty return sane values in the case of a
      * concurrent change without locking inside them. */
     q->read = q->write;
+#ifdef HAVE_LOCKFREE_QUEUE
+    q->lockfree = false;
+    q->waiting = false;
+#endif
 #ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
     q->send = NULL; /* No message sending by default */
     IF_PRIO( q->blocker_p = NULL; )
@@ -282,6 +443,11 @@ void queue_wait(struct event_queue *q, struct queue_event *ev)
                   "queue_wait->wrong thread\n");
 #endif
 
+#ifdef HAVE_LOCKFREE_QUEUE
+    if(q->lockfree && queue_fetch_lockfree(q, ev))
+        return;
+#endif
+
     oldlevel = disable_irq_save();
 
     ASSERT_CPU_MODE(CPU_MODE_THREAD_CONTEXT, oldlevel);
@@ -296,10 +462,15 @@ void queue_wait(struct event_queue *q, struct queue_event *ev)
     while(1)
     {
         rd = q->read;
-        if (rd != q->write) /* A waking message could disappear */
+        /* A waking message could disappear */
+        if (queue_has_event(q, rd, q->write))
+            break;
+
+        if (queue_check_in(q, rd))
             break;
 
         struct thread_entry *current = __running_self_entry();
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_QUEUE, TIMEOUT_BLOCK);
         block_thread(current, TIMEOUT_BLOCK, &q->queue, NULL);
 
         corelock_unlock(&q->cl);
@@ -309,6 +480,8 @@ void queue_wait(struct event_queue *q, struct queue_event *ev)
         corelock_lock(&q->cl);
     } 
 
+    queue_check_out(q);
+
 #ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
     if(ev)
 #endif
@@ -337,6 +510,11 @@ void queue_wait_w_tmo(struct event_queue *q, struct queue_event *ev, int ticks)
                   "queue_wait_w_tmo->wrong thread\n");
 #endif
 
+#ifdef HAVE_LOCKFREE_QUEUE
+    if(q->lockfree && queue_fetch_lockfree(q, ev))
+        return;
+#endif
+
     oldlevel = disable_irq_save();
 
     corelock_lock(&q->cl);
@@ -349,13 +527,17 @@ void queue_wait_w_tmo(struct event_queue *q, struct queue_event *ev, int ticks)
     rd = q->read;
     wr = q->write;
 
-    if(rd != wr || ticks == 0)
+    if(queue_has_event(q, rd, wr) || ticks == 0)
         ; /* no block */
     else while(1)
     {
         ASSERT_CPU_MODE(CPU_MODE_THREAD_CONTEXT, oldlevel);
 
+        if(queue_check_in(q, rd))
+            break;
+
         struct thread_entry *current = __running_self_entry();
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_QUEUE, ticks);
         block_thread(current, ticks, &q->queue, NULL);
 
         corelock_unlock(&q->cl);
@@ -367,7 +549,7 @@ void queue_wait_w_tmo(struct event_queue *q, struct queue_event *ev, int ticks)
         rd = q->read;
         wr = q->write;
 
-        if(rd != wr)
+        if(queue_has_event(q, rd, wr))
             break;
 
         if(ticks < 0)
@@ -383,12 +565,14 @@ void queue_wait_w_tmo(struct event_queue *q, struct queue_event *ev, int ticks)
             break;
     }
 
+    queue_check_out(q);
+
 #ifdef HAVE_EXTENDED_MESSAGING_AND_NAME
     if(UNLIKELY(!ev))
         ; /* just waiting for something */
     else
 #endif
-    if(rd != wr)
+    if(queue_has_event(q, rd, wr))
     {
         q->read = rd + 1;
         rd &= QUEUE_LENGTH_MASK;
@@ -412,6 +596,14 @@ void queue_post(struct event_queue *q, long id, intptr_t data)
     int oldlevel;
     unsigned int wr;
 
+#ifdef HAVE_LOCKFREE_QUEUE
+    if(q->lockfree)
+    {
+        queue_post_lockfree(q, id, data);
+        return;
+    }
+#endif
+
     oldlevel = disable_irq_save();
     corelock_lock(&q->cl);
 
@@ -439,7 +631,7 @@ void queue_post(struct event_queue *q, long id, intptr_t data)
 intptr_t queue_send(struct event_queue *q, long id, intptr_t data)
 {
     int oldlevel;
-    unsigned int wr;
+    unsigned int pos, wr;
 
     oldlevel = disable_irq_save();
 
@@ -447,9 +639,10 @@ intptr_t queue_send(struct event_queue *q, long id, intptr_t data)
 
     corelock_lock(&q->cl);
 
-    wr = q->write++ & QUEUE_LENGTH_MASK;
+    pos = queue_reserve(q);
+    wr = pos & QUEUE_LENGTH_MASK;
 
-    KERNEL_ASSERT((q->write - q->read) <= QUEUE_LENGTH,
+    KERNEL_ASSERT((pos + 1 - q->read) <= QUEUE_LENGTH,
                   "queue_send ovf q=%p", q);
 
     q->events[wr].id   = id;
@@ -464,11 +657,15 @@ intptr_t queue_send(struct event_queue *q, long id, intptr_t data)
         /* overflow protect - unblock any thread waiting at this index */
         queue_release_sender(spp, 0);
 
+        /* Save thread in slot before the message can be seen */
+        *spp = current;
+        queue_publish(q, pos);
+
         /* Wakeup a waiting thread if any */
         queue_wake_waiter(q);
 
-        /* Save thread in slot, add to list and wait for reply */
-        *spp = current;
+        /* Add to list and wait for reply */
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_SEND, TIMEOUT_BLOCK);
         block_thread(current, TIMEOUT_BLOCK, &send->list, q->blocker_p);
 
         corelock_unlock(&q->cl);
@@ -478,6 +675,7 @@ intptr_t queue_send(struct event_queue *q, long id, intptr_t data)
     }
 
     /* Function as queue_post if sending is not enabled */
+    queue_publish(q, pos);
     queue_wake_waiter(q);
 
     corelock_unlock(&q->cl);
@@ -552,7 +750,7 @@ bool queue_peek_ex(struct event_queue *q, struct queue_event *ev,
     corelock_lock(&q->cl);
 
     /* Starting at the head, find first match  */
-    for(rd = q->read, wr = q->write; rd != wr; rd++)
+    for(rd = q->read, wr = q->write; queue_has_event(q, rd, wr); rd++)
     {
         struct queue_event *e = &q->events[rd & QUEUE_LENGTH_MASK];
 
@@ -0,0 +1,215 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include "kernel-internal.h"
+#include "sched_trace.h"
+#include "file.h"
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+#include <sys/time.h>
+#endif
+
+struct trace_entry
+{
+    uint32_t time;      /* low 32 bits of sched_trace_clock() */
+    uint8_t  event;     /* SCHED_EV_* */
+    uint8_t  slot;      /* thread concerned */
+    uint8_t  arg;
+    uint8_t  unused;
+};
+
+static struct trace_entry trace_ring[SCHED_TRACE_EVENTS];
+static unsigned long trace_count;   /* events recorded, ever */
+static bool trace_frozen;           /* don't record while dumping */
+
+/* CPU accounting: whoever runs is charged from its switch in until the
+ * next switch or idle. Index MAXTHREADS is the idle core. */
+static uint64_t run_time[MAXTHREADS + 1];
+static unsigned int run_slot;
+static uint64_t run_since;
+
+/* Clock: microseconds where the target has a free running counter for
+ * it, the tick otherwise. Widened to 64 bits in software. */
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+uint64_t sched_trace_clock(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+unsigned long sched_trace_clock_hz(void)
+{
+    return 1000000;
+}
+#else
+uint64_t sched_trace_clock(void)
+{
+    static uint32_t last;
+    static uint64_t high;
+    /* read the counter under the lock too, or an event traced from an
+     * interrupt in between would look like a wrap */
+    int oldlevel = disable_irq_save();
+#ifdef USEC_TIMER
+    uint32_t now = USEC_TIMER;
+#else
+    uint32_t now = current_tick;
+#endif
+    if (now < last)
+        high += 1ull << 32;
+    last = now;
+    uint64_t t = high | now;
+    restore_irq(oldlevel);
+    return t;
+}
+
+unsigned long sched_trace_clock_hz(void)
+{
+#ifdef USEC_TIMER
+    return 1000000;
+#else
+    return HZ;
+#endif
+}
+#endif /* PLATFORM_HOSTED */
+
+static inline unsigned int account_index(unsigned int slot)
+{
+    return slot < MAXTHREADS ? slot : MAXTHREADS;
+}
+
+void sched_trace(unsigned int event, unsigned int slot, unsigned int arg)
+{
+#if NUM_CORES > 1
+    /* Only the main core is traced; the ring and the accounting assume
+     * a single running thread */
+    if (CURRENT_CORE != CPU)
+        return;
+#endif
+    int oldlevel = disable_irq_save();
+    uint64_t now = sched_trace_clock();
+
+    switch (event)
+    {
+    case SCHED_EV_CREATE:
+        run_time[account_index(slot)] = 0;
+        break;
+    case SCHED_EV_SWITCH:
+    case SCHED_EV_IDLE:
+        run_time[account_index(run_slot)] += now - run_since;
+        run_slot = event == SCHED_EV_SWITCH ? slot : SCHED_TRACE_IDLE;
+        run_since = now;
+        break;
+    }
+
+    if (!trace_frozen)
+    {
+        struct trace_entry *e =
+            &trace_ring[trace_count++ & (SCHED_TRACE_EVENTS - 1)];
+        e->time = now;
+        e->event = event;
+        e->slot = slot;
+        e->arg = arg;
+    }
+
+    restore_irq(oldlevel);
+}
+
+uint64_t sched_trace_run_time(unsigned int slot)
+{
+    int oldlevel = disable_irq_save();
+    uint64_t t = run_time[account_index(slot)];
+    if (account_index(slot) == account_index(run_slot))
+        t += sched_trace_clock() - run_since;
+    restore_irq(oldlevel);
+    return t;
+}
+
+unsigned long sched_trace_count(void)
+{
+    return trace_count;
+}
+
+int sched_trace_dump(int fd)
+{
+    static const char * const event_names[SCHED_EV_NUM] =
+    {
+        [SCHED_EV_CREATE]  = "create",
+        [SCHED_EV_SWITCH]  = "switch",
+        [SCHED_EV_IDLE]    = "idle",
+        [SCHED_EV_BLOCK]   = "block",
+        [SCHED_EV_WAKE]    = "wake",
+        [SCHED_EV_TIMEOUT] = "timeout",
+        [SCHED_EV_BOOST]   = "boost",
+    };
+    static const char * const block_names[SCHED_BLOCK_NUM] =
+    {
+        [SCHED_BLOCK_QUEUE]     = "queue",
+        [SCHED_BLOCK_SEND]      = "send",
+        [SCHED_BLOCK_MUTEX]     = "mutex",
+        [SCHED_BLOCK_MRSW]      = "mrsw",
+        [SCHED_BLOCK_SEMAPHORE] = "semaphore",
+        [SCHED_BLOCK_THREAD]    = "thread",
+        [SCHED_BLOCK_SLEEP]     = "sleep",
+    };
+
+    /* Writing the file schedules too; keep those events out of it */
+    trace_frozen = true;
+
+    unsigned long last = trace_count;
+    unsigned long first = last > SCHED_TRACE_EVENTS ?
+                          last - SCHED_TRACE_EVENTS : 0;
+
+    fdprintf(fd, "# Rockbox scheduler trace\n");
+    fdprintf(fd, "clock %lu\n", sched_trace_clock_hz());
+
+    for (unsigned int i = 0; i < MAXTHREADS; i++)
+    {
+        struct thread_debug_info info;
+        if (thread_get_debug_info(i, &info) > 0)
+            fdprintf(fd, "thread %u %lu %s\n", i,
+                     (unsigned long)(sched_trace_run_time(i) /
+                         (sched_trace_clock_hz() / 1000 ?: 1)),
+                     info.name);
+    }
+
+    for (unsigned long n = first; n < last; n++)
+    {
+        const struct trace_entry *e = &trace_ring[n & (SCHED_TRACE_EVENTS - 1)];
+
+        if (e->event >= SCHED_EV_NUM)
+            continue;
+
+        fdprintf(fd, "%lu %s %u", (unsigned long)e->time,
+                 event_names[e->event], e->slot);
+
+        if (e->event == SCHED_EV_BLOCK)
+        {
+            unsigned int reason = e->arg & ~SCHED_BLOCK_TMO;
+            fdprintf(fd, " %s%s\n",
+                     reason < SCHED_BLOCK_NUM ? block_names[reason] : "?",
+                     (e->arg & SCHED_BLOCK_TMO) ? " tmo" : "");
+        }
+        else
+        {
+            fdprintf(fd, " %u\n", e->arg);
+        }
+    }
+
+    trace_frozen = false;
+    return last - first;
+}
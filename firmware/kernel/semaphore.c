@@ -62,6 +62,7 @@ int semaphore_wait(struct semaphore *s, int timeout)
         /* too many waits - block until count is upped... */
         struct thread_entry *current = __running_self_entry();
 
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_SEMAPHORE, timeout);
         block_thread(current, timeout, &s->queue, NULL);
         corelock_unlock(&s->cl);
 
@@ -133,6 +133,7 @@ struct thread_entry
     unsigned char state;         /* Thread slot state (STATE_*) */
 #ifdef HAVE_SCHEDULER_BOOSTCTRL
     unsigned char cpu_boost;     /* CPU frequency boost flag */
+    long cpu_demand;             /* Declared CPU cycles per second */
 #endif
 };
 
@@ -143,6 +144,19 @@ struct thread_entry
 #define THREAD_ID_INIT(n)       ((1u << THREAD_ID_VERSION_SHIFT) | (n))
 #define THREAD_ID_SLOT(id)      ((id) & THREAD_ID_SLOT_MASK)
 
+/* Scheduler trace hooks */
+#ifdef HAVE_SCHED_TRACE
+#include "sched_trace.h"
+#define SCHED_TRACE(event, thread, arg) \
+    sched_trace((event), THREAD_ID_SLOT((thread)->id), (arg))
+#define SCHED_TRACE_BLOCK(thread, reason, timeout) \
+    SCHED_TRACE(SCHED_EV_BLOCK, (thread), \
+                (reason) | ((timeout) >= 0 ? SCHED_BLOCK_TMO : 0))
+#else
+#define SCHED_TRACE(event, thread, arg)             ({})
+#define SCHED_TRACE_BLOCK(thread, reason, timeout)  ({})
+#endif
+
 #define DEADBEEF ((uintptr_t)0xdeadbeefdeadbeefull)
 
 /* Information kept for each core
@@ -366,6 +366,7 @@ static void new_thread_base_init(struct thread_entry *thread,
 #endif
 #ifdef HAVE_SCHEDULER_BOOSTCTRL
     thread->cpu_boost = 0;
+    thread->cpu_demand = 0;
 #endif
 }
 
@@ -878,6 +879,12 @@ unsigned int wakeup_thread_(struct thread_entry *thread
             UNLOCK_THREAD(thread);
         }
 
+        /* From an interrupt, the "waker" is the thread it interrupted;
+         * none while a thread exits */
+        SCHED_TRACE(SCHED_EV_WAKE, thread,
+                    ({ struct thread_entry *__w = __running_self_entry();
+                       __w ? THREAD_ID_SLOT(__w->id) : SCHED_TRACE_IDLE; }));
+
         return should_switch_tasks(thread);
 
     case STATE_RUNNING:
@@ -946,7 +953,10 @@ static NO_INLINE void check_tmo_expired_inner(struct core_entry *corep)
             tmo_queue_expire(&corep->tmo, prev, thread);
 
             if (state >= TIMEOUT_STATE_FIRST)
+            {
                 core_rtr_add(corep, thread);
+                SCHED_TRACE(SCHED_EV_TIMEOUT, thread, 0);
+            }
 
             /* removed this one - prev doesn't change */
         }
@@ -1010,6 +1020,10 @@ void switch_thread(void)
     const unsigned int core = CURRENT_CORE;
     struct core_entry *corep = __core_id_entry(core);
     struct thread_entry *thread = corep->running;
+#ifdef HAVE_SCHED_TRACE
+    unsigned int prev_slot = thread ? THREAD_ID_SLOT(thread->id)
+                                    : SCHED_TRACE_IDLE;
+#endif
 
     if (thread)
     {
@@ -1041,10 +1055,20 @@ void switch_thread(void)
             break;
 
         thread = NULL;
+
+#ifdef HAVE_SCHED_TRACE
+        if (prev_slot != SCHED_TRACE_IDLE)
+            sched_trace(SCHED_EV_IDLE, SCHED_TRACE_IDLE, prev_slot);
+        prev_slot = SCHED_TRACE_IDLE;
+#endif
         
         /* Enter sleep mode to reduce power usage */
         RTR_UNLOCK(corep);
+#ifdef HAVE_TICKLESS_IDLE
+        tick_idle(corep->next_tmo_check);
+#else
         core_sleep(IF_COP(core));
+#endif
 
         /* Awakened by interrupt or other CPU */
     }
@@ -1093,6 +1117,11 @@ void switch_thread(void)
     rtr_queue_make_first(&corep->rtr, thread);
     corep->running = thread;
 
+#ifdef HAVE_SCHED_TRACE
+    if (THREAD_ID_SLOT(thread->id) != prev_slot)
+        sched_trace(SCHED_EV_SWITCH, THREAD_ID_SLOT(thread->id), prev_slot);
+#endif
+
     RTR_UNLOCK(corep);
     enable_irq();
 
@@ -1114,6 +1143,7 @@ void switch_thread(void)
 void sleep_thread(int ticks)
 {
     struct thread_entry *current = __running_self_entry();
+    SCHED_TRACE_BLOCK(current, SCHED_BLOCK_SLEEP, ticks);
     LOCK_THREAD(current);
     prepare_block(current, STATE_SLEEPING, MAX(ticks, 0) + 1);
     UNLOCK_THREAD(current);
@@ -1213,6 +1243,7 @@ unsigned int create_thread(void (*function)(void),
     LOCK_THREAD(thread);
 
     thread->state = STATE_FROZEN;
+    SCHED_TRACE(SCHED_EV_CREATE, thread, 0);
 
     if (!(flags & CREATE_THREAD_FROZEN))
         core_schedule_wakeup(thread);
@@ -1244,6 +1275,7 @@ void thread_wait(unsigned int thread_id)
     if (thread->id == thread_id && thread->state != STATE_KILLED)
     {
         disable_irq();
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_THREAD, TIMEOUT_BLOCK);
         block_thread(current, TIMEOUT_BLOCK, &thread->queue, NULL);
 
         corelock_unlock(&thread->waiter_cl);
@@ -1286,8 +1318,9 @@ void thread_exit(void)
     struct core_entry *corep = __core_id_entry(CURRENT_CORE);
     register struct thread_entry *current = corep->running;
 
-    /* Cancel CPU boost if any */
+    /* Cancel CPU boost and demand if any */
     cancel_cpu_boost();
+    set_cpu_demand(0);
 
     disable_irq();
 
@@ -1498,6 +1531,7 @@ static inline void boost_thread(struct thread_entry *thread, bool boost)
     if ((thread->cpu_boost != 0) != boost)
     {
         thread->cpu_boost = boost;
+        SCHED_TRACE(SCHED_EV_BOOST, thread, boost);
         cpu_boost(boost);
     }
 }
@@ -1511,6 +1545,23 @@ void cancel_cpu_boost(void)
 {
     boost_thread(__running_self_entry(), false);
 }
+
+void set_cpu_demand(long cycles)
+{
+    struct thread_entry *current = __running_self_entry();
+    long old = current->cpu_demand;
+
+    if (cycles != old)
+    {
+        current->cpu_demand = cycles;
+        cpu_boost_demand(old, cycles);
+    }
+}
+
+long get_cpu_demand(void)
+{
+    return __running_self_entry()->cpu_demand;
+}
 #endif /* HAVE_SCHEDULER_BOOSTCTRL */
 
 /*---------------------------------------------------------------------------
@@ -1545,6 +1596,7 @@ void INIT_ATTR init_threads(void)
         struct core_entry *corep = __core_id_entry(core);
         core_rtr_add(corep, thread);
         corep->running = thread;
+        SCHED_TRACE(SCHED_EV_CREATE, thread, 0);
 
 #ifdef INIT_MAIN_THREAD
         init_main_thread(&thread->context);
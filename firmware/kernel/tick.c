@@ -19,6 +19,7 @@
  *
  ****************************************************************************/
 
+#include <string.h>
 #include "config.h"
 #include "tick.h"
 #include "general.h"
@@ -40,11 +41,117 @@ volatile long current_tick SHAREDDATA_ATTR = 0;
 /* - Timer initialization and interrupt handler is defined at
  * the target level: tick_start() is implemented in the target tree */
 
+/* Tasks that don't need every tick, run from a single tick task. Deadlines
+ * are rounded up to a multiple of the period so that tasks sharing a period
+ * wake the system together. */
+struct tick_task_period
+{
+    void (*fn)(void);
+    long next;                  /* tick of the next call */
+    int period;                 /* ticks between calls, 0 = on demand */
+    bool armed;                 /* next is valid */
+};
+
+/* How far ahead to look when no periodic task is armed */
+#define PERIODIC_IDLE   (60*HZ)
+
+static struct tick_task_period tick_periodic[MAX_NUM_TICK_TASKS];
+static int num_periodic;
+static long periodic_next;      /* earliest armed deadline */
+
+static long periodic_align(long tick, int period)
+{
+    if (period <= 1)
+        return tick + 1;
+
+    return tick + period - (unsigned long)tick % period;
+}
+
+static struct tick_task_period * find_periodic(void (*f)(void))
+{
+    for (int i = 0; i < num_periodic; i++)
+    {
+        if (tick_periodic[i].fn == f)
+            return &tick_periodic[i];
+    }
+
+    return NULL;
+}
+
+static void periodic_update(void)
+{
+    long next = current_tick + PERIODIC_IDLE;
+
+    for (int i = 0; i < num_periodic; i++)
+    {
+        struct tick_task_period *t = &tick_periodic[i];
+        if (t->armed && TIME_BEFORE(t->next, next))
+            next = t->next;
+    }
+
+    periodic_next = next;
+}
+
+static void periodic_tick(void)
+{
+    const long tick = current_tick;
+
+    if (TIME_BEFORE(tick, periodic_next))
+        return;
+
+    for (int i = 0; i < num_periodic;)
+    {
+        struct tick_task_period *t = &tick_periodic[i];
+        void (*fn)(void) = t->fn;
+
+        if (t->armed && !TIME_BEFORE(tick, t->next))
+        {
+            /* Reload first, the task may change its own schedule */
+            if (t->period > 0)
+                t->next = periodic_align(tick, t->period);
+            else
+                t->armed = false;
+
+            fn();
+
+            /* It removed itself: the next one has moved into this slot */
+            if (i >= num_periodic || tick_periodic[i].fn != fn)
+                continue;
+        }
+
+        i++;
+    }
+
+    periodic_update();
+}
+
+static int remove_periodic(void (*f)(void))
+{
+    struct tick_task_period *t = find_periodic(f);
+
+    if (t == NULL)
+        return -1;
+
+    int i = t - tick_periodic;
+    memmove(t, t + 1, (--num_periodic - i) * sizeof (*t));
+
+    if (num_periodic == 0)
+        remove_array_ptr((void **)tick_funcs, periodic_tick);
+    else
+        periodic_update();
+
+    return i;
+}
+
 int tick_add_task(void (*f)(void))
 {
     int oldlevel = disable_irq_save();
     void **arr = (void **)tick_funcs;
-    void **p = find_array_ptr(arr, f);
+    void **p;
+
+    /* Back to every tick if it had a period */
+    remove_periodic(f);
+    p = find_array_ptr(arr, f);
 
     /* Add a task if there is room */
     if(p - arr < MAX_NUM_TICK_TASKS)
@@ -64,10 +171,130 @@ int tick_remove_task(void (*f)(void))
 {
     int oldlevel = disable_irq_save();
     int rc = remove_array_ptr((void **)tick_funcs, f);
+
+    if (rc < 0)
+        rc = remove_periodic(f);
+
     restore_irq(oldlevel);
     return rc;
 }
 
+int tick_add_task_period(void (*f)(void), int period)
+{
+    int oldlevel = disable_irq_save();
+    struct tick_task_period *t = find_periodic(f);
+
+    if (t == NULL)
+    {
+        /* Moving from every tick to a period is allowed */
+        remove_array_ptr((void **)tick_funcs, f);
+
+        if (num_periodic >= MAX_NUM_TICK_TASKS)
+            panicf("Error! tick_add_task_period(): out of tasks");
+
+        if (num_periodic == 0)
+            tick_add_task(periodic_tick);
+
+        t = &tick_periodic[num_periodic++];
+        t->fn = f;
+        t->period = -1;
+    }
+
+    if (t->period != period)
+    {
+        t->period = period;
+        t->armed = period > 0;
+        t->next = periodic_align(current_tick, period);
+        periodic_update();
+    }
+
+    restore_irq(oldlevel);
+    return 0;
+}
+
+void tick_task_due(void (*f)(void), long tick)
+{
+    int oldlevel = disable_irq_save();
+    struct tick_task_period *t = find_periodic(f);
+
+    if (t != NULL && (!t->armed || TIME_BEFORE(tick, t->next)))
+    {
+        t->next = tick;
+        t->armed = true;
+        if (TIME_BEFORE(tick, periodic_next))
+            periodic_next = tick;
+    }
+
+    restore_irq(oldlevel);
+}
+
+long tick_next_due(void)
+{
+    void (**p)(void);
+    long ticks;
+
+    for (p = tick_funcs; *p != NULL; p++)
+    {
+        if (*p != periodic_tick)
+            return 1;
+    }
+
+    if (num_periodic == 0)
+        return PERIODIC_IDLE;
+
+    ticks = periodic_next - current_tick;
+    return ticks > 1 ? ticks : 1;
+}
+
+#ifdef HAVE_TICKLESS_IDLE
+static struct tick_idle_stats idle_stats;
+
+void tick_idle(long next_tmo)
+{
+    long ticks = tick_next_due();
+
+    if (TIME_BEFORE(next_tmo, current_tick + ticks))
+        ticks = next_tmo - current_tick;
+
+    if (ticks > TICK_IDLE_MAX)
+        ticks = TICK_IDLE_MAX;
+
+    /* Not worth stopping for less than a whole tick */
+    if (ticks < 2)
+    {
+        core_sleep();
+        return;
+    }
+
+    tick_idle_sleep(ticks);
+}
+
+void tick_idle_resume(long ticks, long elapsed)
+{
+    idle_stats.sleeps++;
+
+    if (elapsed < ticks)
+        idle_stats.early++;
+
+    if (elapsed > idle_stats.longest)
+        idle_stats.longest = elapsed;
+
+    if (elapsed <= 0)
+        return;
+
+    /* Nothing ran on the ticks in between; the periodic tasks compare
+     * against their deadlines so one call catches them all up */
+    current_tick += elapsed - 1;
+    idle_stats.skipped += elapsed - 1;
+    call_tick_tasks();
+}
+
+const struct tick_idle_stats * tick_get_idle_stats(void)
+{
+    return &idle_stats;
+}
+#endif /* HAVE_TICKLESS_IDLE */
+
 void init_tick(void)
 {
     tick_start(1000/HZ);
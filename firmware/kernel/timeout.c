@@ -16,6 +16,7 @@ static struct timeout *tmo_list[MAX_NUM_TIMEOUTS+1];
 
 /* timeout tick task - calls event handlers when they expire
  * Event handlers may alter expiration, callback and data during operation.
+ * It only runs when asked to with tick_task_due(), at the earliest expiry.
  */
 static void timeout_tick(void)
 {
@@ -41,6 +42,10 @@ static void timeout_tick(void)
             timeout_cancel(curr); /* cancel */
         }
     }
+
+    /* schedule the next one to expire */
+    for(p = tmo_list, curr = *p; curr != NULL; curr = *(++p))
+        tick_task_due(timeout_tick, curr->expires);
 }
 
 /* Cancels a timeout callback - can be called from the ISR */
@@ -82,7 +87,8 @@ void timeout_register(struct timeout *tmo, timeout_cb_type callback,
             /* Not present */
             if(*tmo_list == NULL)
             {
-                tick_add_task(timeout_tick); /* First one - add task */
+                /* First one - add task */
+                tick_add_task_period(timeout_tick, 0);
             }
 
             *p = tmo;
@@ -91,6 +97,7 @@ void timeout_register(struct timeout *tmo, timeout_cb_type callback,
         tmo->callback = callback;
         tmo->data = data;
         tmo->expires = current_tick + ticks;
+        tick_task_due(timeout_tick, tmo->expires);
     }
 
     restore_irq(oldlevel);
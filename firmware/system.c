@@ -36,10 +36,64 @@ long cpu_frequency SHAREDBSS_ATTR = CPU_FREQ;
 static int boost_counter SHAREDBSS_ATTR = 0;
 static bool cpu_idle SHAREDBSS_ATTR = false;
 
+/* The frequencies to choose from, lowest first */
+static const long freq_levels[CPU_FREQ_LEVELS] =
+{
+    CPUFREQ_DEFAULT, CPUFREQ_NORMAL, CPUFREQ_MAX
+};
+
+static struct cpu_freq_stats freq_stats SHAREDBSS_ATTR;
+static int freq_level SHAREDBSS_ATTR = -1;
+static long freq_level_tick SHAREDBSS_ATTR;
+static struct cpu_freq_decision freq_log[CPU_FREQ_LOG_SIZE] SHAREDBSS_ATTR;
+static int freq_log_next SHAREDBSS_ATTR;
+static int freq_log_count SHAREDBSS_ATTR;
+
 int get_cpu_boost_counter(void)
 {
     return boost_counter;
 }
+
+/* Pick the lowest frequency that covers the threads' declared demand with
+ * some headroom; a plain boost still goes all the way up. Called with the
+ * boost lock held. */
+static void cpu_freq_update(char reason)
+{
+    int level = cpu_idle ? 0 : 1;
+
+    if (boost_counter > 0)
+    {
+        level = CPU_FREQ_LEVELS - 1;
+    }
+    else
+    {
+        long need = freq_stats.demand + freq_stats.demand / CPU_DEMAND_HEADROOM;
+        while (level < CPU_FREQ_LEVELS - 1 && freq_levels[level] < need)
+            level++;
+    }
+
+    if (level == freq_level)
+        return;
+
+    if (freq_level >= 0)
+        freq_stats.level_ticks[freq_level] += current_tick - freq_level_tick;
+    freq_level = level;
+    freq_level_tick = current_tick;
+    freq_stats.changes++;
+
+    struct cpu_freq_decision *d = &freq_log[freq_log_next];
+    freq_log_next = (freq_log_next + 1) & (CPU_FREQ_LOG_SIZE - 1);
+    if (freq_log_count < CPU_FREQ_LOG_SIZE)
+        freq_log_count++;
+
+    d->tick = current_tick;
+    d->freq = freq_levels[level];
+    d->demand = freq_stats.demand;
+    d->boosts = MIN(boost_counter, 255);
+    d->reason = reason;
+
+    set_cpu_frequency(freq_levels[level]);
+}
 #ifdef CPU_BOOST_LOGGING
 #define MAX_BOOST_LOG 64
 static char cpu_boost_calls[MAX_BOOST_LOG][MAX_PATH];
@@ -117,23 +171,23 @@ void cpu_boost(bool on_off)
     {
         /* Boost the frequency if not already boosted */
         if(++boost_counter == 1)
-            set_cpu_frequency(CPUFREQ_MAX);
+        {
+            freq_stats.boosts++;
+            cpu_freq_update('B');
+        }
     }
     else
     {
         /* Lower the frequency if the counter reaches 0 */
         if(--boost_counter <= 0)
         {
-            if(cpu_idle)
-                set_cpu_frequency(CPUFREQ_DEFAULT);
-            else
-                set_cpu_frequency(CPUFREQ_NORMAL);
-
             /* Safety measure */
             if (boost_counter < 0)
             {
                 boost_counter = 0;
             }
+
+            cpu_freq_update('U');
         }
     }
 
@@ -149,15 +203,113 @@ void cpu_idle_mode(bool on_off)
 
     /* We need to adjust the frequency immediately if the CPU
        isn't boosted */
-    if(boost_counter == 0)
+    cpu_freq_update('I');
+
+    cpu_boost_unlock();
+}
+
+void cpu_boost_demand(long old_cycles, long new_cycles)
+{
+    if (!cpu_boost_lock())
+        return;
+
+    freq_stats.demand += new_cycles - old_cycles;
+    cpu_freq_update('D');
+
+    cpu_boost_unlock();
+}
+
+const struct cpu_freq_stats * cpu_freq_get_stats(void)
+{
+    /* bring the current level up to date */
+    if (freq_level >= 0)
     {
-        if(cpu_idle)
-            set_cpu_frequency(CPUFREQ_DEFAULT);
-        else
-            set_cpu_frequency(CPUFREQ_NORMAL);
+        freq_stats.level_ticks[freq_level] += current_tick - freq_level_tick;
+        freq_level_tick = current_tick;
     }
+    return &freq_stats;
+}
 
-    cpu_boost_unlock();
+const struct cpu_freq_decision * cpu_freq_get_decision(int n)
+{
+    if (n < 0 || n >= freq_log_count)
+        return NULL;
+
+    /* 0 is the most recent */
+    return &freq_log[(freq_log_next - 1 - n) & (CPU_FREQ_LOG_SIZE - 1)];
+}
+
+/* Measures busy time against the work done in it; once a window's worth of
+ * work is in, the thread's demand is set to what the recent windows predict */
+void cpu_demand_begin(struct cpu_demand_meter *m)
+{
+    if (!m->busy)
+    {
+        m->busy = true;
+        m->since = current_tick;
+    }
+
+    /* resuming after a pause: declare the last prediction again */
+    set_cpu_demand(m->predicted);
+}
+
+void cpu_demand_end(struct cpu_demand_meter *m)
+{
+    if (m->busy)
+    {
+        m->cycles += (uint64_t)(current_tick - m->since) * FREQ;
+        m->busy = false;
+    }
+}
+
+void cpu_demand_pause(struct cpu_demand_meter *m)
+{
+    cpu_demand_end(m);
+    set_cpu_demand(0);
+}
+
+void cpu_demand_work(struct cpu_demand_meter *m, long units, long rate)
+{
+    long demand, dev;
+
+    m->units += units;
+    if (rate <= 0 || m->units < rate * CPU_DEMAND_WINDOW)
+        return;
+
+    if (m->busy)
+    {
+        cpu_demand_end(m);
+        cpu_demand_begin(m);
+    }
+
+    /* busy cycles per tick for every 'rate' units = cycles per second */
+    demand = m->cycles * rate / HZ / m->units;
+
+    if (m->predicted == 0)
+    {
+        m->average = demand;
+        m->deviation = demand / 4;
+    }
+    else
+    {
+        dev = demand > m->average ? demand - m->average
+                                  : m->average - demand;
+        m->average += (demand - m->average) / 4;
+        m->deviation += (dev - m->deviation) / 4;
+    }
+
+    /* A sudden heavier stretch counts in full right away */
+    m->predicted = MAX(demand, m->average + 2 * m->deviation);
+    m->cycles = 0;
+    m->units = 0;
+
+    set_cpu_demand(m->predicted);
+}
+
+void cpu_demand_reset(struct cpu_demand_meter *m)
+{
+    memset(m, 0, sizeof (*m));
+    set_cpu_demand(0);
 }
 #endif /* HAVE_ADJUSTABLE_CPU_FREQ */
 
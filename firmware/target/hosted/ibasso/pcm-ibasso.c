@@ -22,11 +22,14 @@
  ****************************************************************************/
 
 
+#include <errno.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <unistd.h>
 
 #include "config.h"
+#include "system.h"
+#include "kernel.h"
 #include "debug.h"
 #include "panic.h"
 #include "pcm.h"
@@ -43,6 +46,14 @@
 static struct pcm* _alsa_handle = NULL;
 
 
+#ifdef HAVE_REALTIME_AUDIO
+/* Have pcm_write report underruns, the next write restarts the stream. */
+#define PCM_FLAGS (PCM_OUT | PCM_NORESTART)
+#else
+#define PCM_FLAGS PCM_OUT
+#endif
+
+
 /* Bytes left in the Rockbox PCM frame buffer. */
 static size_t _pcm_buffer_size = 0;
 
@@ -75,6 +86,10 @@ static void* pcm_thread_run(void* nothing)
 
     DEBUGF("DEBUG %s: Thread start.", __func__);
 
+#ifdef HAVE_REALTIME_AUDIO
+    rt_audio_thread(RT_THREAD_PCM, PRIORITY_REALTIME_1);
+#endif
+
     while(true)
     {
         pthread_mutex_lock(&_dma_suspended_mtx);
@@ -100,7 +115,16 @@ static void* pcm_thread_run(void* nothing)
         pcm_play_dma_status_callback(PCM_DMAST_STARTED);
 
         /* This relies on Rockbox PCM frame buffer size == ALSA PCM frame buffer size. */
-        if(pcm_write(_alsa_handle, _pcm_buffer, _pcm_buffer_size) != 0)
+        int err = pcm_write(_alsa_handle, _pcm_buffer, _pcm_buffer_size);
+#ifdef HAVE_REALTIME_AUDIO
+        if(err == -EPIPE)
+        {
+            /* Underrun, write the same buffer again right away. */
+            rt_audio_xrun(true);
+            continue;
+        }
+#endif
+        if(err != 0)
         {
             DEBUGF("ERROR %s: pcm_write failed: %s.", __func__, pcm_get_error(_alsa_handle));
 
@@ -318,7 +342,7 @@ void pcm_play_dma_init(void)
     _config.stop_threshold    = 0;
     _config.silence_threshold = 0;
 
-    _alsa_handle = pcm_open(CARD, DEVICE, PCM_OUT, &_config);
+    _alsa_handle = pcm_open(CARD, DEVICE, PCM_FLAGS, &_config);
     if(! pcm_is_ready(_alsa_handle))
     {
         DEBUGF("ERROR %s: pcm_open failed: %s.", __func__, pcm_get_error(_alsa_handle));
@@ -445,7 +469,7 @@ void pcm_dma_apply_settings(void)
         _config.rate = rate;
 
         pcm_close(_alsa_handle);
-        _alsa_handle = pcm_open(CARD, DEVICE, PCM_OUT, &_config);
+        _alsa_handle = pcm_open(CARD, DEVICE, PCM_FLAGS, &_config);
 
         if(! pcm_is_ready(_alsa_handle))
         {
@@ -19,6 +19,9 @@
  *
  ****************************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sched_setaffinity() with bionic */
+#endif
 
 #include <stdlib.h>
 #include <time.h>
@@ -26,6 +29,9 @@
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include "config.h"
 #include "system.h"
@@ -34,6 +40,7 @@
 #include "audio.h"
 #include "panic.h"
 #include "timer.h"
+#include "debug.h"
 
 
 static pthread_cond_t wfi_cond = PTHREAD_COND_INITIALIZER;
@@ -43,6 +50,16 @@ static pthread_mutex_t wfi_mtx = PTHREAD_MUTEX_INITIALIZER;
 void timer_signal(union sigval arg)
 {
     (void)arg;
+#ifdef HAVE_REALTIME_AUDIO
+    /* the C library may hand each expiry to a new thread */
+    static long tick_tid;
+    long tid = syscall(SYS_gettid);
+    if (tid != tick_tid)
+    {
+        tick_tid = tid;
+        rt_audio_thread(RT_THREAD_TICK, PRIORITY_REALTIME_2);
+    }
+#endif
     call_tick_tasks();
     interrupt();
 }
@@ -63,6 +80,100 @@ void interrupt(void)
     pthread_cond_signal(&wfi_cond);
 }
 
+#ifdef HAVE_REALTIME_AUDIO
+/* Rockbox priorities are spread over host priorities 1 to RT_PRIORITY_MAX,
+ * below the threaded interrupt handlers of the host kernel (50) */
+#define RT_PRIORITY_MAX 31
+
+static struct rt_audio_stats rt_stats;
+static struct
+{
+    const void *addr;
+    size_t size;
+} rt_locked[RT_NUM_BUFFERS];
+static bool rt_refused;
+
+static int rt_host_priority(int priority)
+{
+    return 1 + (LOWEST_PRIORITY - priority) * (RT_PRIORITY_MAX - 1) /
+               (LOWEST_PRIORITY - HIGHEST_PRIORITY);
+}
+
+/* the least busy core is usually the last one, the first takes the
+ * interrupts; a single core box isn't pinned at all */
+static int rt_pcm_cpu(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 1 ? cpus - 1 : -1;
+}
+
+void rt_audio_thread(enum rt_audio_thread which, int priority)
+{
+    struct sched_param param;
+    int policy = priority <= PRIORITY_REALTIME ? SCHED_FIFO : SCHED_RR;
+    int cpu = which == RT_THREAD_PCM ? rt_pcm_cpu() : -1;
+
+    rt_stats.thread[which].policy = "other";
+    rt_stats.thread[which].priority = 0;
+    rt_stats.thread[which].cpu = -1;
+
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        /* pid 0 is the calling thread here, not the whole process */
+        if (sched_setaffinity(0, sizeof(set), &set) == 0)
+            rt_stats.thread[which].cpu = cpu;
+    }
+
+    /* without CAP_SYS_NICE or a RLIMIT_RTPRIO, stop asking */
+    if (rt_refused)
+        return;
+
+    param.sched_priority = rt_host_priority(priority);
+    int err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err != 0)
+    {
+        DEBUGF("%s(%d): %s\n", __func__, which, strerror(err));
+        rt_refused = err == EPERM;
+        return;
+    }
+
+    rt_stats.thread[which].policy = policy == SCHED_FIFO ? "FIFO" : "RR";
+    rt_stats.thread[which].priority = param.sched_priority;
+}
+
+void rt_audio_lock(enum rt_audio_buffer which, const void *addr, size_t size)
+{
+    if (rt_locked[which].size)
+    {
+        munlock(rt_locked[which].addr, rt_locked[which].size);
+        rt_stats.locked -= rt_locked[which].size;
+        rt_locked[which].size = 0;
+    }
+
+    if (size == 0 || mlock(addr, size) != 0)
+        return;
+
+    rt_locked[which].addr = addr;
+    rt_locked[which].size = size;
+    rt_stats.locked += size;
+}
+
+void rt_audio_xrun(bool recovered)
+{
+    rt_stats.xruns++;
+    if (recovered)
+        rt_stats.recovered++;
+}
+
+const struct rt_audio_stats * rt_audio_get_stats(void)
+{
+    return &rt_stats;
+}
+#endif /* HAVE_REALTIME_AUDIO */
+
 
 /*
  * setup a hrtimer to send a signal to our process every tick
@@ -89,6 +200,11 @@ void tick_start(unsigned int interval_in_ms)
     ts.it_value.tv_sec = ts.it_interval.tv_sec = 0;
     ts.it_value.tv_nsec = ts.it_interval.tv_nsec = interval_in_ms*1000*1000;
 
+#ifdef HAVE_REALTIME_AUDIO
+    /* called on the thread that goes on to run the Rockbox threads */
+    rt_audio_thread(RT_THREAD_KERNEL, PRIORITY_PLAYBACK);
+#endif
+
     /* add the timer */
     ret |= timer_create(CLOCK_REALTIME, &sigev, &timerid);
     ret |= timer_settime(timerid, 0, &ts, NULL);
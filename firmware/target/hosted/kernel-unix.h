@@ -31,4 +31,49 @@
 void wait_for_interrupt(void);
 void interrupt(void);
 
+#ifdef HAVE_REALTIME_AUDIO
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Host threads on the audio path. Every Rockbox thread, the codec included,
+ * runs on the kernel thread, so that one gets the playback priority */
+enum rt_audio_thread
+{
+    RT_THREAD_KERNEL = 0,
+    RT_THREAD_TICK,         /* the tick timer's notify thread */
+    RT_THREAD_PCM,          /* the driver thread feeding ALSA */
+    RT_NUM_THREADS
+};
+
+/* Buffers kept resident, one region each */
+enum rt_audio_buffer
+{
+    RT_BUFFER_PCMBUF = 0,   /* the playback buffer, see pcmbuf_init() */
+    RT_BUFFER_DRIVER,       /* the driver's own bounce buffer */
+    RT_NUM_BUFFERS
+};
+
+struct rt_audio_stats
+{
+    struct
+    {
+        const char *policy; /* "other" when the host refused */
+        int priority;       /* host priority */
+        int cpu;            /* -1 unless pinned */
+    } thread[RT_NUM_THREADS];
+    size_t locked;          /* bytes locked into RAM */
+    unsigned long xruns;
+    unsigned long recovered;
+};
+
+/* Give the calling host thread the realtime priority corresponding to the
+ * Rockbox 'priority', pinning the PCM thread to a core of its own. Does
+ * nothing but record the refusal if the host doesn't allow it */
+void rt_audio_thread(enum rt_audio_thread which, int priority);
+/* Lock a buffer into RAM, unlocking whatever was locked for 'which' */
+void rt_audio_lock(enum rt_audio_buffer which, const void *addr, size_t size);
+void rt_audio_xrun(bool recovered);
+const struct rt_audio_stats * rt_audio_get_stats(void);
+#endif /* HAVE_REALTIME_AUDIO */
+
 #endif /* __KERNEL_UNIX_H__ */
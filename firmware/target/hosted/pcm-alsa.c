@@ -32,7 +32,9 @@
  * tick tasks are run from a signal handler too, please install
  * an alternative stack for it too.
  *
- * TODO: Rewrite this to do it properly with multithreading
+ * With HAVE_REALTIME_AUDIO, ALSA is fed from a host thread of its own
+ * instead, waiting in snd_pcm_wait(). Unlike a signal handler that thread
+ * can be given a realtime priority and a core, see rt_audio_thread().
  *
  * Alternatively, a version using polling in a tick task is provided. While
  * supposedly safer, it appears to use more CPU (however I didn't measure it
@@ -60,7 +62,11 @@
 #include <pthread.h>
 #include <signal.h>
 
+#ifdef HAVE_REALTIME_AUDIO
+#define USE_PCM_THREAD
+#else
 #define USE_ASYNC_CALLBACK
+#endif
 /* plughw:0,0 works with both, however "default" is recommended.
  * default doesnt seem to work with async callback but doesn't break
  * with multple applications running */
@@ -78,10 +84,18 @@ static short *frames;
 static const void  *pcm_data = 0;
 static size_t       pcm_size = 0;
 
+#if defined(USE_ASYNC_CALLBACK) || defined(USE_PCM_THREAD)
+static pthread_mutex_t pcm_mtx;
+#endif
+
 #ifdef USE_ASYNC_CALLBACK
 static snd_async_handler_t *ahandler;
-static pthread_mutex_t pcm_mtx;
 static char signal_stack[SIGSTKSZ];
+#elif defined(USE_PCM_THREAD)
+#define PCM_WAIT_MS 100 /* just in case ALSA never wakes us */
+static pthread_t pcm_thread;
+static pthread_cond_t pcm_cond = PTHREAD_COND_INITIALIZER;
+static bool stream_playing; /* protected by pcm_mtx */
 #else
 static int recursion;
 #endif
@@ -153,7 +167,13 @@ static int set_hwparams(snd_pcm_t *handle, unsigned sample_rate)
         goto error;
     }
     if (!frames)
+    {
         frames = malloc(period_size * channels * sizeof(short));
+#ifdef HAVE_REALTIME_AUDIO
+        rt_audio_lock(RT_BUFFER_DRIVER, frames,
+                      period_size * channels * sizeof(short));
+#endif
+    }
 
     /* write the parameters to device */
     err = snd_pcm_hw_params(handle, params);
@@ -245,41 +265,108 @@ static bool fill_frames(void)
     return true;
 }
 
-#ifdef USE_ASYNC_CALLBACK
-static void async_callback(snd_async_handler_t *ahandler)
-{
-    snd_pcm_t *handle = snd_async_handler_get_pcm(ahandler);
-
-    if (pthread_mutex_trylock(&pcm_mtx) != 0)
-        return;
-#else
-static void pcm_tick(void)
+/* an underrun stops the stream; prepare it again, the start threshold has
+ * it start once refilled */
+static bool recover_xrun(int err)
 {
-    if (snd_pcm_state(handle) != SND_PCM_STATE_RUNNING)
-        return;
+    err = snd_pcm_recover(handle, err, 1);
+#ifdef HAVE_REALTIME_AUDIO
+    rt_audio_xrun(err >= 0);
 #endif
+    if (err < 0)
+        DEBUGF("Recovery failed: %s\n", snd_strerror(err));
+    return err >= 0;
+}
 
-    while (snd_pcm_avail_update(handle) >= period_size)
+/* write periods for as long as ALSA has room, false if the stream broke */
+static bool write_frames(void)
+{
+    while (1)
     {
-        if (fill_frames())
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+
+        if (avail == -EPIPE || avail == -ESTRPIPE)
         {
-            int err = snd_pcm_writei(handle, frames, period_size);
-            if (err < 0 && err != period_size && err != -EAGAIN)
-            {
-                printf("Write error: written %i expected %li\n", err, period_size);
-                break;
-            }
+            if (!recover_xrun(avail))
+                return false;
+            continue;
+        }
+        else if (avail < 0)
+        {
+            return false;
         }
-        else
+
+        if (avail < period_size)
+            break;
+
+        if (!fill_frames())
         {
             DEBUGF("%s: No Data.\n", __func__);
             break;
         }
+
+        int err = snd_pcm_writei(handle, frames, period_size);
+        if (err == -EPIPE && recover_xrun(err))
+            err = snd_pcm_writei(handle, frames, period_size);
+
+        if (err < 0 && err != -EAGAIN)
+        {
+            printf("Write error: written %i expected %li\n", err, period_size);
+            break;
+        }
     }
+
+    return true;
+}
+
 #ifdef USE_ASYNC_CALLBACK
+static void async_callback(snd_async_handler_t *ahandler)
+{
+    (void)ahandler;
+
+    if (pthread_mutex_trylock(&pcm_mtx) != 0)
+        return;
+
+    write_frames();
+
     pthread_mutex_unlock(&pcm_mtx);
-#endif
 }
+#elif defined(USE_PCM_THREAD)
+static void * pcm_thread_run(void *arg)
+{
+    (void)arg;
+
+    rt_audio_thread(RT_THREAD_PCM, PRIORITY_REALTIME_1);
+
+    pthread_mutex_lock(&pcm_mtx);
+
+    while (1)
+    {
+        while (!stream_playing)
+            pthread_cond_wait(&pcm_cond, &pcm_mtx);
+
+        /* sleep until a period is free, without blocking pcm_play_lock() */
+        pthread_mutex_unlock(&pcm_mtx);
+        snd_pcm_wait(handle, PCM_WAIT_MS);
+        pthread_mutex_lock(&pcm_mtx);
+
+        /* an xrun shows up in write_frames() again */
+        if (stream_playing && !write_frames())
+            stream_playing = false;
+    }
+
+    return NULL;
+}
+#else
+static void pcm_tick(void)
+{
+    snd_pcm_state_t state = snd_pcm_state(handle);
+    if (state != SND_PCM_STATE_RUNNING && state != SND_PCM_STATE_XRUN)
+        return;
+
+    write_frames();
+}
+#endif
 
 static int async_rw(snd_pcm_t *handle)
 {
@@ -388,11 +475,18 @@ void pcm_play_dma_init(void)
 
     pcm_dma_apply_settings();
 
-#ifdef USE_ASYNC_CALLBACK
+#if defined(USE_ASYNC_CALLBACK) || defined(USE_PCM_THREAD)
     pthread_mutexattr_t attr;
     pthread_mutexattr_init(&attr);
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+#ifdef USE_PCM_THREAD
+    /* the kernel thread holding the lock runs at a lower priority */
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+#endif
     pthread_mutex_init(&pcm_mtx, &attr);
+#ifdef USE_PCM_THREAD
+    pthread_create(&pcm_thread, NULL, pcm_thread_run, NULL);
+#endif
 #else
     tick_add_task(pcm_tick);
 #endif
@@ -404,7 +498,7 @@ void pcm_play_dma_init(void)
 
 void pcm_play_lock(void)
 {
-#ifdef USE_ASYNC_CALLBACK
+#if defined(USE_ASYNC_CALLBACK) || defined(USE_PCM_THREAD)
     pthread_mutex_lock(&pcm_mtx);
 #else
     if (recursion++ == 0)
@@ -414,7 +508,7 @@ void pcm_play_lock(void)
 
 void pcm_play_unlock(void)
 {
-#ifdef USE_ASYNC_CALLBACK
+#if defined(USE_ASYNC_CALLBACK) || defined(USE_PCM_THREAD)
     pthread_mutex_unlock(&pcm_mtx);
 #else
     if (--recursion == 0)
@@ -439,12 +533,19 @@ void pcm_dma_apply_settings(void)
 void pcm_play_dma_pause(bool pause)
 {
     snd_pcm_pause(handle, pause);
+#ifdef USE_PCM_THREAD
+    stream_playing = !pause;
+    pthread_cond_signal(&pcm_cond);
+#endif
 }
 
 
 void pcm_play_dma_stop(void)
 {
     snd_pcm_drain(handle);
+#ifdef USE_PCM_THREAD
+    stream_playing = false;
+#endif
 }
 
 void pcm_play_dma_start(const void *addr, size_t size)
@@ -454,6 +555,11 @@ void pcm_play_dma_start(const void *addr, size_t size)
     pcm_data = addr;
     pcm_size = size;
 
+#ifdef USE_PCM_THREAD
+    stream_playing = true;
+    pthread_cond_signal(&pcm_cond);
+#endif
+
     while (1)
     {
         snd_pcm_state_t state = snd_pcm_state(handle);
@@ -462,13 +568,9 @@ void pcm_play_dma_start(const void *addr, size_t size)
             case SND_PCM_STATE_RUNNING:
                 return;
             case SND_PCM_STATE_XRUN:
-            {
                 DEBUGF("Trying to recover from error\n");
-                int err = snd_pcm_recover(handle, -EPIPE, 0);
-                if (err < 0)
-                    DEBUGF("Recovery failed: %s\n", snd_strerror(err));
+                recover_xrun(-EPIPE);
                 continue;
-            }
             case SND_PCM_STATE_SETUP:
             {
                 int err = snd_pcm_prepare(handle);
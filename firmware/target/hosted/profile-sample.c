@@ -0,0 +1,540 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Statistical profiler for hosted builds.
+ *
+ * ITIMER_PROF sends SIGPROF for every PROFILE_SAMPLE_HZ'th of a second of
+ * CPU time the process uses, to a thread that is using it. The handler
+ * takes the call stack with backtrace() and counts it in a hash table of
+ * distinct stacks, along with the Rockbox thread it belongs to. Host
+ * threads that aren't Rockbox threads (the SDL audio callback, timers)
+ * are counted as "host".
+ *
+ * Nothing is resolved while sampling. When sampling stops, addresses are
+ * looked up in the symbol tables of the executable and the loaded plugins
+ * and codecs, read from their ELF files. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* dladdr() */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <execinfo.h>
+#include <sys/time.h>
+#include "config.h"
+#include "system.h"
+#include "file.h"
+#include "profile.h"
+#include "../kernel-internal.h"
+
+#define SAMPLE_DEPTH    32      /* frames kept per sample */
+#define SAMPLE_SKIP     2       /* the handler and the signal trampoline */
+#define SAMPLE_STACKS   4096    /* distinct stacks, power of two */
+#define SAMPLE_PROBES   16
+
+#define SAMPLE_HOST     (-1)    /* not a Rockbox thread */
+#define SAMPLE_RUNNING  (-2)    /* whichever Rockbox thread is running */
+
+struct sample_stack
+{
+    uint32_t hash;
+    uint32_t count;             /* 0 for an empty entry */
+    int      slot;              /* thread slot or SAMPLE_HOST */
+    int      depth;
+    void    *pc[SAMPLE_DEPTH];  /* innermost first */
+};
+
+static struct sample_stack stacks[SAMPLE_STACKS];
+static unsigned long samples, samples_lost;
+static bool volatile sampling;
+static int handler_busy;
+static int profile_slot;            /* the thread that started sampling */
+
+/* Which Rockbox thread this host thread is, see profile_sample_thread() */
+static __thread int sample_slot = SAMPLE_HOST;
+
+/*
+ * Sampling
+ */
+
+static uint32_t hash_stack(int slot, void * const *pc, int depth)
+{
+    uint32_t hash = 2166136261u ^ slot;
+    for (int i = 0; i < depth; i++)
+        hash = (hash ^ (uint32_t)(uintptr_t)pc[i]) * 16777619u;
+    return hash;
+}
+
+static void sample_handler(int sig, siginfo_t *info, void *context)
+{
+    void *frames[SAMPLE_SKIP + SAMPLE_DEPTH];
+    int saved_errno = errno;
+    (void)sig; (void)info; (void)context;
+
+    /* A second thread can get a signal before the first one is done */
+    if (!sampling || __atomic_exchange_n(&handler_busy, 1, __ATOMIC_ACQUIRE))
+    {
+        samples_lost++;
+        goto out;
+    }
+
+    int slot = sample_slot;
+    if (slot == SAMPLE_RUNNING)
+        slot = THREAD_ID_SLOT(__running_self_entry()->id);
+
+    int depth = backtrace(frames, ARRAYLEN(frames)) - SAMPLE_SKIP;
+    if (depth <= 0)
+    {
+        samples_lost++;
+        goto unlock;
+    }
+
+    void **pc = frames + SAMPLE_SKIP;
+    uint32_t hash = hash_stack(slot, pc, depth);
+
+    for (unsigned int i = 0; i < SAMPLE_PROBES; i++)
+    {
+        struct sample_stack *s = &stacks[(hash + i) & (SAMPLE_STACKS - 1)];
+
+        if (s->count == 0)
+        {
+            s->hash = hash;
+            s->slot = slot;
+            s->depth = depth;
+            memcpy(s->pc, pc, depth * sizeof(*pc));
+        }
+        else if (s->hash != hash || s->slot != slot || s->depth != depth ||
+                 memcmp(s->pc, pc, depth * sizeof(*pc)))
+        {
+            continue;
+        }
+
+        s->count++;
+        samples++;
+        goto unlock;
+    }
+
+    samples_lost++; /* table full around here */
+unlock:
+    __atomic_store_n(&handler_busy, 0, __ATOMIC_RELEASE);
+out:
+    errno = saved_errno;
+}
+
+static void set_timer(bool on)
+{
+    struct itimerval tv;
+    tv.it_interval.tv_sec = 0;
+    tv.it_interval.tv_usec = on ? 1000000 / PROFILE_SAMPLE_HZ : 0;
+    tv.it_value = tv.it_interval;
+    setitimer(ITIMER_PROF, &tv, NULL);
+}
+
+void profile_sample_thread(int slot)
+{
+    sample_slot = slot;
+}
+
+bool profile_sample_start(void)
+{
+    struct sigaction sa;
+    void *warmup[1];
+
+    set_timer(false);
+    sampling = false;
+
+    memset(stacks, 0, sizeof(stacks));
+    samples = samples_lost = 0;
+
+#ifndef HAVE_SDL_THREADS
+    /* All Rockbox threads share this host thread */
+    profile_sample_thread(SAMPLE_RUNNING);
+#endif
+    profile_slot = THREAD_ID_SLOT(__running_self_entry()->id);
+
+    /* The first backtrace() loads the unwinder, which mustn't happen in
+     * the handler */
+    backtrace(warmup, 1);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = sample_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) < 0)
+        return false;
+
+    sampling = true;
+    set_timer(true);
+    return true;
+}
+
+/*
+ * Symbols
+ */
+
+struct sample_symbol
+{
+    uintptr_t addr;
+    uintptr_t size;
+    const char *name;
+};
+
+struct sample_module
+{
+    char *path;
+    const char *base_name;
+    uintptr_t load;             /* subtracted from addresses */
+    struct sample_symbol *syms;
+    size_t count;
+    char *strings;
+};
+
+#define SAMPLE_MODULES 64
+static struct sample_module modules[SAMPLE_MODULES];
+static int num_modules;
+
+static int cmp_symbol(const void *a, const void *b)
+{
+    const struct sample_symbol *x = a, *y = b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static void *read_at(FILE *f, long offset, size_t size)
+{
+    void *buf = malloc(size ?: 1);
+    if (buf && (fseek(f, offset, SEEK_SET) || fread(buf, 1, size, f) != size))
+    {
+        free(buf);
+        buf = NULL;
+    }
+    return buf;
+}
+
+/* Function symbols from .symtab, or .dynsym if the file is stripped */
+static void load_symbols(struct sample_module *m)
+{
+    ElfW(Ehdr) eh;
+    ElfW(Shdr) *sh = NULL;
+    ElfW(Sym) *syms = NULL;
+    FILE *f = fopen(m->path, "rb");
+
+    if (!f)
+        return;
+    if (fread(&eh, sizeof(eh), 1, f) != 1 ||
+        memcmp(eh.e_ident, ELFMAG, SELFMAG) ||
+        eh.e_shentsize != sizeof(*sh))
+        goto out;
+
+    sh = read_at(f, eh.e_shoff, eh.e_shnum * sizeof(*sh));
+    if (!sh)
+        goto out;
+
+    int tab = -1;
+    for (int i = 0; i < eh.e_shnum; i++)
+    {
+        if (sh[i].sh_type == SHT_SYMTAB)
+            tab = i;
+        else if (sh[i].sh_type == SHT_DYNSYM && tab < 0)
+            tab = i;
+    }
+    if (tab < 0 || sh[tab].sh_link >= eh.e_shnum)
+        goto out;
+
+    size_t count = sh[tab].sh_size / sizeof(*syms);
+    syms = read_at(f, sh[tab].sh_offset, sh[tab].sh_size);
+    m->strings = read_at(f, sh[sh[tab].sh_link].sh_offset,
+                         sh[sh[tab].sh_link].sh_size);
+    m->syms = malloc(count * sizeof(*m->syms) ?: 1);
+    if (!syms || !m->strings || !m->syms)
+        goto out;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC ||
+            syms[i].st_value == 0 ||
+            syms[i].st_name >= sh[sh[tab].sh_link].sh_size)
+            continue;
+
+        struct sample_symbol *s = &m->syms[m->count++];
+        s->addr = syms[i].st_value;
+        s->size = syms[i].st_size;
+        s->name = m->strings + syms[i].st_name;
+    }
+
+    qsort(m->syms, m->count, sizeof(*m->syms), cmp_symbol);
+out:
+    free(syms);
+    free(sh);
+    fclose(f);
+}
+
+static struct sample_module *find_module(void *pc, uintptr_t *addr)
+{
+    Dl_info info;
+
+    if (!dladdr(pc, &info) || !info.dli_fname)
+        return NULL;
+
+    for (int i = 0; i < num_modules; i++)
+    {
+        if (!strcmp(modules[i].path, info.dli_fname))
+        {
+            *addr = (uintptr_t)pc - modules[i].load;
+            return &modules[i];
+        }
+    }
+
+    if (num_modules == SAMPLE_MODULES)
+        return NULL;
+
+    struct sample_module *m = &modules[num_modules++];
+    const ElfW(Ehdr) *eh = info.dli_fbase;
+
+    m->path = strdup(info.dli_fname);
+    m->base_name = strrchr(m->path, '/') ? strrchr(m->path, '/') + 1 : m->path;
+    /* Position independent code is linked at 0 */
+    m->load = eh->e_type == ET_DYN ? (uintptr_t)info.dli_fbase : 0;
+    load_symbols(m);
+
+    *addr = (uintptr_t)pc - m->load;
+    return m;
+}
+
+/* The function containing pc: its address as in the file and its name,
+ * or just the address as in the file if there's no symbol for it */
+static uintptr_t resolve(void *pc, const char **name, const char **module)
+{
+    uintptr_t addr = (uintptr_t)pc;
+    struct sample_module *m = find_module(pc, &addr);
+
+    *name = NULL;
+    *module = m ? m->base_name : "?";
+    if (!m || !m->count)
+        return addr;
+
+    size_t lo = 0, hi = m->count;
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (m->syms[mid].addr <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const struct sample_symbol *s = &m->syms[lo];
+    if (s->addr <= addr && (addr < s->addr + s->size || !s->size))
+    {
+        *name = s->name;
+        return s->addr;
+    }
+    return addr;
+}
+
+static void free_modules(void)
+{
+    for (int i = 0; i < num_modules; i++)
+    {
+        free(modules[i].path);
+        free(modules[i].syms);
+        free(modules[i].strings);
+    }
+    memset(modules, 0, sizeof(modules));
+    num_modules = 0;
+}
+
+/*
+ * Output
+ */
+
+struct sample_function
+{
+    uintptr_t addr;
+    unsigned long self;
+    unsigned long total;        /* samples with it anywhere on the stack */
+    unsigned long last;         /* last stack counted in total, + 1 */
+};
+
+static int cmp_function(const void *a, const void *b)
+{
+    const struct sample_function *x = a, *y = b;
+    return x->self < y->self ? 1 : x->self > y->self ? -1 :
+           x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+static const char *slot_name(int slot, char *buf, size_t size)
+{
+    struct thread_debug_info info;
+
+    if (slot == SAMPLE_HOST)
+        return "host";
+    if (thread_get_debug_info(slot, &info) > 0)
+        snprintf(buf, size, "%s", info.name);
+    else
+        snprintf(buf, size, "thread %d", slot);
+    return buf;
+}
+
+/* profile.out as profile.c writes it, with samples in place of ticks and
+ * inclusive samples in place of calls, so profile_reader.pl can read it */
+static int write_profile(const char *path)
+{
+    struct sample_function *funcs;
+    size_t num = 0, max = 1024;
+    unsigned long per_slot[MAXTHREADS + 1] = { 0 };
+
+    funcs = malloc(max * sizeof(*funcs));
+    if (!funcs)
+        return -1;
+
+    for (unsigned long i = 0; i < SAMPLE_STACKS; i++)
+    {
+        const struct sample_stack *s = &stacks[i];
+        if (!s->count)
+            continue;
+
+        per_slot[s->slot == SAMPLE_HOST ? MAXTHREADS : s->slot] += s->count;
+
+        for (int d = 0; d < s->depth; d++)
+        {
+            const char *name, *module;
+            uintptr_t addr = resolve(s->pc[d], &name, &module);
+            size_t f;
+
+            for (f = 0; f < num && funcs[f].addr != addr; f++);
+            if (f == num)
+            {
+                if (num == max)
+                {
+                    struct sample_function *n =
+                        realloc(funcs, (max *= 2) * sizeof(*funcs));
+                    if (!n)
+                        break;
+                    funcs = n;
+                }
+                funcs[num++] = (struct sample_function){ addr, 0, 0, 0 };
+            }
+
+            if (d == 0)
+                funcs[f].self += s->count;
+            if (funcs[f].last != i + 1) /* recursion counts once */
+            {
+                funcs[f].total += s->count;
+                funcs[f].last = i + 1;
+            }
+        }
+    }
+
+    qsort(funcs, num, sizeof(*funcs), cmp_function);
+
+    int fd = creat(path, 0666);
+    if (fd < 0)
+    {
+        free(funcs);
+        return -1;
+    }
+
+    fdprintf(fd, "Sampled at %d Hz: CALL_COUNT is samples in or below the "
+                 "function, TICKS samples in it.\n", PROFILE_SAMPLE_HZ);
+    fdprintf(fd, "PROFILE_THREAD\tPFDS_USED\n");
+    fdprintf(fd, "%08d\t%08d\n", profile_slot, (int)num);
+    fdprintf(fd, "FUNCTION_PC\tCALL_COUNT\tTICKS\t\tDEPTH\n");
+    for (size_t f = 0; f < num; f++)
+        fdprintf(fd, "0x%08lX\t%08ld\t%08ld\t%04d\n", (unsigned long)funcs[f].addr,
+                 funcs[f].total, funcs[f].self, 0);
+
+    fdprintf(fd, "SAMPLES\tLOST\n%lu\t%lu\n", samples, samples_lost);
+    fdprintf(fd, "THREAD\tSAMPLES\tNAME\n");
+    for (int slot = 0; slot <= MAXTHREADS; slot++)
+    {
+        char buf[32];
+        if (per_slot[slot])
+            fdprintf(fd, "%d\t%lu\t%s\n", slot, per_slot[slot],
+                     slot_name(slot < MAXTHREADS ? slot : SAMPLE_HOST,
+                               buf, sizeof(buf)));
+    }
+
+    close(fd);
+    free(funcs);
+    return 0;
+}
+
+/* One line per distinct stack, outermost frame first, for flamegraph.pl
+ * and friends */
+static int write_folded(const char *path)
+{
+    int fd = creat(path, 0666);
+    if (fd < 0)
+        return -1;
+
+    for (unsigned long i = 0; i < SAMPLE_STACKS; i++)
+    {
+        const struct sample_stack *s = &stacks[i];
+        char buf[32];
+
+        if (!s->count)
+            continue;
+
+        fdprintf(fd, "%s", slot_name(s->slot, buf, sizeof(buf)));
+        for (int d = s->depth - 1; d >= 0; d--)
+        {
+            const char *name, *module;
+            uintptr_t addr = resolve(s->pc[d], &name, &module);
+            if (name)
+                fdprintf(fd, ";%s", name);
+            else
+                fdprintf(fd, ";%s+0x%lx", module, (unsigned long)addr);
+        }
+        fdprintf(fd, " %lu\n", (unsigned long)s->count);
+    }
+
+    close(fd);
+    return 0;
+}
+
+int profile_sample_stop(const char *name)
+{
+    char path[MAX_PATH];
+    int ret;
+
+    if (!sampling)
+        return -1;
+
+    set_timer(false);
+    sampling = false;
+    while (__atomic_load_n(&handler_busy, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    snprintf(path, sizeof(path), "/%s.out", name);
+    ret = write_profile(path);
+    snprintf(path, sizeof(path), "/%s.folded", name);
+    if (ret == 0)
+        ret = write_folded(path);
+
+    free_modules();
+    return ret < 0 ? -1 : (int)samples;
+}
@@ -22,6 +22,7 @@
 #include <math.h>
 #include <stdlib.h>         /* EXIT_SUCCESS */
 #include "sim-ui-defines.h"
+#include "lcd-sdl.h"
 #include "lcd-charcells.h"
 #ifdef HAVE_REMOTE_LCD
 #include "lcd-remote.h"
@@ -293,7 +294,7 @@ static bool event_handler(SDL_Event *event)
 void gui_message_loop(void)
 {
     SDL_Event event;
-    bool quit;
+    bool quit = false;
 
     do {
         /* wait for the next event */
@@ -302,6 +303,14 @@ void gui_message_loop(void)
             return; /* error, out of here */
         }
 
+        /* Window presents don't touch kernel state, keep them out of
+         * the interrupt context so threads aren't held up */
+        if (event.type == SDL_USEREVENT && event.user.code == LCD_SDL_PRESENT)
+        {
+            sdl_present();
+            continue;
+        }
+
         sim_enter_irq_handler();
         quit = event_handler(&event);
         sim_exit_irq_handler();
@@ -443,6 +452,11 @@ static void button_event(int key, bool pressed)
         btn |= new_btn;
     else
         btn &= ~new_btn;
+
+#ifdef HAVE_TICKLESS_IDLE
+    /* don't wait for the idle poll to notice */
+    button_wake();
+#endif
 }
 #if defined(HAVE_BUTTON_DATA)
 int button_read_device(int* data)
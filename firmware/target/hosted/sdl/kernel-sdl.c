@@ -39,6 +39,10 @@ long start_tick;
 static SDL_cond *wfi_cond;
 static SDL_mutex *wfi_mutex;
 #endif
+#ifdef HAVE_TICKLESS_IDLE
+/* Handlers run so far, to catch one that signalled before the wait */
+static unsigned int volatile handlers_run;
+#endif
 /* Condition to signal that "interrupts" may proceed */
 static SDL_cond *sim_thread_cond;
 /* Mutex to serialize changing levels and exclude other threads while
@@ -102,6 +106,9 @@ void sim_exit_irq_handler(void)
         SDL_CondSignal(sim_thread_cond);
 
     status_reg = 0;
+#ifdef HAVE_TICKLESS_IDLE
+    handlers_run++;
+#endif
     SDL_UnlockMutex(sim_irq_mtx);
 #ifndef HAVE_SDL_THREADS
     SDL_CondSignal(wfi_cond);
@@ -164,8 +171,9 @@ Uint32 tick_timer(Uint32 interval, void *param)
     (void) param;
     
     new_tick = (SDL_GetTicks() - start_tick) / (1000/HZ);
-        
-    while(new_tick != current_tick)
+
+    /* The idle thread may have caught up meanwhile */
+    while(TIME_BEFORE(current_tick, new_tick))
     {
         sim_enter_irq_handler();
 
@@ -203,6 +211,32 @@ void tick_start(unsigned int interval_in_ms)
 #endif
 }
 
+#ifdef HAVE_TICKLESS_IDLE
+void tick_idle_sleep(long ticks)
+{
+    unsigned int handlers = handlers_run;
+    long tick, elapsed;
+    Sint32 ms;
+
+    enable_irq();
+
+    SDL_RemoveTimer(tick_timer_id);
+
+    /* Sleep until the deadline unless some handler already ran */
+    tick = current_tick;
+    ms = start_tick + (tick + ticks) * (1000/HZ) - SDL_GetTicks();
+    if (handlers == handlers_run && ms > 0)
+        SDL_CondWaitTimeout(wfi_cond, wfi_mutex, ms);
+
+    sim_enter_irq_handler();
+    elapsed = (SDL_GetTicks() - start_tick) / (1000/HZ) - current_tick;
+    tick_idle_resume(ticks, elapsed);
+    sim_exit_irq_handler();
+
+    tick_timer_id = SDL_AddTimer(1000/HZ, tick_timer, NULL);
+}
+#endif /* HAVE_TICKLESS_IDLE */
+
 #ifndef HAVE_SDL_THREADS
 void wait_for_interrupt(void)
 {
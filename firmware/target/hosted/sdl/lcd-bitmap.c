@@ -119,8 +119,13 @@ static unsigned long get_lcd_pixel(int x, int y)
 
 void lcd_update(void)
 {
+#ifdef HAVE_LCD_DIRTY_RECT
+    /* only what was drawn since the last update */
+    lcd_update_dirty();
+#else
     /* update a full screen rect */
     lcd_update_rect(0, 0, LCD_WIDTH, LCD_HEIGHT);
+#endif
 }
 
 void lcd_update_rect(int x_start, int y_start, int width, int height)
@@ -140,6 +145,9 @@ void lcd_update_rect(int x_start, int y_start, int width, int height)
     sdl_gui_update(lcd_surface, x_start, y_start, width,
                    height + LCD_SPLIT_LINES, SIM_LCD_WIDTH, SIM_LCD_HEIGHT,
                    background ? UI_LCD_POSX : 0, background? UI_LCD_POSY : 0);
+#ifdef HAVE_LCD_DIRTY_RECT
+    lcd_rect_updated(x_start, y_start, width, height);
+#endif
 }
 
 #ifdef HAVE_BACKLIGHT
@@ -178,7 +186,8 @@ void lcd_init_device(void)
     lcd_surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
                                        SIM_LCD_WIDTH * display_zoom,
                                        SIM_LCD_HEIGHT * display_zoom,
-                                       LCD_DEPTH, 0, 0, 0, 0);
+                                       LCD_DEPTH, LCD_SDL_RMASK,
+                                       LCD_SDL_GMASK, LCD_SDL_BMASK, 0);
 #elif LCD_DEPTH <= 8
     lcd_surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
                                        SIM_LCD_WIDTH * display_zoom,
@@ -23,48 +23,96 @@
 #include "lcd-sdl.h"
 #include "sim-ui-defines.h"
 #include "system.h" /* for MIN() and MAX() */
+#include <stdio.h>
+#include <string.h>
 
 double display_zoom = 1;
+bool lcd_stats_enabled = false;
+int display_fps = 60;
+
+#if LCD_DEPTH >= 16 && !defined(LCD_STRIDEFORMAT) && !defined(HAVE_LCD_SPLIT) \
+    && !defined(HAVE_REMOTE_LCD)
+/* The framebuffer is copied straight into the surface, which is created
+ * with the same layout (LCD_SDL_*MASK) */
+#define SDL_LCD_DIRECT
+
+#if LCD_PIXELFORMAT == RGB565SWAPPED
+#define SDL_LCD_PIXEL(p) swap16(p)
+#else
+#define SDL_LCD_PIXEL(p) (p)
+#endif
+
+/* Copy a framebuffer rectangle into the surface, blowing every pixel up
+ * to zoom x zoom on the way. One pass, no intermediate surface. */
+static void sdl_copy_rect(SDL_Surface *surface, int x_start, int y_start,
+                          int width, int height, int zoom)
+{
+    const int pitch = surface->pitch;
+    int x, y, i;
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_LockSurface(surface);
+
+    for (y = y_start; y < y_start + height; y++)
+    {
+        const fb_data *src = FBADDR(x_start, y);
+        Uint8 *row = (Uint8 *)surface->pixels + y * zoom * pitch
+                     + x_start * zoom * sizeof(fb_data);
+        fb_data *dst = (fb_data *)row;
+
+#if LCD_PIXELFORMAT != RGB565SWAPPED
+        if (zoom == 1)
+        {
+            memcpy(dst, src, width * sizeof(fb_data));
+            continue;
+        }
+#endif
+        for (x = 0; x < width; x++)
+        {
+            fb_data p = SDL_LCD_PIXEL(src[x]);
+            for (i = 0; i < zoom; i++)
+                *dst++ = p;
+        }
+
+        for (i = 1; i < zoom; i++)
+            memcpy(row + i * pitch, row, width * zoom * sizeof(fb_data));
+    }
+
+    if (SDL_MUSTLOCK(surface))
+        SDL_UnlockSurface(surface);
+}
+
+#if LCD_PIXELFORMAT != RGB565SWAPPED
+/* Fractional zoom goes through SDL_SoftStretch, which wants a surface.
+ * Keep one around for the current framebuffer instead of creating it for
+ * every update. */
+static SDL_Surface *sdl_framebuffer_surface(void)
+{
+    static SDL_Surface *fb_surface = NULL;
+    static fb_data *fb_surface_data = NULL;
+
+    if (fb_surface_data != lcd_framebuffer)
+    {
+        if (fb_surface)
+            SDL_FreeSurface(fb_surface);
+        fb_surface = SDL_CreateRGBSurfaceFrom(lcd_framebuffer, LCD_FBWIDTH,
+                         LCD_FBHEIGHT, LCD_DEPTH, LCD_FBWIDTH * sizeof(fb_data),
+                         LCD_SDL_RMASK, LCD_SDL_GMASK, LCD_SDL_BMASK, 0);
+        fb_surface_data = lcd_framebuffer;
+    }
+    return fb_surface;
+}
+#endif
+#endif /* SDL_LCD_DIRECT */
 
 void sdl_update_rect(SDL_Surface *surface, int x_start, int y_start, int width,
                      int height, int max_x, int max_y,
                      unsigned long (*getpixel)(int, int))
 {
     SDL_Rect dest;
-#if LCD_DEPTH >= 8 && (LCD_PIXELFORMAT == RGB565) \
-    && !defined(LCD_STRIDEFORMAT) && !defined(HAVE_LCD_SPLIT) \
-    && !defined(HAVE_REMOTE_LCD)
-    SDL_Rect src;
-    (void)max_x;
-    (void)max_y;
-    (void)getpixel;
-    /* Update complete screen via one blit operation (fast) */
-    SDL_Surface *lcd = SDL_CreateRGBSurfaceFrom(lcd_framebuffer, LCD_FBWIDTH,
-                                                LCD_FBHEIGHT, LCD_DEPTH,
-                                                LCD_FBWIDTH * LCD_DEPTH/8,
-                                                0, 0, 0, 0);
-    src.x = x_start;
-    src.y = y_start;
-    src.w = width;
-    src.h = height;
-
-    if (display_zoom == 1) {
-        dest = src;
-        SDL_BlitSurface(lcd, &src, surface, &dest);
-    } else {
-        /* Note: SDL_SoftStretch is currently marked as DO NOT USE
-           but there are no real alternatives for efficent zooming. */
-        dest.x = src.x * display_zoom;
-        dest.y = src.y * display_zoom;
-        dest.w = src.w * display_zoom;
-        dest.h = src.h * display_zoom;
-        SDL_SoftStretch(lcd, &src, surface, &dest);
-    }
-    SDL_FreeSurface(lcd);
-#else
     int x, y;
     int xmax, ymax;
-    /* Very slow pixel-by-pixel drawing */
+
     ymax = y_start + height;
     xmax = x_start + width;
 
@@ -73,6 +121,32 @@ void sdl_update_rect(SDL_Surface *surface, int x_start, int y_start, int width,
     if(ymax >= max_y)
         ymax = max_y;
 
+#ifdef SDL_LCD_DIRECT
+    if (display_zoom == (int)display_zoom)
+    {
+        if (x_start < xmax && y_start < ymax)
+            sdl_copy_rect(surface, x_start, y_start, xmax - x_start,
+                          ymax - y_start, display_zoom);
+        return;
+    }
+#if LCD_PIXELFORMAT != RGB565SWAPPED
+    else
+    {
+        /* Note: SDL_SoftStretch is currently marked as DO NOT USE
+           but there are no real alternatives for efficent zooming. */
+        SDL_Rect src = { x_start, y_start, xmax - x_start, ymax - y_start };
+        dest.x = src.x * display_zoom;
+        dest.y = src.y * display_zoom;
+        dest.w = src.w * display_zoom;
+        dest.h = src.h * display_zoom;
+        SDL_SoftStretch(sdl_framebuffer_surface(), &src,
+                        surface, &dest);
+        return;
+    }
+#endif
+#endif /* SDL_LCD_DIRECT */
+
+    /* Very slow pixel-by-pixel drawing */
     dest.w = display_zoom;
     dest.h = display_zoom;
 
@@ -98,7 +172,144 @@ void sdl_update_rect(SDL_Surface *surface, int x_start, int y_start, int width,
         }
 #endif
     }
-#endif
+}
+
+/* Print how often and how much the window is updated, once a second */
+static void sdl_lcd_stats(int bytes)
+{
+    static Uint32 start = 0;
+    static unsigned long updates = 0, total = 0;
+    Uint32 now = SDL_GetTicks();
+
+    updates++;
+    total += bytes;
+    if (now - start >= 1000)
+    {
+        if (start)
+            printf("LCD: %lu updates/s, %lu KiB/s\n",
+                   updates * 1000 / (now - start),
+                   total / 1024 * 1000 / (now - start));
+        start = now;
+        updates = total = 0;
+    }
+}
+
+/*
+ * Window presentation.
+ *
+ * Drawing threads only blit into gui_surface and note the area here; the
+ * event thread pushes it to the window at most once per display frame
+ * (display_fps). Updates that come in between are folded into the same
+ * present. With display_fps == 0 every update goes out immediately.
+ */
+#define PRESENT_RECTS 8
+
+static SDL_mutex *present_mutex;
+static SDL_Rect present_rects[PRESENT_RECTS];
+static int present_count;          /* rectangles waiting in present_rects */
+static bool present_queued;        /* present event or timer outstanding */
+static Uint32 present_first;       /* when the oldest pending update came */
+static Uint32 present_last;        /* when the window was last updated */
+static struct lcd_frame_stats frame_stats;
+
+void sdl_present_init(void)
+{
+    present_mutex = SDL_CreateMutex();
+}
+
+const struct lcd_frame_stats *lcd_get_frame_stats(void)
+{
+    frame_stats.fps = display_fps;
+    return &frame_stats;
+}
+
+/* Power of two millisecond buckets: 0-1, 2-3, 4-7, ... */
+static void frame_hist_add(unsigned long *hist, Uint32 ms)
+{
+    int bucket = 0;
+
+    while (ms > 1 && bucket < LCD_FRAME_HIST_BUCKETS - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+    hist[bucket]++;
+}
+
+static void present_add_rect(const SDL_Rect *r)
+{
+    int i;
+
+    if (present_count < PRESENT_RECTS)
+    {
+        present_rects[present_count++] = *r;
+        return;
+    }
+
+    /* Out of slots, send the bounding box of everything instead */
+    int x1 = r->x, y1 = r->y, x2 = r->x + r->w, y2 = r->y + r->h;
+    for (i = 0; i < present_count; i++)
+    {
+        const SDL_Rect *p = &present_rects[i];
+        x1 = MIN(x1, p->x);
+        y1 = MIN(y1, p->y);
+        x2 = MAX(x2, p->x + p->w);
+        y2 = MAX(y2, p->y + p->h);
+    }
+    present_rects[0].x = x1;
+    present_rects[0].y = y1;
+    present_rects[0].w = x2 - x1;
+    present_rects[0].h = y2 - y1;
+    present_count = 1;
+}
+
+/* Called with present_mutex held */
+static void present_locked(void)
+{
+    Uint32 now = SDL_GetTicks();
+
+    present_queued = false;
+    if (present_count == 0)
+        return;
+
+    /* Without a real page flip only the changed area needs to go out */
+    if (gui_surface->flags & SDL_DOUBLEBUF)
+        SDL_Flip(gui_surface);
+    else
+        SDL_UpdateRects(gui_surface, present_count, present_rects);
+
+    if (frame_stats.frames)
+        frame_hist_add(frame_stats.frame_time, now - present_last);
+    frame_hist_add(frame_stats.latency, now - present_first);
+    frame_stats.frames++;
+
+    present_count = 0;
+    present_last = now;
+}
+
+static void present_post(void)
+{
+    SDL_Event event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    event.user.code = LCD_SDL_PRESENT;
+    SDL_PushEvent(&event);
+}
+
+static Uint32 present_timer(Uint32 interval, void *param)
+{
+    (void)interval; (void)param;
+    present_post();
+    return 0; /* one shot */
+}
+
+/* Event thread: put the pending updates on screen */
+void sdl_present(void)
+{
+    SDL_mutexP(present_mutex);
+    present_locked();
+    SDL_mutexV(present_mutex);
 }
 
 void sdl_gui_update(SDL_Surface *surface, int x_start, int y_start, int width,
@@ -114,13 +325,38 @@ void sdl_gui_update(SDL_Surface *surface, int x_start, int y_start, int width,
     SDL_Rect dest= {(ui_x + x_start) * display_zoom,
                     (ui_y + y_start) * display_zoom,
                     width * display_zoom, height * display_zoom};
+    Uint32 now = SDL_GetTicks();
+
+    SDL_mutexP(present_mutex);
 
     if (surface->flags & SDL_SRCALPHA) /* alpha needs a black background */
         SDL_FillRect(gui_surface, &dest, 0);
 
     SDL_BlitSurface(surface, &src, gui_surface, &dest);
 
-    SDL_Flip(gui_surface);
+    if (present_count == 0)
+        present_first = now;
+    present_add_rect(&dest);
+    frame_stats.requests++;
+
+    if (display_fps <= 0)
+        present_locked();
+    else if (!present_queued)
+    {
+        Uint32 period = 1000 / display_fps;
+        Sint32 wait = (Sint32)(present_last + period - now);
+
+        present_queued = true;
+        if (wait > 0 && SDL_AddTimer(wait, present_timer, NULL))
+            frame_stats.deferred++;
+        else
+            present_post();
+    }
+
+    SDL_mutexV(present_mutex);
+
+    if (lcd_stats_enabled)
+        sdl_lcd_stats(dest.w * dest.h * gui_surface->format->BytesPerPixel);
 }
 
 /* set a range of bitmap indices to a gradient from startcolour to endcolour */
@@ -28,6 +28,22 @@
 /* Default display zoom level */
 extern SDL_Surface *gui_surface;
 
+/* Layout of a framebuffer pixel, for the LCD surface the framebuffer is
+ * copied into (RGB565SWAPPED gets swapped on the way) */
+#if LCD_DEPTH == 16
+#define LCD_SDL_RMASK 0xf800
+#define LCD_SDL_GMASK 0x07e0
+#define LCD_SDL_BMASK 0x001f
+#elif LCD_DEPTH == 24 && SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define LCD_SDL_RMASK 0x0000ff
+#define LCD_SDL_GMASK 0x00ff00
+#define LCD_SDL_BMASK 0xff0000
+#elif LCD_DEPTH == 24
+#define LCD_SDL_RMASK 0xff0000
+#define LCD_SDL_GMASK 0x00ff00
+#define LCD_SDL_BMASK 0x0000ff
+#endif
+
 void sdl_update_rect(SDL_Surface *surface, int x_start, int y_start, int width,
                      int height, int max_x, int max_y,
                      unsigned long (*getpixel)(int, int));
@@ -35,6 +51,13 @@ void sdl_update_rect(SDL_Surface *surface, int x_start, int y_start, int width,
 void sdl_gui_update(SDL_Surface *surface, int x_start, int y_start, int width,
                     int height, int max_x, int max_y, int ui_x, int ui_y);
 
+/* SDL_USEREVENT code asking the event thread to present the window;
+ * code 0 is the shutdown request */
+#define LCD_SDL_PRESENT 1
+
+void sdl_present_init(void);
+void sdl_present(void);
+
 void sdl_set_gradient(SDL_Surface *surface, SDL_Color *start, SDL_Color *end,
                       int first, int steps);
 
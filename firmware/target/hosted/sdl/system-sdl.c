@@ -159,6 +159,8 @@ static int sdl_event_thread(void * param)
     if (background && picture_surface != NULL)
         SDL_BlitSurface(picture_surface, NULL, gui_surface, NULL);
 
+    sdl_present_init();
+
 #if (CONFIG_PLATFORM & PLATFORM_MAEMO)
     /* start maemo thread: Listen to display on/off events and battery monitoring */
     wait_for_maemo_startup = SDL_CreateSemaphore(0); /* 0-count so it blocks */
@@ -352,6 +354,16 @@ void sys_handle_argv(int argc, char *argv[])
                     display_zoom = 2;
                 printf("Window zoom is %d\n", display_zoom);
             }
+            else if (!strcmp("--fps", argv[x]))
+            {
+                x++;
+                if (x < argc)
+                    display_fps = atoi(argv[x]);
+                if (display_fps > 0)
+                    printf("Window refresh limited to %d fps\n", display_fps);
+                else
+                    printf("Window refresh not limited\n");
+            }
             else if (!strcmp("--alarm", argv[x]))
             {
                 sim_alarm_wakeup = true;
@@ -376,6 +388,11 @@ void sys_handle_argv(int argc, char *argv[])
                     debug_buttons = true;
                     printf("Printing background button clicks.\n");
             }
+            else if (!strcmp("--lcdstats", argv[x]))
+            {
+                    lcd_stats_enabled = true;
+                    printf("Printing LCD update rates.\n");
+            }
             else 
             {
                 printf("rockboxui\n");
@@ -390,9 +407,11 @@ void sys_handle_argv(int argc, char *argv[])
 #endif
                 printf("  --old_lcd \t [Player] simulate old playermodel (ROM version<4.51)\n");
                 printf("  --zoom [VAL]\t Window zoom (will disable backgrounds)\n");
+                printf("  --fps [VAL]\t Window refreshes per second, 0 for every update\n");
                 printf("  --alarm \t Simulate a wake-up on alarm\n");
                 printf("  --root [DIR]\t Set root directory\n");
                 printf("  --mapping \t Output coordinates and radius for mapping backgrounds\n");
+                printf("  --lcdstats \t Print LCD updates and bytes per second\n");
                 exit(0);
             }
         }
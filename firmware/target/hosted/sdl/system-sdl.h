@@ -61,6 +61,8 @@ void sdl_sys_quit(void);
 extern bool background;  /* True if the background image is enabled */
 extern bool showremote;
 extern double display_zoom;
+extern bool lcd_stats_enabled; /* Print LCD update rates */
+extern int display_fps; /* Window presents per second, 0 = unpaced */
 extern long start_tick;
 
 #endif /* _SYSTEM_SDL_H_ */
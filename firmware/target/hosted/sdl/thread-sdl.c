@@ -26,10 +26,14 @@
 #include <stdlib.h>
 #include <string.h> /* memset() */
 #include <setjmp.h>
+#include <sys/time.h>
 #include "system-sdl.h"
 #include "thread-sdl.h"
 #include "../kernel-internal.h"
 #include "core_alloc.h"
+#ifdef HAVE_SAMPLING_PROFILER
+#include "profile.h"
+#endif
 
 /* Define this as 1 to show informational messages that are not errors. */
 #define THREAD_SDL_DEBUGF_ENABLED 1
@@ -51,10 +55,101 @@ static char __name[sizeof (((struct thread_debug_info *)0)->name)];
  * in their start routines responding to messages so this is the only
  * way to get them back in there so they may exit */
 static jmp_buf thread_jmpbufs[MAXTHREADS];
-/* this mutex locks out other Rockbox threads while one runs,
- * that enables us to simulate a cooperative environment even if
- * the host is preemptive */
+/* The kernel lock keeps out other Rockbox threads while one runs, that
+ * enables us to simulate a cooperative environment even if the host is
+ * preemptive. It's a ticket lock so that it's handed out in the order
+ * threads asked for it; a plain host mutex lets a yielding thread take it
+ * straight back. m and turn only guard the ticket counters. */
 static SDL_mutex *m;
+static SDL_cond *turn;
+static unsigned int ticket_next, ticket_serving;
+
+/* Contention profile, per thread slot */
+static struct sim_lock_stats lock_stats[MAXTHREADS];
+static uint64_t lock_created[MAXTHREADS];  /* when the slot's thread started */
+static uint64_t lock_taken;                /* when the holder got the lock */
+#ifdef HAVE_SCHED_TRACE
+static unsigned int lock_last = SCHED_TRACE_IDLE; /* slot that had it last */
+#endif
+
+static uint64_t lock_clock(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* thread is NULL for callers outside the thread pool */
+static void kernel_lock(struct thread_entry *thread)
+{
+    uint64_t start = lock_clock();
+
+    SDL_LockMutex(m);
+    unsigned int ticket = ticket_next++;
+    bool contended = ticket != ticket_serving;
+    while (ticket != ticket_serving)
+        SDL_CondWait(turn, m);
+    SDL_UnlockMutex(m);
+
+    lock_taken = lock_clock();
+
+    if (thread != NULL)
+    {
+        struct sim_lock_stats *st = &lock_stats[THREAD_ID_SLOT(thread->id)];
+#ifdef HAVE_SCHED_TRACE
+        /* Holding the kernel lock is what running means here */
+        if (THREAD_ID_SLOT(thread->id) != lock_last)
+            sched_trace(SCHED_EV_SWITCH, THREAD_ID_SLOT(thread->id),
+                        lock_last);
+#endif
+        st->acquires++;
+        if (contended)
+        {
+            uint64_t wait = lock_taken - start;
+            st->contended++;
+            st->wait_us += wait;
+            if (wait > st->max_wait_us)
+                st->max_wait_us = wait;
+        }
+    }
+}
+
+static void kernel_unlock(struct thread_entry *thread)
+{
+    if (thread != NULL)
+        lock_stats[THREAD_ID_SLOT(thread->id)].hold_us +=
+            lock_clock() - lock_taken;
+
+#ifdef HAVE_SCHED_TRACE
+    lock_last = thread ? THREAD_ID_SLOT(thread->id) : SCHED_TRACE_IDLE;
+    /* Unlocked peek; a thread queueing right now just shows up as a
+     * switch out of idle */
+    if (thread != NULL && ticket_next == ticket_serving + 1)
+    {
+        sched_trace(SCHED_EV_IDLE, SCHED_TRACE_IDLE, lock_last);
+        lock_last = SCHED_TRACE_IDLE;
+    }
+#endif
+
+    SDL_LockMutex(m);
+    ticket_serving++;
+    SDL_CondBroadcast(turn);
+    SDL_UnlockMutex(m);
+}
+
+/* Called with the kernel lock held */
+int sim_thread_get_lock_stats(unsigned int slot, struct sim_lock_stats *stats)
+{
+    if (slot >= MAXTHREADS || __thread_slot_entry(slot)->context.s == NULL)
+        return 0;
+
+    *stats = lock_stats[slot];
+    stats->elapsed_us = lock_clock() - lock_created[slot];
+    /* The caller's own hold hasn't been added yet */
+    if (__thread_slot_entry(slot) == __running_self_entry())
+        stats->hold_us += lock_clock() - lock_taken;
+    return 1;
+}
 #define THREADS_RUN                 0
 #define THREADS_EXIT                1
 #define THREADS_EXIT_COMMAND_DONE   2
@@ -78,7 +173,7 @@ void sim_thread_shutdown(void)
     threads_status = THREADS_EXIT;
 
     /* Take control */
-    SDL_LockMutex(m);
+    kernel_lock(NULL);
 
     /* Signal all threads on delay or block */
     for (i = 0; i < MAXTHREADS; i++)
@@ -97,11 +192,11 @@ void sim_thread_shutdown(void)
 
         if (t != NULL)
         {
-            SDL_UnlockMutex(m);
+            kernel_unlock(NULL);
             /* Wait for it to finish */
             SDL_WaitThread(t, NULL);
             /* Relock for next thread signal */
-            SDL_LockMutex(m);
+            kernel_lock(NULL);
             /* Already waited and exiting thread would have waited .told,
              * replacing it with t. */
             thread->context.told = NULL;
@@ -117,7 +212,7 @@ void sim_thread_shutdown(void)
         }
     }
 
-    SDL_UnlockMutex(m);
+    kernel_unlock(NULL);
 
     /* Signal completion of operation */
     threads_status = THREADS_EXIT_COMMAND_DONE;
@@ -136,7 +231,7 @@ void sim_thread_exception_wait(void)
 /* A way to yield and leave the threading system for extended periods */
 void sim_thread_lock(void *me)
 {
-    SDL_LockMutex(m);
+    kernel_lock((struct thread_entry *)me);
     __running_self_entry() = (struct thread_entry *)me;
 
     if (threads_status != THREADS_RUN)
@@ -146,7 +241,7 @@ void sim_thread_lock(void *me)
 void * sim_thread_unlock(void)
 {
     struct thread_entry *current = __running_self_entry();
-    SDL_UnlockMutex(m);
+    kernel_unlock(current);
     return current;
 }
 
@@ -160,9 +255,9 @@ void switch_thread(void)
     {
     case STATE_RUNNING:
     {
-        SDL_UnlockMutex(m);
+        kernel_unlock(current);
         /* Any other thread waiting already will get it first */
-        SDL_LockMutex(m);
+        kernel_lock(current);
         break;
         } /* STATE_RUNNING: */
 
@@ -170,9 +265,9 @@ void switch_thread(void)
     {
         int oldlevel;
 
-        SDL_UnlockMutex(m);
+        kernel_unlock(current);
         SDL_SemWait(current->context.s);
-        SDL_LockMutex(m);
+        kernel_lock(current);
 
         oldlevel = disable_irq_save();
         current->state = STATE_RUNNING;
@@ -184,9 +279,9 @@ void switch_thread(void)
     {
         int result, oldlevel;
 
-        SDL_UnlockMutex(m);
+        kernel_unlock(current);
         result = SDL_SemWaitTimeout(current->context.s, current->tmo_tick);
-        SDL_LockMutex(m);
+        kernel_lock(current);
 
         oldlevel = disable_irq_save();
 
@@ -194,6 +289,7 @@ void switch_thread(void)
 
         if (result == SDL_MUTEX_TIMEDOUT)
         {
+            SCHED_TRACE(SCHED_EV_TIMEOUT, current, 0);
             /* Other signals from an explicit wake could have been made before
              * arriving here if we timed out waiting for the semaphore. Make
              * sure the count is reset. */
@@ -207,9 +303,10 @@ void switch_thread(void)
 
     case STATE_SLEEPING:
     {
-        SDL_UnlockMutex(m);
+        kernel_unlock(current);
         SDL_SemWaitTimeout(current->context.s, current->tmo_tick);
-        SDL_LockMutex(m);
+        kernel_lock(current);
+        SCHED_TRACE(SCHED_EV_TIMEOUT, current, 0);
         current->state = STATE_RUNNING;
         break;
         } /* STATE_SLEEPING: */
@@ -229,6 +326,7 @@ void sleep_thread(int ticks)
     struct thread_entry *current = __running_self_entry();
     int rem;
 
+    SCHED_TRACE_BLOCK(current, SCHED_BLOCK_SLEEP, ticks);
     current->state = STATE_SLEEPING;
 
     rem = (SDL_GetTicks() - start_tick) % (1000/HZ);
@@ -259,6 +357,9 @@ unsigned int wakeup_thread_(struct thread_entry *thread)
     case STATE_BLOCKED_W_TMO:
         wait_queue_remove(thread);
         thread->state = STATE_RUNNING;
+        SCHED_TRACE(SCHED_EV_WAKE, thread,
+                    ({ struct thread_entry *__w = __running_self_entry();
+                       __w ? THREAD_ID_SLOT(__w->id) : SCHED_TRACE_IDLE; }));
         SDL_SemPost(thread->context.s);
         return THREAD_OK;
     }
@@ -281,10 +382,13 @@ int runthread(void *data)
 {
     /* Cannot access thread variables before locking the mutex as the
        data structures may not be filled-in yet. */
-    SDL_LockMutex(m);
+    kernel_lock(NULL);
 
     struct thread_entry *current = (struct thread_entry *)data;
     __running_self_entry() = current;
+#ifdef HAVE_SAMPLING_PROFILER
+    profile_sample_thread(THREAD_ID_SLOT(current->id));
+#endif
 
     jmp_buf *current_jmpbuf = &thread_jmpbufs[THREAD_ID_SLOT(current->id)];
 
@@ -294,9 +398,9 @@ int runthread(void *data)
         /* Run the thread routine */
         if (current->state == STATE_FROZEN)
         {
-            SDL_UnlockMutex(m);
+            kernel_unlock(current);
             SDL_SemWait(current->context.s);
-            SDL_LockMutex(m);
+            kernel_lock(current);
             __running_self_entry() = current;
         }
 
@@ -313,8 +417,8 @@ int runthread(void *data)
     }
     else
     {
-        /* Unlock and exit */
-        SDL_UnlockMutex(m);
+        /* Unlock and exit - the slot may already belong to someone else */
+        kernel_unlock(NULL);
     }
 
     return 0;
@@ -355,6 +459,11 @@ unsigned int create_thread(void (*function)(void),
     thread->context.t = t;
     thread->context.s = s;
 
+    memset(&lock_stats[THREAD_ID_SLOT(thread->id)], 0,
+           sizeof (struct sim_lock_stats));
+    lock_created[THREAD_ID_SLOT(thread->id)] = lock_clock();
+    SCHED_TRACE(SCHED_EV_CREATE, thread, 0);
+
     THREAD_SDL_DEBUGF("New Thread: %lu (%s)\n",
                       (unsigned long)thread->id,
                       THREAD_SDL_GET_NAME(thread));
@@ -414,6 +523,7 @@ void thread_wait(unsigned int thread_id)
 
     if (thread->id == thread_id && thread->state != STATE_KILLED)
     {
+        SCHED_TRACE_BLOCK(current, SCHED_BLOCK_THREAD, TIMEOUT_BLOCK);
         block_thread(current, TIMEOUT_BLOCK, &thread->queue);
         switch_thread();
     }
@@ -423,13 +533,16 @@ void thread_wait(unsigned int thread_id)
 void init_threads(void)
 {
     m = SDL_CreateMutex();
+    turn = SDL_CreateCond();
 
-    if (SDL_LockMutex(m) == -1)
+    if (m == NULL || turn == NULL)
     {
-        fprintf(stderr, "Couldn't lock mutex\n");
+        fprintf(stderr, "Couldn't create kernel lock\n");
         return;
     }
 
+    kernel_lock(NULL);
+
     thread_alloc_init();
 
     struct thread_entry *thread = thread_alloc();
@@ -447,6 +560,11 @@ void init_threads(void)
     thread->context.s = SDL_CreateSemaphore(0);
     thread->context.t = NULL; /* NULL for the implicit main thread */
     __running_self_entry() = thread;
+#ifdef HAVE_SAMPLING_PROFILER
+    profile_sample_thread(THREAD_ID_SLOT(thread->id));
+#endif
+    lock_created[THREAD_ID_SLOT(thread->id)] = lock_clock();
+    SCHED_TRACE(SCHED_EV_CREATE, thread, 0);
  
     if (thread->context.s == NULL)
     {
@@ -468,12 +586,13 @@ void init_threads(void)
         return;
     }
 
-    SDL_UnlockMutex(m);
+    kernel_unlock(NULL);
 
     /* Set to 'COMMAND_DONE' when other rockbox threads have exited. */
     while (threads_status < THREADS_EXIT_COMMAND_DONE)
         SDL_Delay(10);
 
+    SDL_DestroyCond(turn);
     SDL_DestroyMutex(m);
 
     /* We're the main thead - perform exit - doesn't return. */
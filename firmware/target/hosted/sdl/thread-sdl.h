@@ -23,7 +23,22 @@
 #define __THREADSDL_H__
 
 #ifdef HAVE_SDL_THREADS
+#include <stdint.h>
+
+/* How a thread slot's thread has been getting along with the kernel lock
+ * since it was created */
+struct sim_lock_stats
+{
+    unsigned long acquires;     /* times it took the lock */
+    unsigned long contended;    /* ...of which it had to queue for it */
+    uint64_t wait_us;           /* time spent queueing */
+    uint64_t hold_us;           /* time spent running with the lock */
+    uint64_t max_wait_us;       /* longest single wait */
+    uint64_t elapsed_us;        /* time since the thread was created */
+};
+
 /* extra thread functions that only apply when running on hosting platforms */
+int sim_thread_get_lock_stats(unsigned int slot, struct sim_lock_stats *stats);
 void sim_thread_lock(void *me);
 void * sim_thread_unlock(void);
 void sim_thread_exception_wait(void);
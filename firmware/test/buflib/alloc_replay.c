@@ -0,0 +1,558 @@
+/***************************************************************************
+*             __________               __   ___.
+*   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+*   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+*   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+*   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+*                     \/            \/     \/    \/            \/
+* $Id$
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+*
+****************************************************************************/
+
+/*
+ * Replays a core_alloc trace (debug menu -> "Dump allocation trace" on a
+ * build with the allocation trace developer option) through buflib.
+ *
+ * Reports peak use as logged, with and without the core_alloc_maximum()
+ * allocations that take whatever is left (the audio buffer, mostly),
+ * which named allocations make up the peak, and how fragmented the
+ * buffer was and how much compaction moved, both on the device and in
+ * the replay.
+ *
+ * Allocations that got all remaining memory replay the same way, and
+ * shrinks replay as the amount cut off at either end, so the log can be
+ * replayed into a different buffer size. Allocations logged as failed
+ * are tried and dropped again if they'd have fitted.
+ *
+ * Usage: alloc_replay [options] core_alloc_trace.txt
+ *   -s <bytes>  replay into a buffer of this size instead
+ *   -m          find the smallest buffer in which nothing new fails
+ *   -c <file>   write used/free/fragmentation after each event as CSV
+ *   -v          draw the buffer at the peak and at the end of the log
+ *
+ * The buflib debug output is on stderr, run with 2>/dev/null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "buflib.h"
+
+#define MAX_HANDLES     65536
+#define MAP_COLUMNS     64
+#define MAP_ROWS        16
+
+enum event { EV_ALLOC, EV_FAIL, EV_FREE, EV_SHRINK, EV_MOVE };
+
+struct trace_event
+{
+    long tick;
+    int event;
+    int handle;
+    size_t size;
+    size_t offset;
+    bool maximum, pinned;
+    char name[16];
+};
+
+/* A logged handle's state as of the current event */
+struct logged
+{
+    bool live;
+    bool maximum;
+    size_t size;
+    size_t offset;
+    int replay;                 /* handle in the replay */
+    const char *name;
+};
+
+struct replay_stats
+{
+    unsigned long failed;       /* failed here but not on the device */
+    unsigned long would_fit;    /* failed on the device but not here */
+    unsigned long moves;
+    unsigned long long moved;
+    double frag_max, frag_sum;
+};
+
+/* Live bytes per allocation name at the peak */
+struct name_total
+{
+    const char *name;
+    size_t bytes;
+    int count;
+};
+
+static struct trace_event *events;
+static long num_events, max_events;
+static long clock_hz = 100;
+static size_t logged_buffer;
+static unsigned long dropped;
+
+static struct logged logged[MAX_HANDLES];
+static size_t replay_size[MAX_HANDLES];
+static char replay_flags[MAX_HANDLES];   /* map character per replay handle */
+
+static struct buflib_context ctx;
+static struct replay_stats *stats;
+static FILE *csv;
+static bool draw_maps;
+
+static int move_callback(int handle, void* current, void* new)
+{
+    (void)current;(void)new;
+    stats->moves++;
+    stats->moved += replay_size[handle];
+    return BUFLIB_CB_OK;
+}
+
+static struct buflib_callbacks ops_move = {
+    .move_callback = move_callback,
+};
+
+static struct buflib_callbacks ops_pinned = {
+    .move_callback = NULL,
+};
+
+static int parse_event(const char *word)
+{
+    static const char * const names[] =
+        { "alloc", "fail", "free", "shrink", "move" };
+
+    for (unsigned int i = 0; i < sizeof(names)/sizeof(*names); i++)
+        if (!strcmp(word, names[i]))
+            return i;
+    return -1;
+}
+
+static bool read_trace(FILE *f)
+{
+    char line[256];
+    long lineno = 0;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        char word[16], flags[8], name[64] = "";
+        long tick;
+        int handle;
+        unsigned long size, offset;
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "buffer %zu", &logged_buffer) == 1 ||
+            sscanf(line, "clock %ld", &clock_hz) == 1 ||
+            sscanf(line, "dropped %lu", &dropped) == 1)
+            continue;
+
+        if (sscanf(line, "%ld %15s %d %lu %lu %7s %*s %63[^\n]", &tick, word,
+                   &handle, &size, &offset, flags, name) < 6 ||
+            parse_event(word) < 0 || handle < 0 || handle >= MAX_HANDLES)
+        {
+            fprintf(stderr, "line %ld: can't parse: %s", lineno, line);
+            return false;
+        }
+
+        if (num_events == max_events)
+        {
+            max_events = max_events ? max_events * 2 : 4096;
+            events = realloc(events, max_events * sizeof(*events));
+        }
+
+        struct trace_event *e = &events[num_events++];
+        e->tick = tick;
+        e->event = parse_event(word);
+        e->handle = handle;
+        e->size = size;
+        e->offset = offset;
+        e->maximum = strchr(flags, 'm') != NULL;
+        e->pinned = strchr(flags, 'p') != NULL;
+        snprintf(e->name, sizeof(e->name), "%s", strcmp(name, "-") ? name : "");
+    }
+
+    return true;
+}
+
+/* Free space in holes and at the end, and the largest piece of it, as
+ * they are without compacting */
+static void free_space(size_t *total, size_t *largest)
+{
+    union buflib_data *block;
+    size_t hole, end;
+
+    *total = *largest = 0;
+    for (block = ctx.buf_start; block < ctx.alloc_end; block += labs(block->val))
+    {
+        if (block->val < 0)
+        {
+            hole = -block->val * sizeof(union buflib_data);
+            *total += hole;
+            if (hole > *largest)
+                *largest = hole;
+        }
+    }
+
+    end = (ctx.last_handle - ctx.alloc_end) * sizeof(union buflib_data);
+    *total += end;
+    if (end > *largest)
+        *largest = end;
+}
+
+static void draw_map(FILE *out)
+{
+    size_t bytes = (char *)ctx.handle_table - (char *)ctx.buf_start;
+    size_t cell = (bytes + MAP_COLUMNS * MAP_ROWS - 1) / (MAP_COLUMNS * MAP_ROWS);
+    char map[MAP_ROWS][MAP_COLUMNS + 1];
+
+    memset(map, '.', sizeof(map));
+    for (union buflib_data *block = ctx.buf_start; block < ctx.alloc_end;
+         block += labs(block->val))
+    {
+        if (block->val < 0)
+            continue;
+
+        int handle = ctx.handle_table - block[1].handle;
+        size_t start = (char *)block - (char *)ctx.buf_start;
+        size_t end = start + block->val * sizeof(union buflib_data);
+
+        /* a cell shows what covers its middle */
+        for (size_t c = (start + cell / 2) / cell;
+             c * cell + cell / 2 < end && c < MAP_COLUMNS * MAP_ROWS; c++)
+            map[c / MAP_COLUMNS][c % MAP_COLUMNS] = replay_flags[handle];
+    }
+
+    fprintf(out, "  %zu bytes per character; # movable, X pinned, "
+                 "M maximum, . free\n", cell);
+    for (int row = 0; row < MAP_ROWS; row++)
+    {
+        map[row][MAP_COLUMNS] = '\0';
+        fprintf(out, "  |%s|\n", map[row]);
+    }
+}
+
+static int replay_alloc(const struct trace_event *e)
+{
+    struct buflib_callbacks *ops = e->pinned ? &ops_pinned : &ops_move;
+    size_t size = e->size;
+    int handle = e->maximum ?
+                 buflib_alloc_maximum(&ctx, e->name, &size, ops) :
+                 buflib_alloc_ex(&ctx, size, e->name, ops);
+
+    if (handle > 0 && handle < MAX_HANDLES)
+    {
+        replay_size[handle] = size;
+        replay_flags[handle] = e->maximum ? 'M' : e->pinned ? 'X' : '#';
+    }
+    return handle;
+}
+
+static int cmp_bytes(const void *a, const void *b)
+{
+    const struct name_total *x = a, *y = b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/* Cut the same amounts off the replayed allocation as the logged shrink
+ * did, which keeps working when the replay got less memory */
+static void replay_shrink(struct logged *l, const struct trace_event *e)
+{
+    size_t front = e->offset - l->offset;
+    size_t back = (l->offset + l->size) - (e->offset + e->size);
+    size_t size = replay_size[l->replay];
+    char *data = buflib_get_data(&ctx, l->replay);
+
+    if (front > size)
+        front = size;
+    size = size - front > back ? size - front - back : 0;
+
+    if (buflib_shrink(&ctx, l->replay, data + front, size))
+        replay_size[l->replay] = size;
+}
+
+/* Replay the whole log into a fresh buffer of the given size; with
+ * report set, describe the logged peak as well */
+static void replay(size_t bufsize, struct replay_stats *st, bool report)
+{
+    void *buf = malloc(bufsize);
+    size_t used = 0, used_fixed = 0, peak = 0, peak_fixed = 0;
+    long peak_event = -1;
+    char peak_map[MAP_ROWS * (MAP_COLUMNS + 8) + 128];
+
+    memset(st, 0, sizeof(*st));
+    memset(logged, 0, sizeof(logged));
+    stats = st;
+    buflib_init(&ctx, buf, bufsize);
+
+    for (long n = 0; n < num_events; n++)
+    {
+        const struct trace_event *e = &events[n];
+        struct logged *l = &logged[e->handle];
+        int handle;
+
+        switch (e->event)
+        {
+        case EV_ALLOC:
+            handle = replay_alloc(e);
+            if (handle <= 0)
+                st->failed++;
+            *l = (struct logged){ true, e->maximum, e->size, e->offset,
+                                  handle, e->name };
+            used += e->size;
+            if (!e->maximum)
+                used_fixed += e->size;
+            break;
+
+        case EV_FAIL:
+            handle = replay_alloc(e);
+            if (handle > 0)
+            {
+                st->would_fit++;
+                buflib_free(&ctx, handle);
+            }
+            break;
+
+        case EV_FREE:
+            if (!l->live)
+                break;
+            if (l->replay > 0)
+                buflib_free(&ctx, l->replay);
+            used -= l->size;
+            if (!l->maximum)
+                used_fixed -= l->size;
+            l->live = false;
+            break;
+
+        case EV_SHRINK:
+            if (!l->live)
+                break;
+            if (l->replay > 0)
+                replay_shrink(l, e);
+            used -= l->size - e->size;
+            if (!l->maximum)
+                used_fixed -= l->size - e->size;
+            l->size = e->size;
+            l->offset = e->offset;
+            break;
+
+        case EV_MOVE:
+            l->offset = e->offset;
+            break;
+        }
+
+        size_t total, largest;
+        free_space(&total, &largest);
+        double frag = total ? 100.0 * (total - largest) / total : 0;
+        st->frag_sum += frag;
+        if (frag > st->frag_max)
+            st->frag_max = frag;
+
+        if (csv)
+            fprintf(csv, "%ld,%.3f,%zu,%zu,%zu,%zu,%.2f\n", n,
+                    (double)e->tick / clock_hz, used, used_fixed, total,
+                    largest, frag);
+
+        if (used > peak)
+            peak = used;
+
+        if (used_fixed > peak_fixed)
+        {
+            peak_fixed = used_fixed;
+            peak_event = n;
+            if (report && draw_maps)
+            {
+                FILE *f = fmemopen(peak_map, sizeof(peak_map), "w");
+                draw_map(f);
+                fclose(f);
+            }
+        }
+    }
+
+    if (!report)
+        goto out;
+
+    printf("logged: peak %zu KiB, %zu KiB without maximum allocations "
+           "(event %ld, %.2f s)\n", peak >> 10, peak_fixed >> 10,
+           peak_event, peak_event >= 0 ?
+               (double)events[peak_event].tick / clock_hz : 0);
+
+    /* go through the log up to the peak once more for what was live */
+    if (peak_event >= 0)
+    {
+        static struct logged at_peak[MAX_HANDLES];
+        static struct name_total by_name[MAX_HANDLES];
+        int names = 0;
+
+        memset(at_peak, 0, sizeof(at_peak));
+        for (long n = 0; n <= peak_event; n++)
+        {
+            const struct trace_event *e = &events[n];
+            struct logged *l = &at_peak[e->handle];
+            if (e->event == EV_ALLOC)
+                *l = (struct logged){ true, e->maximum, e->size, 0, 0,
+                                      e->name };
+            else if (e->event == EV_FREE)
+                l->live = false;
+            else if (e->event == EV_SHRINK)
+                l->size = e->size;
+        }
+
+        for (int h = 0; h < MAX_HANDLES; h++)
+        {
+            if (!at_peak[h].live || at_peak[h].maximum)
+                continue;
+
+            int i;
+            for (i = 0; i < names; i++)
+                if (!strcmp(by_name[i].name, at_peak[h].name))
+                    break;
+            if (i == names)
+                by_name[names++].name = at_peak[h].name;
+            by_name[i].bytes += at_peak[h].size;
+            by_name[i].count++;
+        }
+
+        qsort(by_name, names, sizeof(*by_name), cmp_bytes);
+        printf("  %-12s %10s %6s\n", "name", "bytes", "count");
+        for (int i = 0; i < names; i++)
+            printf("  %-12s %10zu %6d\n", by_name[i].name, by_name[i].bytes,
+                   by_name[i].count);
+        if (draw_maps)
+            printf("%s", peak_map);
+    }
+
+    if (draw_maps)
+    {
+        printf("end of log:\n");
+        draw_map(stdout);
+    }
+
+out:
+    free(buf);
+}
+
+static bool fits(size_t bufsize)
+{
+    struct replay_stats st;
+    replay(bufsize, &st, false);
+    return st.failed == 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-s bytes] [-m] [-c file.csv] [-v] "
+                    "core_alloc_trace.txt\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    size_t bufsize = 0;
+    bool find_min = false;
+    const char *csv_name = NULL;
+    struct replay_stats st;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:mc:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': bufsize = strtoul(optarg, NULL, 0); break;
+        case 'm': find_min = true; break;
+        case 'c': csv_name = optarg; break;
+        case 'v': draw_maps = true; break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1)
+        usage(argv[0]);
+
+    FILE *f = fopen(argv[optind], "r");
+    if (!f)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    bool ok = read_trace(f);
+    fclose(f);
+    if (!ok || !logged_buffer)
+    {
+        fprintf(stderr, "%s: not a core_alloc trace\n", argv[optind]);
+        return 1;
+    }
+    if (!bufsize)
+        bufsize = logged_buffer;
+
+    unsigned long logged_moves = 0, logged_fails = 0;
+    unsigned long long logged_moved = 0;
+    for (long n = 0; n < num_events; n++)
+    {
+        if (events[n].event == EV_MOVE)
+        {
+            logged_moves++;
+            logged_moved += events[n].size;
+        }
+        else if (events[n].event == EV_FAIL)
+            logged_fails++;
+    }
+
+    printf("%ld events over %.2f s, %lu not logged, buffer %zu KiB\n",
+           num_events, num_events ? (double)(events[num_events - 1].tick -
+                                             events[0].tick) / clock_hz : 0,
+           dropped, logged_buffer >> 10);
+    printf("device: %lu failed allocations, %lu moves, %llu KiB moved\n",
+           logged_fails, logged_moves, logged_moved >> 10);
+
+    if (csv_name)
+    {
+        csv = fopen(csv_name, "w");
+        if (!csv)
+        {
+            perror(csv_name);
+            return 1;
+        }
+        fprintf(csv, "event,time,used,used_fixed,free,largest_free,frag\n");
+    }
+
+    replay(bufsize, &st, true);
+    if (csv)
+        fclose(csv);
+    csv = NULL;
+
+    printf("replay in %zu KiB: %lu new failures, %lu logged failures would "
+           "fit, %lu moves, %llu KiB moved\n", bufsize >> 10, st.failed,
+           st.would_fit, st.moves, st.moved >> 10);
+    printf("fragmentation: %.1f%% max, %.1f%% mean\n", st.frag_max,
+           num_events ? st.frag_sum / num_events : 0);
+
+    if (find_min)
+    {
+        /* 4k steps; the logged size is assumed to fit */
+        size_t lo = 0, hi = ((bufsize > logged_buffer ? bufsize : logged_buffer)
+                             + 4095) / 4096;
+        if (!fits(hi * 4096))
+            printf("doesn't fit in %zu KiB either\n", hi * 4);
+        else
+        {
+            while (hi - lo > 1)
+            {
+                size_t mid = (lo + hi) / 2;
+                if (fits(mid * 4096))
+                    hi = mid;
+                else
+                    lo = mid;
+            }
+            printf("smallest buffer without new failures: %zu KiB\n", hi * 4);
+        }
+    }
+
+    return st.failed ? 2 : 0;
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+*             __________               __   ___.
+*   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+*   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+*   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+*   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+*                     \/            \/     \/    \/            \/
+* $Id$
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+*
+****************************************************************************/
+
+/*
+ * Fragmentation and throughput benchmark: a long run of allocations and
+ * frees of mixed sizes (16 bytes to 32k, mostly small), a tenth of them
+ * unmovable, keeping the buffer around three quarters full. Every
+ * allocation is filled with a pattern that is checked when it's freed, so
+ * this fails if a move or shrink loses data.
+ *
+ * The buflib debug output is on stderr, run as ./test_frag 2>/dev/null
+ * Optional argument: number of operations
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "buflib.h"
+
+#define BUFLIB_BUFFER_SIZE (2<<20)
+#define MAX_ALLOCS 4096
+
+static char buflib_buffer[BUFLIB_BUFFER_SIZE];
+static struct buflib_context ctx;
+
+static struct
+{
+    int handle;
+    size_t size;
+    unsigned char fill;
+} allocs[MAX_ALLOCS];
+static int num_allocs;
+
+static size_t handle_size[MAX_ALLOCS * 2];
+static unsigned long moves, moved_bytes;
+
+static int move_callback(int handle, void* current, void* new)
+{
+    (void)current;(void)new;
+    moves++;
+    moved_bytes += handle_size[handle];
+    return BUFLIB_CB_OK;
+}
+
+static struct buflib_callbacks ops_move = {
+    .move_callback = move_callback,
+};
+
+static struct buflib_callbacks ops_no_move = {
+    .move_callback = NULL,
+};
+
+static size_t random_size(void)
+{
+    /* roughly log-uniform, which is what core_alloc sees */
+    int bits = 4 + rand() % 12;
+    return (1 << bits) + rand() % (1 << bits);
+}
+
+static bool check(int i)
+{
+    unsigned char *data = buflib_get_data(&ctx, allocs[i].handle);
+    size_t size = allocs[i].size;
+    return data[0] == allocs[i].fill && data[size / 2] == allocs[i].fill
+        && data[size - 1] == allocs[i].fill;
+}
+
+int main(int argc, char **argv)
+{
+    long ops = argc > 1 ? atol(argv[1]) : 200000;
+    unsigned long allocs_done = 0, failed = 0;
+    size_t used = 0;
+    int ret = 0;
+
+    srand(1);
+    buflib_init(&ctx, buflib_buffer, BUFLIB_BUFFER_SIZE);
+
+    clock_t start = clock();
+
+    for (long n = 0; n < ops; n++)
+    {
+        /* grow towards the target fill level, then churn around it */
+        bool do_alloc = num_allocs == 0 ||
+                        (num_allocs < MAX_ALLOCS &&
+                         used < BUFLIB_BUFFER_SIZE * 3 / 4 && rand() % 3);
+
+        if (do_alloc)
+        {
+            size_t size = random_size();
+            bool fixed = rand() % 10 == 0;
+            int handle = buflib_alloc_ex(&ctx, size, fixed ? "fixed" : "var",
+                                         fixed ? &ops_no_move : &ops_move);
+            allocs_done++;
+
+            if (handle <= 0)
+            {
+                failed++;
+                continue;
+            }
+
+            allocs[num_allocs].handle = handle;
+            allocs[num_allocs].size = size;
+            allocs[num_allocs].fill = n;
+            memset(buflib_get_data(&ctx, handle), (unsigned char)n, size);
+            handle_size[handle] = size;
+            num_allocs++;
+            used += size;
+        }
+        else
+        {
+            int i = rand() % num_allocs;
+
+            if (!check(i))
+            {
+                printf("handle %d corrupted\n", allocs[i].handle);
+                ret = 1;
+            }
+
+            buflib_free(&ctx, allocs[i].handle);
+            used -= allocs[i].size;
+            allocs[i] = allocs[--num_allocs];
+        }
+    }
+
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    for (int i = 0; i < num_allocs; i++)
+    {
+        if (!check(i))
+        {
+            printf("handle %d corrupted\n", allocs[i].handle);
+            ret = 1;
+        }
+    }
+    buflib_check_valid(&ctx);
+
+    printf("%ld operations in %.3f s (%.0f/s)\n", ops, secs,
+           secs > 0 ? ops / secs : 0);
+    printf("%lu allocations, %lu failed\n", allocs_done, failed);
+    printf("%lu moves, %lu kiB moved\n", moves, moved_bytes >> 10);
+    printf("%d live, %zu kiB used, %zu kiB available, %zu kiB contiguous\n",
+           num_allocs, used >> 10, buflib_available(&ctx) >> 10,
+           buflib_allocatable(&ctx) >> 10);
+
+    return ret;
+}
@@ -0,0 +1,290 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Host microbenchmark for the event queue hand-off.
+ *
+ * Models a hosted kernel queue twice: "locked" takes a mutex for every
+ * post and wait, the way queue_post/queue_wait do when disabling
+ * "interrupts" means locking the simulator's irq mutex; "lockfree" uses
+ * the primitives from firmware/kernel/queue-lockfree.h and only falls
+ * back to the mutex to sleep and wake. A third thread keeps taking the
+ * mutex, like the tick and the audio callback do.
+ *
+ * For each variant and for one and three producers it reports:
+ *  - flood: messages per second with the consumer never idle
+ *  - wake:  post->wake latency of a consumer blocked on an empty queue
+ *
+ * make -f Makefile.bench && ./queue_bench [messages]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "queue-lockfree.h"
+
+#define QUEUE_LENGTH      16
+#define QUEUE_LENGTH_MASK (QUEUE_LENGTH - 1)
+#define MAX_PRODUCERS     3
+#define ID_QUIT           (-1)
+
+struct bench_event
+{
+    long     id;
+    intptr_t data;
+};
+
+struct bench_queue
+{
+    struct bench_event events[QUEUE_LENGTH];
+    unsigned int volatile read;
+    unsigned int volatile write;
+    unsigned int volatile ready[QUEUE_LENGTH];
+    bool volatile waiting;
+    bool lockfree;
+    pthread_mutex_t *lock;          /* stands in for the irq lock */
+    pthread_cond_t cond;
+};
+
+static pthread_mutex_t irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool volatile irq_quit;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_queue_init(struct bench_queue *q, bool lockfree)
+{
+    memset(q, 0, sizeof(*q));
+    for (unsigned int i = 0; i < QUEUE_LENGTH; i++)
+        q->ready[i] = i;
+    q->lockfree = lockfree;
+    q->lock = &irq_lock;
+    pthread_cond_init(&q->cond, NULL);
+}
+
+static void bench_post(struct bench_queue *q, long id, intptr_t data)
+{
+    if (q->lockfree)
+    {
+        unsigned int pos = lfq_reserve(&q->write);
+        unsigned int wr = pos & QUEUE_LENGTH_MASK;
+
+        q->events[wr].id = id;
+        q->events[wr].data = data;
+        lfq_publish(&q->ready[wr], pos);
+
+        if (lfq_waiter(&q->waiting))
+        {
+            pthread_mutex_lock(q->lock);
+            q->waiting = false;
+            pthread_cond_signal(&q->cond);
+            pthread_mutex_unlock(q->lock);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(q->lock);
+    unsigned int wr = q->write++ & QUEUE_LENGTH_MASK;
+    q->events[wr].id = id;
+    q->events[wr].data = data;
+    if (q->waiting)
+    {
+        q->waiting = false;
+        pthread_cond_signal(&q->cond);
+    }
+    pthread_mutex_unlock(q->lock);
+}
+
+static bool bench_fetch_lockfree(struct bench_queue *q, struct bench_event *ev)
+{
+    unsigned int rd = q->read;
+
+    while (lfq_ready(&q->ready[rd & QUEUE_LENGTH_MASK], rd))
+    {
+        struct bench_event e = q->events[rd & QUEUE_LENGTH_MASK];
+        if (lfq_claim(&q->read, &rd))
+        {
+            *ev = e;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void bench_wait(struct bench_queue *q, struct bench_event *ev)
+{
+    if (q->lockfree)
+    {
+        while (!bench_fetch_lockfree(q, ev))
+        {
+            pthread_mutex_lock(q->lock);
+            unsigned int rd = q->read;
+            lfq_check_in(&q->waiting);
+            if (!lfq_ready(&q->ready[rd & QUEUE_LENGTH_MASK], rd))
+                pthread_cond_wait(&q->cond, q->lock);
+            q->waiting = false;
+            pthread_mutex_unlock(q->lock);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(q->lock);
+    while (q->read == q->write)
+    {
+        q->waiting = true;
+        pthread_cond_wait(&q->cond, q->lock);
+    }
+    *ev = q->events[q->read++ & QUEUE_LENGTH_MASK];
+    pthread_mutex_unlock(q->lock);
+}
+
+/* Something else that disables "interrupts" now and then */
+static void * irq_thread(void *arg)
+{
+    (void)arg;
+    while (!irq_quit)
+    {
+        pthread_mutex_lock(&irq_lock);
+        for (volatile int i = 0; i < 200; i++);
+        pthread_mutex_unlock(&irq_lock);
+        usleep(100);
+    }
+    return NULL;
+}
+
+struct producer
+{
+    struct bench_queue *q;
+    pthread_t thread;
+    int producers;
+    long count;
+    bool paced;                     /* let the consumer block in between */
+};
+
+static void * producer_thread(void *arg)
+{
+    struct producer *p = arg;
+    struct bench_queue *q = p->q;
+
+    for (long n = 0; n < p->count; n++)
+    {
+        /* Never overflow: leave one slot per producer */
+        while (q->write - q->read >= (unsigned)(QUEUE_LENGTH - p->producers))
+            sched_yield();
+
+        if (p->paced)
+            usleep(50 + rand() % 50);
+
+        bench_post(q, 0, (intptr_t)now_ns());
+    }
+
+    bench_post(q, ID_QUIT, 0);
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const char *name, bool lockfree, int producers,
+                bool paced, long count)
+{
+    struct bench_queue q;
+    struct producer prod[MAX_PRODUCERS];
+    long total = count * producers;
+    uint64_t *lat = malloc(total * sizeof(*lat));
+    long got = 0;
+    int quits = 0;
+
+    bench_queue_init(&q, lockfree);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < producers; i++)
+    {
+        prod[i] = (struct producer){ &q, 0, producers, count, paced };
+        pthread_create(&prod[i].thread, NULL, producer_thread, &prod[i]);
+    }
+
+    while (quits < producers)
+    {
+        struct bench_event ev;
+        bench_wait(&q, &ev);
+
+        if (ev.id == ID_QUIT)
+            quits++;
+        else if (got < total)
+            lat[got++] = now_ns() - (uint64_t)ev.data;
+    }
+
+    uint64_t elapsed = now_ns() - start;
+
+    for (int i = 0; i < producers; i++)
+        pthread_join(prod[i].thread, NULL);
+
+    qsort(lat, got, sizeof(*lat), cmp_u64);
+
+    printf("%-9s %dP %-6s %9.0f msg/s  p50 %7.2f us  p99 %7.2f us  max %8.2f us%s\n",
+           name, producers, paced ? "wake" : "flood",
+           got * 1e9 / elapsed,
+           lat[got / 2] / 1000.0, lat[got * 99 / 100] / 1000.0,
+           lat[got - 1] / 1000.0,
+           got == total ? "" : "  LOST MESSAGES");
+
+    pthread_cond_destroy(&q.cond);
+    free(lat);
+}
+
+int main(int argc, char *argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 200000;
+    pthread_t irq;
+
+    if (count <= 0)
+    {
+        fprintf(stderr, "usage: %s [messages]\n", argv[0]);
+        return 1;
+    }
+
+    pthread_create(&irq, NULL, irq_thread, NULL);
+
+    for (int producers = 1; producers <= MAX_PRODUCERS; producers += 2)
+    {
+        run("locked", false, producers, false, count);
+        run("lockfree", true, producers, false, count);
+        /* a blocked consumer per message is slow; do fewer */
+        run("locked", false, producers, true, count / 50 + 1);
+        run("lockfree", true, producers, true, count / 50 + 1);
+    }
+
+    irq_quit = true;
+    pthread_join(irq, NULL);
+    return 0;
+}
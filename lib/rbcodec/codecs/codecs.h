@@ -72,7 +72,7 @@
 #define CODEC_ENC_MAGIC 0x52454E43 /* RENC */
 
 /* increase this every time the api struct changes */
-#define CODEC_API_VERSION 47
+#define CODEC_API_VERSION 48
 
 /* update this to latest version if a change to the api struct breaks
    backwards compatibility (and please take the opportunity to sort in any
@@ -218,6 +218,15 @@ struct codec_api {
 
     /* new stuff at the end, sort into place next time
        the API gets incompatible */
+
+    /* General purpose heaps on memory from codec_get_buffer(), see
+       apps/heap.h. Heaps still around are destroyed with the codec */
+    int (*heap_create)(const char *name, void *buf, size_t size);
+    void (*heap_destroy)(int heap);
+    void * (*heap_malloc)(int heap, size_t size);
+    void * (*heap_calloc)(int heap, size_t nmemb, size_t size);
+    void * (*heap_realloc)(int heap, void *ptr, size_t size);
+    void (*heap_free)(int heap, void *ptr);
 };
 
 /* codec header */
@@ -271,12 +280,18 @@ void codec_get_full_path(char *path, const char *codec_root_fn);
 
 /* Returns pointer to and size of free codec RAM */
 void *codec_get_buffer_callback(size_t *size);
+/* Creates a heap to be released along with the codec */
+int codec_heap_create(const char *name, void *buf, size_t size);
 
 /* defined by the codec loader (codec.c) */
 int codec_load_buf(int hid, struct codec_api *api);
 int codec_load_file(const char* codec, struct codec_api *api);
 int codec_run_proc(void);
 int codec_close(void);
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+int codec_preload_file(const char *codec);
+void codec_preload_discard(void);
+#endif
 #if CONFIG_CODEC == SWCODEC && defined(HAVE_RECORDING)
 enc_callback_t codec_get_enc_callback(void);
 #else
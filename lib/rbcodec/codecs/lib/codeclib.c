@@ -27,17 +27,20 @@
 #include "metadata.h"
 #include "dsp_proc_entry.h"
 
-/* The following variables are used by codec_malloc() to make use of free RAM
- * within the statically allocated codec buffer. */
-static size_t mem_ptr = 0;
+/* codec_malloc() puts a heap on the free RAM within the statically
+ * allocated codec buffer, the first time it is called for a track. Codecs
+ * managing that RAM themselves never get one. */
 static size_t bufsize = 0;
 static unsigned char* mallocbuf = NULL;
+static int heap = -1;
 
 int codec_init(void)
 {
-    /* codec_get_buffer() aligns the resulting point to CACHEALIGN_SIZE. */
-    mem_ptr = 0;
-    mallocbuf = (unsigned char *)ci->codec_get_buffer((size_t *)&bufsize);
+    if (heap >= 0)
+        ci->heap_destroy(heap);
+
+    heap = -1;
+    mallocbuf = (unsigned char *)ci->codec_get_buffer(&bufsize);
   
     return 0;
 }
@@ -58,46 +61,41 @@ void codec_set_replaygain(const struct mp3entry *id3)
 /* Various "helper functions" common to all the xxx2wav decoder plugins  */
 
 
-void* codec_malloc(size_t size)
+static bool heap_ready(void)
 {
-    void* x;
+    if (heap < 0 && mallocbuf != NULL)
+        heap = ci->heap_create("codec", mallocbuf, bufsize);
+
+    return heap >= 0;
+}
 
-    if (mem_ptr + (long)size > bufsize)
+void* codec_malloc(size_t size)
+{
+    if (!heap_ready())
         return NULL;
-    
-    x=&mallocbuf[mem_ptr];
-    
-    /* Keep memory aligned to CACHEALIGN_SIZE. */
-    mem_ptr += (size + (CACHEALIGN_SIZE-1)) & ~(CACHEALIGN_SIZE-1);
 
-    return(x);
+    return ci->heap_malloc(heap, size);
 }
 
 void* codec_calloc(size_t nmemb, size_t size)
 {
-    void* x;
-    x = codec_malloc(nmemb*size);
-    if (x == NULL)
+    if (!heap_ready())
         return NULL;
-    ci->memset(x,0,nmemb*size);
-    return(x);
+
+    return ci->heap_calloc(heap, nmemb, size);
 }
 
 void codec_free(void* ptr) {
-    (void)ptr;
+    if (heap >= 0)
+        ci->heap_free(heap, ptr);
 }
 
 void* codec_realloc(void* ptr, size_t size)
 {
-    void* x;
-    x = codec_malloc(size);
-    if (x == NULL)
+    if (!heap_ready())
         return NULL;
-    if (ptr) {
-        ci->memcpy(x, ptr, size);
-        codec_free(ptr);
-    }
-    return(x);
+
+    return ci->heap_realloc(heap, ptr, size);
 }
 
 #undef strlen
@@ -31,6 +31,7 @@
 
 #ifdef SBR_DEC
 
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -43,6 +44,9 @@
 
 /* type definitons */
 typedef struct {
+    /* A channel pair element processes one channel after the other, both
+     * use X_L. X_R is only needed by PS and is left out when that is not
+     * built. */
 #if (defined(PS_DEC) || defined(DRM_PS))
     /* In case of PS_DEC or DRM_PS we need larger buffer data when calling
      * ps_decode() or drm_ps_decode(). */
@@ -62,6 +66,10 @@ static XLR_t s_XLR IBSS_ATTR_FAAD_XLR MEM_ALIGN_ATTR;
 #endif
 #if defined(FAAD_STATIC_ALLOC)
 static sbr_info s_sbr[MAX_SYNTAX_ELEMENTS];
+static qmf_t s_Xsbr[MAX_SYNTAX_ELEMENTS][2][MAX_NTSRHFG][64] MEM_ALIGN_ATTR;
+#ifdef PS_DEC
+static ps_info s_ps[MAX_SYNTAX_ELEMENTS];
+#endif
 #endif
 #ifdef SBR_LOW_POWER
 static real_t deg[64] MEM_ALIGN_ATTR;
@@ -76,28 +84,68 @@ sbr_info *sbrDecodeInit(uint16_t framelength, uint8_t id_aac, uint8_t id_ele,
                         uint32_t sample_rate, uint8_t downSampledSBR, 
                         uint8_t IsDRM)
 {
+    /* Only a channel pair element needs the second channel's Xsbr and only
+     * a single channel element can carry PS data. */
+    const uint8_t nch = (id_aac == ID_CPE) ? 2 : 1;
+    /* p_XLR is shared by all elements, so it must fit whichever is decoded
+     * last, a single channel element with PS included. */
+#if (defined(PS_DEC) || defined(DRM_PS))
+    const size_t xlr_size = sizeof(XLR_t);
+#else
+    const size_t xlr_size = offsetof(XLR_t, X_R);
+#endif
+    uint8_t ch;
+
     (void)downSampledSBR;
 #ifndef DRM
     (void)IsDRM;
 #endif 
 
-    /* Allocate sbr_info. */
+    /* Allocate sbr_info, followed by Xsbr and ps_info for just the channels
+     * and tools this element can use. */
 #if defined(FAAD_STATIC_ALLOC)
     sbr_info *sbr = &s_sbr[id_ele];
+    memset(sbr, 0, sizeof(sbr_info));
+    for (ch = 0; ch < nch; ch++)
+        sbr->Xsbr[ch] = s_Xsbr[id_ele][ch];
+#ifdef PS_DEC
+    if (nch == 1)
+        sbr->ps = &s_ps[id_ele];
+#endif
 #else
+    size_t sbr_size = (sizeof(sbr_info) + 15) & ~15;
+    size_t size = sbr_size + nch * sizeof(qmf_t[MAX_NTSRHFG][64]);
+    uint8_t *mem;
+
     (void)id_ele;
-    sbr_info *sbr = (sbr_info*)faad_malloc(sizeof(sbr_info));
-    if (sbr == NULL)
+#ifdef PS_DEC
+    if (nch == 1)
+        size += sizeof(ps_info);
+#endif
+    mem = (uint8_t*)faad_malloc(size);
+    if (mem == NULL)
     {
         /* could not allocate memory */
         return NULL;
     }
-#endif
+    sbr_info *sbr = (sbr_info*)mem;
     memset(sbr, 0, sizeof(sbr_info));
-    
+    mem += sbr_size;
+    for (ch = 0; ch < nch; ch++)
+    {
+        sbr->Xsbr[ch] = (qmf_t (*)[64])mem;
+        mem += sizeof(qmf_t[MAX_NTSRHFG][64]);
+    }
+#ifdef PS_DEC
+    if (nch == 1)
+        sbr->ps = (ps_info*)mem;
+#endif
+#endif
+
 #ifdef PS_DEC
     /* initialize PS variables */
-    ps_init(&sbr->ps);
+    if (sbr->ps != NULL)
+        ps_init(sbr->ps);
 #endif
     
     /* Allocate XLR temporary variable. Use static allocation if either 
@@ -105,14 +153,14 @@ sbr_info *sbrDecodeInit(uint16_t framelength, uint8_t id_aac, uint8_t id_ele,
 #if defined(FAAD_STATIC_ALLOC) || defined(HAVE_FAAD_XLR_IN_IRAM)
     p_XLR  = &s_XLR;
 #else
-    p_XLR  = (XLR_t*)faad_malloc(sizeof(XLR_t));
+    p_XLR  = (XLR_t*)faad_malloc(xlr_size);
     if (p_XLR == NULL)
     {
         /* could not allocate memory */
         return NULL;
     }
 #endif
-    memset(p_XLR, 0, sizeof(XLR_t));
+    memset(p_XLR, 0, xlr_size);
 
     /* save id of the parent element */
     sbr->id_aac = id_aac;
@@ -162,8 +210,8 @@ sbr_info *sbrDecodeInit(uint16_t framelength, uint8_t id_aac, uint8_t id_ele,
     memset(sbr->qmfa, 0, 2*sizeof(qmfa_info));
     memset(sbr->qmfs, 0, 2*sizeof(qmfs_info));
 
-    memset(sbr->Xsbr[0], 0, (sbr->numTimeSlotsRate+sbr->tHFGen)*64 * sizeof(qmf_t));
-    memset(sbr->Xsbr[1], 0, (sbr->numTimeSlotsRate+sbr->tHFGen)*64 * sizeof(qmf_t));
+    for (ch = 0; ch < nch; ch++)
+        memset(sbr->Xsbr[ch], 0, (sbr->numTimeSlotsRate+sbr->tHFGen)*64 * sizeof(qmf_t));
 
     return sbr;
 }
@@ -397,13 +445,13 @@ uint8_t sbrDecodeCoupleFrame(sbr_info *sbr, real_t *left_chan, real_t *right_cha
         sbr_qmf_synthesis_64(sbr, &sbr->qmfs[0], p_XLR->X_L, left_chan);
     }
 
-    sbr_process_channel(sbr, right_chan, p_XLR->X_R, 1, dont_process, downSampledSBR);
+    sbr_process_channel(sbr, right_chan, p_XLR->X_L, 1, dont_process, downSampledSBR);
     /* subband synthesis */
     if (downSampledSBR)
     {
-        sbr_qmf_synthesis_32(sbr, &sbr->qmfs[1], p_XLR->X_R, right_chan);
+        sbr_qmf_synthesis_32(sbr, &sbr->qmfs[1], p_XLR->X_L, right_chan);
     } else {
-        sbr_qmf_synthesis_64(sbr, &sbr->qmfs[1], p_XLR->X_R, right_chan);
+        sbr_qmf_synthesis_64(sbr, &sbr->qmfs[1], p_XLR->X_L, right_chan);
     }
 
     if (sbr->bs_header_flag)
@@ -561,7 +609,7 @@ uint8_t sbrDecodeSingleFramePS(sbr_info *sbr, real_t *left_channel, real_t *righ
     } else {
 #endif
 #ifdef PS_DEC
-        ps_decode(&sbr->ps, p_XLR->X_L, p_XLR->X_R);
+        ps_decode(sbr->ps, p_XLR->X_L, p_XLR->X_R);
 #endif
 #ifdef DRM_PS
     }
@@ -161,7 +161,8 @@ typedef struct
     qmfa_info qmfa[2] MEM_ALIGN_ATTR;
     qmfs_info qmfs[2] MEM_ALIGN_ATTR;
 
-    qmf_t Xsbr[2][MAX_NTSRHFG][64] MEM_ALIGN_ATTR;
+    /* Xsbr[1] only exists for a channel pair element, see sbrDecodeInit() */
+    qmf_t (*Xsbr[2])[64];
 
 #ifdef DRM
     uint8_t Is_DRM_SBR;
@@ -176,7 +177,7 @@ typedef struct
     uint8_t tHFAdj;
 
 #ifdef PS_DEC
-    ps_info ps;
+    ps_info *ps; /* NULL for a channel pair element */
 #endif
 #if (defined(PS_DEC) || defined(DRM_PS))
     uint8_t ps_used;
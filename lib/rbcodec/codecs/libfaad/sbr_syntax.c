@@ -822,11 +822,21 @@ static uint16_t sbr_extension(bitfile *ld, sbr_info *sbr,
 #endif
 
     (void)num_bits_left;
+#ifdef PS_DEC
+    /* PS is only defined for a single channel element, a channel pair
+     * element has no ps_info to decode it into: skip it like unknown data */
+    if (bs_extension_id == EXTENSION_ID_PS && sbr->ps == NULL)
+    {
+        sbr->bs_extension_data = (uint8_t)faad_getbits(ld, 6
+            DEBUGVAR(1,279,"sbr_single_channel_element(): bs_extension_data"));
+        return 6;
+    }
+#endif
     switch (bs_extension_id)
     {
 #ifdef PS_DEC
     case EXTENSION_ID_PS:
-        ret = ps_data(&sbr->ps, ld, &header);
+        ret = ps_data(sbr->ps, ld, &header);
 
         /* enable PS if and only if: a header has been decoded */
         if (sbr->ps_used == 0 && header == 1)
@@ -155,6 +155,25 @@ uint32_t mad_bit_read(struct mad_bitptr *bitptr, unsigned int len)
   return 0;
 }
 
+# if defined(MAD_BIT_CACHE64)
+/*
+ * NAME:        bit->read_long()
+ * DESCRIPTION: read 1..57 bits and return their UIMSBF value
+ */
+unsigned long mad_bit_read_long(struct mad_bitptr *bitptr, unsigned int len)
+{
+  uint32_t *curr = &bitptr->ptr[bitptr->readbit>>5];
+  unsigned int shift = bitptr->readbit & 31;
+  uint64_t r = ((uint64_t)betoh32(curr[0]) << 32 | betoh32(curr[1])) << shift;
+
+  if(shift + len > 64)
+    r |= betoh32(curr[2]) >> (32 - shift);
+
+  bitptr->readbit += len;
+  return r >> (64 - len);
+}
+# endif
+
 # if 0 /* rockbox: not used */
 /*
  * NAME:        bit->write()
@@ -41,6 +41,11 @@ unsigned char const *mad_bit_nextbyte(struct mad_bitptr const *);
 
 void mad_bit_skip(struct mad_bitptr *, unsigned int);
 uint32_t mad_bit_read(struct mad_bitptr *, unsigned int);
+/* rockbox: 64-bit hosts refill the Layer III Huffman cache 57 bits at once */
+# if defined(__LP64__)
+#  define MAD_BIT_CACHE64
+unsigned long mad_bit_read_long(struct mad_bitptr *, unsigned int);
+# endif
 /* rockbox: not used
 void mad_bit_write(struct mad_bitptr *, unsigned int, uint32_t);
 */
@@ -27,7 +27,6 @@
 typedef   int32_t mad_fixed_t;
 
 typedef   int32_t mad_fixed64hi_t;
-typedef  uint32_t mad_fixed64lo_t;
 
 # if defined(_MSC_VER)
 #  define mad_fixed64_t  signed __int64
@@ -35,6 +34,13 @@ typedef  uint32_t mad_fixed64lo_t;
 #  define mad_fixed64_t  signed long long
 # endif
 
+/* rockbox: FPM_64BIT keeps the whole accumulator in lo */
+# if defined(FPM_64BIT)
+typedef mad_fixed64_t mad_fixed64lo_t;
+# else
+typedef  uint32_t mad_fixed64lo_t;
+# endif
+
 # if defined(FPM_FLOAT)
 typedef double mad_sample_t;
 # else
@@ -128,6 +134,18 @@ typedef mad_fixed_t mad_sample_t;
 
 #  define MAD_F_SCALEBITS  MAD_F_FRACBITS
 
+/*
+ * rockbox: accumulate the full products and scale once at the end, like
+ * FPM_ARM does, instead of truncating every single product.
+ */
+#  define MAD_F_ML0(hi, lo, x, y)  \
+    ((lo)  = (mad_fixed64_t) (x) * (y))
+#  define MAD_F_MLA(hi, lo, x, y)  \
+    ((lo) += (mad_fixed64_t) (x) * (y))
+#  define MAD_F_MLN(hi, lo)        ((lo)  = -(lo))
+#  define MAD_F_MLZ(hi, lo)        \
+    ((void) (hi), (mad_fixed_t) ((lo) >> MAD_F_SCALEBITS))
+
 /* --- Intel --------------------------------------------------------------- */
 
 # elif defined(FPM_INTEL)
@@ -32,6 +32,8 @@
 #define FPM_ARM
 #elif defined(CPU_MIPS)
 #define FPM_MIPS
+#elif (CONFIG_PLATFORM & PLATFORM_HOSTED) && defined(__LP64__)
+#define FPM_64BIT
 #else
 #define FPM_DEFAULT
 #endif
@@ -46,11 +46,23 @@
 # include "layer3.h"
 
 /* depending on the cpu "leftshift32" may be supported or not */
+# if defined(MAD_BIT_CACHE64)
+/* 64-bit hosts: the cache holds a whole big_values pair including linbits
+   and signs, so the refills inside a pair never trigger */
+#define MAXLSHIFT 57
+#define PAIR_REFILL_LINBITS 45  /* hcod 17 + 2 * (linbits 13 + sign) */
+#define PAIR_REFILL         21  /* hcod 19 + sign(x,y) */
+#define CACHE_READ(bitptr, len) mad_bit_read_long(bitptr, len)
+# else
 # if defined(CPU_COLDFIRE)
 #define MAXLSHIFT 32
 #else
 #define MAXLSHIFT 31
 #endif
+#define PAIR_REFILL_LINBITS 19  /* maxhuffcode(hufftab16,hufftab24)=17bit + sign(x,y)=2bit */
+#define PAIR_REFILL         6   /* maxlookup=4bit + sign(x,y)=2bit */
+#define CACHE_READ(bitptr, len) mad_bit_read(bitptr, len)
+# endif
 
 /* --- Layer III ----------------------------------------------------------- */
 
@@ -936,7 +948,7 @@ mad_fixed_t III_requantize(unsigned int value, signed int exp)
     (((cache) >> ((sz) - (bits))) & ((1 << (bits)) - 1))
 #endif
 # define MASK1BIT(cache, sz)  \
-    ((cache) & (1 << ((sz) - 1)))
+    ((cache) & (1UL << ((sz) - 1)))
 
 /*
  * NAME:        III_huffdecode()
@@ -1028,14 +1040,13 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
           register mad_fixed_t requantized;
           unsigned int clumpsz, value;
 
-          /* maxhuffcode(hufftab16,hufftab24)=17bit + sign(x,y)=2bit */
-          if(cachesz < 19)
+          if(cachesz < PAIR_REFILL_LINBITS)
           {
             if(cachesz < 0)
               return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
             bits     = MAXLSHIFT - cachesz;
-            bitcache = (bitcache << bits) | mad_bit_read(&peek, bits);
+            bitcache = (bitcache << bits) | CACHE_READ(&peek, bits);
             cachesz += bits;
           }
 
@@ -1067,7 +1078,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
                   return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
                 bits     = MAXLSHIFT - cachesz;
-                bitcache = (bitcache << bits) | mad_bit_read(&peek, bits);
+                bitcache = (bitcache << bits) | CACHE_READ(&peek, bits);
                 cachesz += bits;
               }
 
@@ -1100,7 +1111,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
                   return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
                 bits     = MAXLSHIFT - cachesz;
-                bitcache = (bitcache << bits) | mad_bit_read(&peek, bits);
+                bitcache = (bitcache << bits) | CACHE_READ(&peek, bits);
                 cachesz += bits;
               }
 
@@ -1126,14 +1137,13 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
           register mad_fixed_t requantized;
           unsigned int clumpsz, value;
 
-          /* maxlookup=4bit + sign(x,y)=2bit */
-          if(cachesz < 6)
+          if(cachesz < PAIR_REFILL)
           {
             if(cachesz < 0)
               return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
             bits     = MAXLSHIFT - cachesz;
-            bitcache = (bitcache << bits) | mad_bit_read(&peek, bits);
+            bitcache = (bitcache << bits) | CACHE_READ(&peek, bits);
             cachesz += bits;
           }
 
@@ -1152,7 +1162,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
                 return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
               bits     = MAXLSHIFT - cachesz;
-              bitcache = (bitcache << bits) | mad_bit_read(&peek, bits);
+              bitcache = (bitcache << bits) | CACHE_READ(&peek, bits);
               cachesz += bits;
             }
 
@@ -1219,7 +1229,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
           return MAD_ERROR_BADHUFFDATA;  /* cache underrun */
 
         bits       = MAXLSHIFT - cachesz;
-        bitcache   = (bitcache << bits) | mad_bit_read(&peek, bits);
+        bitcache   = (bitcache << bits) | CACHE_READ(&peek, bits);
         cachesz   += bits;
         bits_left -= bits;
       }
@@ -1295,6 +1305,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xrarr[576],
 
 # undef MASK
 # undef MASK1BIT
+# undef CACHE_READ
 
 /*
  * NAME:        III_reorder()
@@ -25,7 +25,12 @@
 # include "bit.h"
 
 # define MAD_BUFFER_GUARD       8
-# define MAD_BUFFER_MDLEN       (511 + 2048 + MAD_BUFFER_GUARD)
+# if defined(MAD_BIT_CACHE64)
+/* the 57 bit Huffman cache reads up to 8 bytes further past the main data */
+#  define MAD_BUFFER_MDLEN      (511 + 2048 + MAD_BUFFER_GUARD + 8)
+# else
+#  define MAD_BUFFER_MDLEN      (511 + 2048 + MAD_BUFFER_GUARD)
+# endif
 
 enum mad_error {
   MAD_ERROR_NONE           = 0x0000,    /* no error */
@@ -0,0 +1,174 @@
+/*
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "arch.h"
+#include "pitch.h"
+
+#if defined(OPUS_ARM_PRESUME_NEON_INTR) && defined(FIXED_POINT)
+#include <arm_neon.h>
+
+/* Sum the four 32-bit lanes */
+static OPUS_INLINE opus_val32 hsum_s32(int32x4_t v)
+{
+   int32x2_t s = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+   return vget_lane_s32(vpadd_s32(s, s), 0);
+}
+
+/* x.y over eight samples added to acc */
+static OPUS_INLINE int32x4_t mac8_s16(int32x4_t acc, int16x8_t x, int16x8_t y)
+{
+   acc = vmlal_s16(acc, vget_low_s16(x), vget_low_s16(y));
+   return vmlal_s16(acc, vget_high_s16(x), vget_high_s16(y));
+}
+
+/* MULT16_32_Q15() on four lanes: the Q15 product of a 16-bit gain and each
+   32-bit sample, truncated exactly as the generic macro does */
+static OPUS_INLINE int32x4_t mult16_32_q15_neon(opus_val16 g, int32x4_t v)
+{
+   int64x2_t lo = vmull_n_s32(vget_low_s32(v), g);
+   int64x2_t hi = vmull_n_s32(vget_high_s32(v), g);
+   return vcombine_s32(vshrn_n_s64(lo, 15), vshrn_n_s64(hi, 15));
+}
+
+void xcorr_kernel_neon(const opus_val16 *x, const opus_val16 *y,
+      opus_val32 sum[4], int len)
+{
+   int j;
+   int32x4_t sum0 = vdupq_n_s32(0);
+   int32x4_t sum1 = vdupq_n_s32(0);
+   int32x4_t sum2 = vdupq_n_s32(0);
+   int32x4_t sum3 = vdupq_n_s32(0);
+   opus_val32 s0, s1, s2, s3;
+
+   celt_assert(len>=3);
+
+   for (j=0;j<len-7;j+=8)
+   {
+      int16x8_t vx = vld1q_s16(&x[j]);
+      sum0 = mac8_s16(sum0, vx, vld1q_s16(&y[j]));
+      sum1 = mac8_s16(sum1, vx, vld1q_s16(&y[j+1]));
+      sum2 = mac8_s16(sum2, vx, vld1q_s16(&y[j+2]));
+      sum3 = mac8_s16(sum3, vx, vld1q_s16(&y[j+3]));
+   }
+
+   s0 = sum[0] + hsum_s32(sum0);
+   s1 = sum[1] + hsum_s32(sum1);
+   s2 = sum[2] + hsum_s32(sum2);
+   s3 = sum[3] + hsum_s32(sum3);
+
+   for (;j<len;j++)
+   {
+      opus_val16 tmp = x[j];
+      s0 = MAC16_16(s0, tmp, y[j]);
+      s1 = MAC16_16(s1, tmp, y[j+1]);
+      s2 = MAC16_16(s2, tmp, y[j+2]);
+      s3 = MAC16_16(s3, tmp, y[j+3]);
+   }
+
+   sum[0] = s0;
+   sum[1] = s1;
+   sum[2] = s2;
+   sum[3] = s3;
+}
+
+void dual_inner_prod_neon(const opus_val16 *x, const opus_val16 *y01,
+      const opus_val16 *y02, int N, opus_val32 *xy1, opus_val32 *xy2)
+{
+   int i;
+   int32x4_t acc1 = vdupq_n_s32(0);
+   int32x4_t acc2 = vdupq_n_s32(0);
+   opus_val32 xy01, xy02;
+
+   for (i=0;i<N-7;i+=8)
+   {
+      int16x8_t vx = vld1q_s16(&x[i]);
+      acc1 = mac8_s16(acc1, vx, vld1q_s16(&y01[i]));
+      acc2 = mac8_s16(acc2, vx, vld1q_s16(&y02[i]));
+   }
+
+   xy01 = hsum_s32(acc1);
+   xy02 = hsum_s32(acc2);
+
+   for (;i<N;i++)
+   {
+      xy01 = MAC16_16(xy01, x[i], y01[i]);
+      xy02 = MAC16_16(xy02, x[i], y02[i]);
+   }
+
+   *xy1 = xy01;
+   *xy2 = xy02;
+}
+
+opus_val32 celt_inner_prod_neon(const opus_val16 *x, const opus_val16 *y,
+      int N)
+{
+   int i;
+   int32x4_t acc = vdupq_n_s32(0);
+   opus_val32 xy;
+
+   for (i=0;i<N-7;i+=8)
+      acc = mac8_s16(acc, vld1q_s16(&x[i]), vld1q_s16(&y[i]));
+
+   xy = hsum_s32(acc);
+
+   for (;i<N;i++)
+      xy = MAC16_16(xy, x[i], y[i]);
+
+   return xy;
+}
+
+/* T is at least COMBFILTER_MINPERIOD, so when filtering in place (y == x)
+   every tap a vector of four outputs reads was written by an earlier
+   iteration, just like in the scalar loop. */
+void comb_filter_const_neon(opus_val32 *y, opus_val32 *x, int T, int N,
+      opus_val16 g10, opus_val16 g11, opus_val16 g12)
+{
+   int i;
+
+   for (i=0;i<N-3;i+=4)
+   {
+      int32x4_t t = vld1q_s32(&x[i]);
+      int32x4_t x13 = vaddq_s32(vld1q_s32(&x[i-T+1]), vld1q_s32(&x[i-T-1]));
+      int32x4_t x04 = vaddq_s32(vld1q_s32(&x[i-T+2]), vld1q_s32(&x[i-T-2]));
+      t = vaddq_s32(t, mult16_32_q15_neon(g10, vld1q_s32(&x[i-T])));
+      t = vaddq_s32(t, mult16_32_q15_neon(g11, x13));
+      t = vaddq_s32(t, mult16_32_q15_neon(g12, x04));
+      vst1q_s32(&y[i], t);
+   }
+
+   for (;i<N;i++)
+   {
+      y[i] = x[i]
+               + MULT16_32_Q15(g10,x[i-T])
+               + MULT16_32_Q15(g11,ADD32(x[i-T+1],x[i-T-1]))
+               + MULT16_32_Q15(g12,ADD32(x[i-T+2],x[i-T-2]));
+   }
+}
+
+#endif /* OPUS_ARM_PRESUME_NEON_INTR && FIXED_POINT */
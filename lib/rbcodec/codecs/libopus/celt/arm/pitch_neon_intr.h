@@ -0,0 +1,62 @@
+/*
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PITCH_NEON_INTR_H
+#define PITCH_NEON_INTR_H
+
+/* NEON versions of the fixed-point kernels. NEON is always present on the
+   hosted targets this is enabled for, so there is no run-time check. All of
+   them are bit-exact with the generic C code. */
+void xcorr_kernel_neon(const opus_val16 *x, const opus_val16 *y,
+      opus_val32 sum[4], int len);
+
+void dual_inner_prod_neon(const opus_val16 *x, const opus_val16 *y01,
+      const opus_val16 *y02, int N, opus_val32 *xy1, opus_val32 *xy2);
+
+opus_val32 celt_inner_prod_neon(const opus_val16 *x, const opus_val16 *y,
+      int N);
+
+void comb_filter_const_neon(opus_val32 *y, opus_val32 *x, int T, int N,
+      opus_val16 g10, opus_val16 g11, opus_val16 g12);
+
+#ifndef OVERRIDE_XCORR_KERNEL
+#define OVERRIDE_XCORR_KERNEL
+#define xcorr_kernel xcorr_kernel_neon
+#endif
+
+#ifndef OVERRIDE_DUAL_INNER_PROD
+#define OVERRIDE_DUAL_INNER_PROD
+#define dual_inner_prod dual_inner_prod_neon
+#endif
+
+#ifndef OVERRIDE_CELT_INNER_PROD
+#define OVERRIDE_CELT_INNER_PROD
+#define celt_inner_prod celt_inner_prod_neon
+#endif
+
+#define COMB_FILTER_CONST_SIMD(y, x, T, N, g10, g11, g12) \
+   (comb_filter_const_neon(y, x, T, N, g10, g11, g12), 1)
+
+#endif
@@ -234,6 +234,10 @@ void comb_filter(opus_val32 *y, opus_val32 *x, int T0, int T1, int N,
    }
 
    /* Compute the part with the constant filter. */
+#ifdef COMB_FILTER_CONST_SIMD
+   if (COMB_FILTER_CONST_SIMD(y+i, x+i, T1, N-i, g10, g11, g12))
+      return;
+#endif
    comb_filter_const(y+i, x+i, T1, N-i, g10, g11, g12);
 }
 #endif /* OVERRIDE_comb_filter */
@@ -42,6 +42,14 @@
  */
 #define OPUS_ARCHMASK 3
 
+#elif defined(OPUS_X86_MAY_HAVE_SSE4_1)
+#include "x86/x86cpu.h"
+
+/* arch[0] -> C
+ * arch[1] -> SSE4.1
+ */
+#define OPUS_ARCHMASK 1
+
 #else
 #define OPUS_ARCHMASK 0
 
@@ -37,10 +37,6 @@
 #include "modes.h"
 #include "cpu_support.h"
 
-#if defined(__SSE__) && !defined(FIXED_POINT)
-#include "x86/pitch_sse.h"
-#endif
-
 #if defined(MIPSr1_ASM)
 #include "mips/pitch_mipsr1.h"
 #endif
@@ -60,8 +56,7 @@ opus_val16 remove_doubling(opus_val16 *x, int maxperiod, int minperiod,
 
 /* OPT: This is the kernel you really want to optimize. It gets used a lot
    by the prefilter and by the PLC. */
-#ifndef OVERRIDE_XCORR_KERNEL
-static OPUS_INLINE void xcorr_kernel(const opus_val16 * x, const opus_val16 * y, opus_val32 sum[4], int len)
+static OPUS_INLINE void xcorr_kernel_c(const opus_val16 * x, const opus_val16 * y, opus_val32 sum[4], int len)
 {
    int j;
    opus_val16 y_0, y_1, y_2, y_3;
@@ -126,10 +121,8 @@ static OPUS_INLINE void xcorr_kernel(const opus_val16 * x, const opus_val16 * y,
       sum[3] = MAC16_16(sum[3],tmp,y_1);
    }
 }
-#endif /* OVERRIDE_XCORR_KERNEL */
 
-#ifndef OVERRIDE_DUAL_INNER_PROD
-static OPUS_INLINE void dual_inner_prod(const opus_val16 *x, const opus_val16 *y01, const opus_val16 *y02,
+static OPUS_INLINE void dual_inner_prod_c(const opus_val16 *x, const opus_val16 *y01, const opus_val16 *y02,
       int N, opus_val32 *xy1, opus_val32 *xy2)
 {
    int i;
@@ -143,10 +136,8 @@ static OPUS_INLINE void dual_inner_prod(const opus_val16 *x, const opus_val16 *y
    *xy1 = xy01;
    *xy2 = xy02;
 }
-#endif
 
-#ifndef OVERRIDE_CELT_INNER_PROD
-static OPUS_INLINE opus_val32 celt_inner_prod(const opus_val16 *x, const opus_val16 *y,
+static OPUS_INLINE opus_val32 celt_inner_prod_c(const opus_val16 *x, const opus_val16 *y,
       int N)
 {
    int i;
@@ -155,6 +146,24 @@ static OPUS_INLINE opus_val32 celt_inner_prod(const opus_val16 *x, const opus_va
       xy = MAC16_16(xy, x[i], y[i]);
    return xy;
 }
+
+/* SIMD kernels for hosted builds - see config.h */
+#if defined(OPUS_X86_MAY_HAVE_SSE4_1) && defined(FIXED_POINT)
+#include "x86/pitch_sse.h"
+#elif defined(OPUS_ARM_PRESUME_NEON_INTR) && defined(FIXED_POINT)
+#include "arm/pitch_neon_intr.h"
+#endif
+
+#ifndef OVERRIDE_XCORR_KERNEL
+#define xcorr_kernel xcorr_kernel_c
+#endif
+
+#ifndef OVERRIDE_DUAL_INNER_PROD
+#define dual_inner_prod dual_inner_prod_c
+#endif
+
+#ifndef OVERRIDE_CELT_INNER_PROD
+#define celt_inner_prod celt_inner_prod_c
 #endif
 
 #ifdef FIXED_POINT
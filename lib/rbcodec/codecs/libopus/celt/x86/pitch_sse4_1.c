@@ -0,0 +1,196 @@
+/*
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "arch.h"
+#include "pitch.h"
+
+#if defined(OPUS_X86_MAY_HAVE_SSE4_1) && defined(FIXED_POINT)
+#include <smmintrin.h>
+
+/* The kernels are built for SSE4.1 on their own so that the rest of the
+   codec keeps running on any x86 CPU; pitch.h only calls them once
+   opus_select_arch() has found SSE4.1 support. */
+#define SSE4_1_ATTR __attribute__((target("sse4.1")))
+
+/* Sum the four 32-bit lanes */
+static OPUS_INLINE SSE4_1_ATTR opus_val32 hsum_epi32(__m128i v)
+{
+   v = _mm_add_epi32(v, _mm_unpackhi_epi64(v, v));
+   v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+   return _mm_cvtsi128_si32(v);
+}
+
+/* MULT16_32_Q15() on four lanes: the Q15 product of a 16-bit gain and each
+   32-bit sample, truncated exactly as the generic macro does */
+static OPUS_INLINE SSE4_1_ATTR __m128i mult16_32_q15_sse4_1(__m128i g,
+      __m128i v)
+{
+   __m128i even = _mm_srli_epi64(_mm_mul_epi32(g, v), 15);
+   __m128i odd = _mm_srli_epi64(_mm_mul_epi32(g, _mm_srli_epi64(v, 32)), 15);
+   return _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+}
+
+SSE4_1_ATTR
+void xcorr_kernel_sse4_1(const opus_val16 *x, const opus_val16 *y,
+      opus_val32 sum[4], int len)
+{
+   int j;
+   __m128i sum0 = _mm_setzero_si128();
+   __m128i sum1 = _mm_setzero_si128();
+   __m128i sum2 = _mm_setzero_si128();
+   __m128i sum3 = _mm_setzero_si128();
+   opus_val32 s0, s1, s2, s3;
+
+   celt_assert(len>=3);
+
+   for (j=0;j<len-7;j+=8)
+   {
+      __m128i vx = _mm_loadu_si128((const __m128i *)&x[j]);
+      sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y[j])));
+      sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y[j+1])));
+      sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y[j+2])));
+      sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y[j+3])));
+   }
+
+   s0 = sum[0] + hsum_epi32(sum0);
+   s1 = sum[1] + hsum_epi32(sum1);
+   s2 = sum[2] + hsum_epi32(sum2);
+   s3 = sum[3] + hsum_epi32(sum3);
+
+   for (;j<len;j++)
+   {
+      opus_val16 tmp = x[j];
+      s0 = MAC16_16(s0, tmp, y[j]);
+      s1 = MAC16_16(s1, tmp, y[j+1]);
+      s2 = MAC16_16(s2, tmp, y[j+2]);
+      s3 = MAC16_16(s3, tmp, y[j+3]);
+   }
+
+   sum[0] = s0;
+   sum[1] = s1;
+   sum[2] = s2;
+   sum[3] = s3;
+}
+
+SSE4_1_ATTR
+void dual_inner_prod_sse4_1(const opus_val16 *x, const opus_val16 *y01,
+      const opus_val16 *y02, int N, opus_val32 *xy1, opus_val32 *xy2)
+{
+   int i;
+   __m128i acc1 = _mm_setzero_si128();
+   __m128i acc2 = _mm_setzero_si128();
+   opus_val32 xy01, xy02;
+
+   for (i=0;i<N-7;i+=8)
+   {
+      __m128i vx = _mm_loadu_si128((const __m128i *)&x[i]);
+      acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y01[i])));
+      acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(vx,
+               _mm_loadu_si128((const __m128i *)&y02[i])));
+   }
+
+   xy01 = hsum_epi32(acc1);
+   xy02 = hsum_epi32(acc2);
+
+   for (;i<N;i++)
+   {
+      xy01 = MAC16_16(xy01, x[i], y01[i]);
+      xy02 = MAC16_16(xy02, x[i], y02[i]);
+   }
+
+   *xy1 = xy01;
+   *xy2 = xy02;
+}
+
+SSE4_1_ATTR
+opus_val32 celt_inner_prod_sse4_1(const opus_val16 *x, const opus_val16 *y,
+      int N)
+{
+   int i;
+   __m128i acc = _mm_setzero_si128();
+   opus_val32 xy;
+
+   for (i=0;i<N-7;i+=8)
+   {
+      acc = _mm_add_epi32(acc, _mm_madd_epi16(
+               _mm_loadu_si128((const __m128i *)&x[i]),
+               _mm_loadu_si128((const __m128i *)&y[i])));
+   }
+
+   xy = hsum_epi32(acc);
+
+   for (;i<N;i++)
+      xy = MAC16_16(xy, x[i], y[i]);
+
+   return xy;
+}
+
+/* T is at least COMBFILTER_MINPERIOD, so when filtering in place (y == x)
+   every tap a vector of four outputs reads was written by an earlier
+   iteration, just like in the scalar loop. */
+SSE4_1_ATTR
+void comb_filter_const_sse4_1(opus_val32 *y, opus_val32 *x, int T, int N,
+      opus_val16 g10, opus_val16 g11, opus_val16 g12)
+{
+   int i;
+   __m128i vg10 = _mm_set1_epi32(g10);
+   __m128i vg11 = _mm_set1_epi32(g11);
+   __m128i vg12 = _mm_set1_epi32(g12);
+
+   for (i=0;i<N-3;i+=4)
+   {
+      __m128i t = _mm_loadu_si128((const __m128i *)&x[i]);
+      __m128i x2 = _mm_loadu_si128((const __m128i *)&x[i-T]);
+      __m128i x13 = _mm_add_epi32(
+               _mm_loadu_si128((const __m128i *)&x[i-T+1]),
+               _mm_loadu_si128((const __m128i *)&x[i-T-1]));
+      __m128i x04 = _mm_add_epi32(
+               _mm_loadu_si128((const __m128i *)&x[i-T+2]),
+               _mm_loadu_si128((const __m128i *)&x[i-T-2]));
+      t = _mm_add_epi32(t, mult16_32_q15_sse4_1(vg10, x2));
+      t = _mm_add_epi32(t, mult16_32_q15_sse4_1(vg11, x13));
+      t = _mm_add_epi32(t, mult16_32_q15_sse4_1(vg12, x04));
+      _mm_storeu_si128((__m128i *)&y[i], t);
+   }
+
+   for (;i<N;i++)
+   {
+      y[i] = x[i]
+               + MULT16_32_Q15(g10,x[i-T])
+               + MULT16_32_Q15(g11,ADD32(x[i-T+1],x[i-T-1]))
+               + MULT16_32_Q15(g12,ADD32(x[i-T+2],x[i-T-2]));
+   }
+}
+
+#endif /* OPUS_X86_MAY_HAVE_SSE4_1 && FIXED_POINT */
@@ -53,5 +53,15 @@
 #define OPUS_CF_INLINE_ASM
 #endif
 
+/* SIMD kernels for hosted builds: SSE4.1 is detected at run time, NEON is
+   assumed whenever the compiler targets it */
+#if (CONFIG_PLATFORM & PLATFORM_HOSTED)
+#if defined(__x86_64__) || defined(__i386__)
+#define OPUS_X86_MAY_HAVE_SSE4_1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OPUS_ARM_PRESUME_NEON_INTR
+#endif
+#endif
+
 #endif /* CONFIG_H */
 
@@ -2,39 +2,41 @@
 #define OS_TYPES_H
 #include "codeclib.h"
 #include <stdint.h>
-#include <tlsf.h>
+
+/* The heap on the codec buffer. A header can't own the variable, so the
+ * codec provides it (opus.c) */
+extern int ogg_heap;
 
 static inline void ogg_malloc_init(void)
 {
     size_t bufsize;
     void* buf = ci->codec_get_buffer(&bufsize);
-    init_memory_pool(bufsize, buf);
+    ogg_heap = ci->heap_create("opus", buf, bufsize);
 }
 
 static inline void ogg_malloc_destroy(void)
 {
-    size_t bufsize;
-    void* buf = ci->codec_get_buffer(&bufsize);
-    destroy_memory_pool(buf);
+    ci->heap_destroy(ogg_heap);
+    ogg_heap = -1;
 }
 
 static inline void *_ogg_malloc(size_t size)
 {
-    void* x = tlsf_malloc(size);
+    void* x = ci->heap_malloc(ogg_heap, size);
     DEBUGF("ogg_malloc %zu = %p\n", size, x);
     return x;
 }
 
 static inline void *_ogg_calloc(size_t nmemb, size_t size)
 {
-    void *x = tlsf_calloc(nmemb, size);
+    void *x = ci->heap_calloc(ogg_heap, nmemb, size);
     DEBUGF("ogg_calloc %zu %zu\n", nmemb, size);
     return x;
 }
 
 static inline void *_ogg_realloc(void *ptr, size_t size)
 {
-    void *x = tlsf_realloc(ptr, size);
+    void *x = ci->heap_realloc(ogg_heap, ptr, size);
     DEBUGF("ogg_realloc %p %zu = %p\n", ptr, size, x);
     return x;
 }
@@ -42,7 +44,7 @@ static inline void *_ogg_realloc(void *ptr, size_t size)
 static inline void _ogg_free(void* ptr)
 {
     DEBUGF("ogg_free %p\n", ptr);
-    tlsf_free(ptr);
+    ci->heap_free(ogg_heap, ptr);
 }
 
 typedef int16_t ogg_int16_t;
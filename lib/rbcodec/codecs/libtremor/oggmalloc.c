@@ -1,5 +1,4 @@
 #include "os_types.h"
-#include <tlsf.h>
 
 #if defined(CPU_ARM) || defined(CPU_COLDFIRE) || defined(CPU_MIPS)
 #include <setjmp.h>
@@ -11,23 +10,25 @@ extern jmp_buf rb_jump_buf;
 #define LONGJMP(x)  return NULL
 #endif
 
+/* the heap on the codec buffer, for the current track */
+static int heap = -1;
+
 void ogg_malloc_init(void)
 {
     size_t bufsize;
     void* buf = ci->codec_get_buffer(&bufsize);
-    init_memory_pool(bufsize, buf);
+    heap = ci->heap_create("vorbis", buf, bufsize);
 }
 
 void ogg_malloc_destroy()
 {
-    size_t bufsize;
-    void* buf = ci->codec_get_buffer(&bufsize);
-    destroy_memory_pool(buf);
+    ci->heap_destroy(heap);
+    heap = -1;
 }
 
 void *ogg_malloc(size_t size)
 {
-    void* x = tlsf_malloc(size);
+    void* x = ci->heap_malloc(heap, size);
 
     if (x == NULL)
         LONGJMP(1);
@@ -37,7 +38,7 @@ void *ogg_malloc(size_t size)
 
 void *ogg_calloc(size_t nmemb, size_t size)
 {
-    void *x = tlsf_calloc(nmemb, size);
+    void *x = ci->heap_calloc(heap, nmemb, size);
 
     if (x == NULL)
         LONGJMP(1);
@@ -47,7 +48,7 @@ void *ogg_calloc(size_t nmemb, size_t size)
 
 void *ogg_realloc(void *ptr, size_t size)
 {
-    void *x = tlsf_realloc(ptr, size);
+    void *x = ci->heap_realloc(heap, ptr, size);
 
     if (x == NULL)
         LONGJMP(1);
@@ -57,7 +58,7 @@ void *ogg_realloc(void *ptr, size_t size)
 
 void ogg_free(void* ptr)
 {
-    tlsf_free(ptr);
+    ci->heap_free(heap, ptr);
 }
 
 #ifdef TREMOR_USE_IRAM
@@ -30,9 +30,6 @@
 
 
 #include "libopus/ogg/ogg.h"
-#ifdef SIMULATOR
-#include <tlsf.h>
-#endif
 
 CODEC_HEADER
 
@@ -41,6 +38,9 @@ CODEC_HEADER
 /* the opus pseudo stack pointer */
 extern char *global_stack;
 
+/* the heap ogg/os_types.h allocates from */
+int ogg_heap = -1;
+
 /* Room for 120 ms of stereo audio at 48 kHz */
 #define MAX_FRAME_SIZE  (2*120*48)
 #define CHUNKSIZE       (16*1024)
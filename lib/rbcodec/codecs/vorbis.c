@@ -22,9 +22,6 @@
 #include "codeclib.h"
 #include "libtremor/ivorbisfile.h"
 #include "libtremor/ogg.h"
-#ifdef SIMULATOR
-#include <tlsf.h>
-#endif
 
 CODEC_HEADER
 
@@ -242,14 +239,7 @@ enum codec_status codec_run(void)
 
     error = CODEC_OK;
 done:
-#if 0 /* defined(SIMULATOR) */
-    {
-        size_t bufsize;
-        void* buf = ci->codec_get_buffer(&bufsize);
-
-        DEBUGF("Vorbis: Memory max: %zu\n", get_max_size(buf));
-    }
-#endif
+    /* the peak it reached stays on the debug menu's heap screen */
     ogg_malloc_destroy();
 
     /* Clean things up for the next track */
@@ -0,0 +1,174 @@
+#!/usr/bin/perl
+#             __________               __   ___.
+#   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+#   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+#   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+#   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+#                     \/            \/     \/    \/            \/
+# $Id$
+#
+# Codec conformance and speed regression check.
+#
+# Every file of a corpus is decoded with warble (raw codec output, no DSP)
+# and the MD5 of the PCM is compared with the one stored in a reference
+# file, together with the decode time. Run with -u once on a known good
+# tree to write the reference, then after each change to the codecs.
+#
+# Reference file format, one line per corpus file:
+#   <md5> <decode seconds> <path relative to the corpus>
+#
+
+use strict;
+
+use File::Find;
+use Digest::MD5;
+use Getopt::Long;
+
+my $update;
+my $runs = 1;
+my $tolerance = 10;
+my $strict;
+
+sub usage {
+    print STDERR <<EOF;
+Usage: codectest.pl [options] WARBLE CORPUSDIR REFFILE
+
+  -u, --update        Write the results to REFFILE instead of comparing
+  -n, --runs=N        Decode each file N times and keep the fastest [1]
+  -t, --tolerance=P   Report files more than P percent slower [10]
+  -s, --strict        Treat slow files as failures
+EOF
+    exit(1);
+}
+
+GetOptions("u|update" => \$update,
+           "n|runs=i" => \$runs,
+           "t|tolerance=f" => \$tolerance,
+           "s|strict" => \$strict) or usage();
+
+usage() if (@ARGV != 3 || $runs < 1);
+
+my ($warble, $corpus, $reffile) = @ARGV;
+$corpus =~ s/\/+$//;
+
+# Decode one file, return (md5, seconds) or nothing if warble failed
+sub decode {
+    my ($file) = @_;
+    my ($md5, $best);
+
+    for (1 .. $runs) {
+        my $errfile = "/tmp/codectest.$$.err";
+        # fork and exec directly, corpus file names never reach a shell
+        my $pid = open(my $pcm, "-|");
+        return if (!defined($pid));
+        if ($pid == 0) {
+            open(STDERR, ">", $errfile) or exit(127);
+            exec($warble, "-b", "-r", $file, "-") or exit(127);
+        }
+        binmode($pcm);
+
+        my $ctx = Digest::MD5->new;
+        $ctx->addfile($pcm);
+        close($pcm);
+        my $status = $?;
+
+        my $time;
+        if (open(my $err, "<", $errfile)) {
+            while (<$err>) {
+                $time = $1 if (/^Decode time: ([0-9.]+) s/);
+                $status = 1 if (/^error: /);
+            }
+            close($err);
+        }
+        unlink($errfile);
+
+        return if ($status != 0 || !defined($time));
+
+        $md5 = $ctx->hexdigest;
+        $best = $time if (!defined($best) || $time < $best);
+    }
+
+    return ($md5, $best);
+}
+
+my @files;
+find({ wanted => sub {
+            push(@files, $File::Find::name)
+                if (-f $_ && $File::Find::name ne $reffile && !/^\./);
+        }, no_chdir => 1 }, $corpus);
+@files = sort(@files);
+
+my %ref;
+if (!$update) {
+    open(REF, "<", $reffile) or die "Can't open $reffile: $!\n";
+    while (<REF>) {
+        chomp;
+        next if (/^\s*(#|$)/);
+        my ($md5, $time, $name) = split(/\s+/, $_, 3);
+        $ref{$name} = [ $md5, $time ];
+    }
+    close(REF);
+}
+
+my ($pass, $fail, $slow, $new) = (0, 0, 0, 0);
+my ($total, $total_ref) = (0, 0);
+my @results;
+
+for my $file (@files) {
+    my $name = substr($file, length($corpus) + 1);
+    my ($md5, $time) = decode($file);
+
+    if (!defined($md5)) {
+        # Not a format warble knows, or a broken codec - only an error if
+        # the reference says it used to decode
+        if ($ref{$name}) {
+            printf("FAIL  %-50s decoding failed\n", $name);
+            $fail++;
+        }
+        next;
+    }
+
+    push(@results, sprintf("%s %.4f %s\n", $md5, $time, $name));
+    next if ($update);
+
+    my $r = $ref{$name};
+    if (!$r) {
+        printf("NEW   %-50s %8.3fs\n", $name, $time);
+        $new++;
+        next;
+    }
+
+    my ($ref_md5, $ref_time) = @$r;
+    my $delta = $ref_time > 0 ? ($time - $ref_time) * 100 / $ref_time : 0;
+    $total += $time;
+    $total_ref += $ref_time;
+
+    if ($md5 ne $ref_md5) {
+        printf("FAIL  %-50s output differs\n", $name);
+        $fail++;
+    } elsif ($delta > $tolerance) {
+        printf("SLOW  %-50s %8.3fs %+6.1f%%\n", $name, $time, $delta);
+        $slow++;
+    } else {
+        printf("ok    %-50s %8.3fs %+6.1f%%\n", $name, $time, $delta);
+        $pass++;
+    }
+}
+
+if ($update) {
+    open(REF, ">", $reffile) or die "Can't write $reffile: $!\n";
+    print REF "# md5 seconds file - written by codectest.pl\n";
+    print REF @results;
+    close(REF);
+    printf("%d reference entries written to %s\n", scalar(@results), $reffile);
+    exit(0);
+}
+
+printf("\n%d passed, %d failed, %d slower, %d without reference\n",
+       $pass, $fail, $slow, $new);
+printf("Total decode time %.3fs, reference %.3fs (%+.1f%%)\n",
+       $total, $total_ref,
+       $total_ref > 0 ? ($total - $total_ref) * 100 / $total_ref : 0)
+    if ($total_ref > 0);
+
+exit(($fail || ($strict && $slow)) ? 1 : 0);
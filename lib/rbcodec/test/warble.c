@@ -30,10 +30,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "buffering.h" /* TYPE_PACKET_AUDIO */
 #include "kernel.h"
 #include "core_alloc.h"
+#include "heap.h"
 #include "codecs.h"
 #include "dsp_core.h"
 #include "metadata.h"
@@ -97,8 +99,9 @@ off_t filesize(int fd)
 
 /***************** INTERNAL *****************/
 
-static enum { MODE_PLAY, MODE_WRITE } mode;
+static enum { MODE_PLAY, MODE_WRITE, MODE_BENCH } mode;
 static bool use_dsp = true;
+static bool benchmark = false;
 static bool enable_loop = false;
 static const char *config = "";
 
@@ -379,6 +382,26 @@ static void playback_pcm(int16_t *pcm, int count)
     }
 }
 
+/***** BENCHMARK *****/
+
+static double bench_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_report(double decode_time)
+{
+    double duration = format.freq ?
+        (double)num_output_samples / format.freq : 0.0;
+
+    fprintf(stderr, "Decode time: %.3f s\n", decode_time);
+    fprintf(stderr, "Audio duration: %.3f s\n", duration);
+    if (decode_time > 0.0)
+        fprintf(stderr, "Speed: %.2fx realtime\n", duration / decode_time);
+}
+
 /***** ALL MODES *****/
 
 static void perform_config(void)
@@ -436,6 +459,11 @@ static void *ci_codec_get_buffer(size_t *size)
     return ptr;
 }
 
+static int ci_heap_create(const char *name, void *buf, size_t size)
+{
+    return heap_create(name, buf, size, HEAP_OWNER_CODEC);
+}
+
 static void ci_pcmbuf_insert(const void *ch1, const void *ch2, int count)
 {
     num_output_samples += count;
@@ -591,6 +619,9 @@ static void ci_set_offset(size_t value)
 
 static void ci_configure(int setting, intptr_t value)
 {
+    if (setting == DSP_SET_FREQUENCY)
+        format.freq = value;
+
     if (use_dsp) {
         dsp_configure(ci.dsp, setting, value);
     } else {
@@ -717,6 +748,13 @@ static struct codec_api ci = {
     ci_round_value_to_list32,
 
 #endif /* HAVE_RECORDING */
+
+    ci_heap_create,
+    heap_destroy,
+    heap_malloc,
+    heap_calloc,
+    heap_realloc,
+    heap_free,
 };
 
 static void print_mp3entry(const struct mp3entry *id3, FILE *f)
@@ -820,6 +858,7 @@ static void decode_file(const char *input_fn)
 
     /* Run the codec */
     *c_hdr->api = &ci;
+    double start = bench_time();
     if (c_hdr->entry_point(CODEC_LOAD) != CODEC_OK) {
         fprintf(stderr, "error: codec returned error from codec_main\n");
         exit(1);
@@ -828,6 +867,9 @@ static void decode_file(const char *input_fn)
         fprintf(stderr, "error: codec error\n");
     }
     c_hdr->entry_point(CODEC_UNLOAD);
+    heap_release_owner(HEAP_OWNER_CODEC);
+    if (benchmark)
+        bench_report(bench_time() - start);
 
     /* Close */
     dlclose(dlcodec);
@@ -840,8 +882,11 @@ static void print_help(const char *progname)
     fprintf(stderr, "Usage:\n"
                     "        Play: %s [options] INPUTFILE\n"
                     "Write to WAV: %s [options] INPUTFILE OUTPUTFILE\n"
+                    "   Benchmark: %s -b [options] INPUTFILE\n"
                     "\n"
                     "general options:\n"
+                    "  -b            Print decoding speed; decode without\n"
+                    "                output unless OUTPUTFILE is given\n"
                     "  -c a=1:b=2    Configuration (see below)\n"
                     "  -h            Show this help\n"
                     "\n"
@@ -866,14 +911,19 @@ static void print_help(const char *progname)
                     "  %s in.adx -c loop=1:wait=44100:halt=1\n"
                     "  # Lower pitch 1 octave and write to out.wav\n"
                     "  %s in.ogg -c rate=0.5:tempo=2 out.wav\n"
-                    , progname, progname, progname, progname);
+                    "  # Measure how fast in.opus decodes\n"
+                    "  %s -b in.opus\n"
+                    , progname, progname, progname, progname, progname, progname);
 }
 
 int main(int argc, char **argv)
 {
     int opt;
-    while ((opt = getopt(argc, argv, "c:fhr")) != -1) {
+    while ((opt = getopt(argc, argv, "bc:fhr")) != -1) {
         switch (opt) {
+        case 'b':
+            benchmark = true;
+            break;
         case 'c':
             config = optarg;
             break;
@@ -893,6 +943,8 @@ int main(int argc, char **argv)
 
     if (argc == optind + 2) {
         write_init(argv[optind + 1]);
+    } else if (argc == optind + 1 && benchmark) {
+        mode = MODE_BENCH;
     } else if (argc == optind + 1) {
         if (!use_dsp) {
             fprintf(stderr, "error: -r can't be used for playback\n");
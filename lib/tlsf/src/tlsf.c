@@ -605,6 +605,31 @@ size_t get_max_size(void *mem_pool)
 #endif
 }
 
+/******************************************************************/
+size_t get_largest_free(void *mem_pool)
+{
+/******************************************************************/
+    /* Rockbox: the biggest free block sits on the highest non-empty list,
+     * though not necessarily at its head */
+    tlsf_t *tlsf = (tlsf_t *) mem_pool;
+    size_t largest = 0;
+    bhdr_t *b;
+    int fl, sl;
+
+    if (!tlsf->fl_bitmap)
+        return 0;
+
+    fl = ms_bit(tlsf->fl_bitmap);
+    sl = ms_bit(tlsf->sl_bitmap[fl]);
+
+    for (b = tlsf->matrix[fl][sl]; b; b = b->ptr.free_ptr.next) {
+        if ((b->size & BLOCK_SIZE) > largest)
+            largest = b->size & BLOCK_SIZE;
+    }
+
+    return largest;
+}
+
 /******************************************************************/
 void destroy_memory_pool(void *mem_pool)
 {
@@ -170,6 +170,23 @@ sub print_sorted {
     }
 }
 
+# string (filename)
+# return true for a linked ELF executable or shared object, whatever its name
+sub is_linked_elf {
+    open(my $elf, "<", $_[0]) || return 0;
+    binmode($elf);
+    my $header;
+    my $n = read($elf, $header, 18);
+    close($elf);
+    if (!defined($n) || $n < 18 || substr($header, 0, 4) ne "\x7fELF") {
+        return 0;
+    }
+    # e_type, in the byte order given by EI_DATA: 2 ET_EXEC, 3 ET_DYN
+    my $type = unpack(ord(substr($header, 5, 1)) == 2 ? "n" : "v",
+                      substr($header, 16, 2));
+    return $type == 2 || $type == 3;
+}
+
 # merges two hashes
 sub merge_hashes {
     my $hash1 = $_[0];
@@ -192,7 +209,9 @@ sub usage {
     print STDERR 
         ("\tmap          map file, extension is .map\n");
     print STDERR
-        ("\tobj          library or object file, extension is .a or .o or .elf\n");
+        ("\tobj          library or object file, extension is .a or .o or .elf,\n");
+    print STDERR
+        ("\t             or a linked executable of any name\n");
     print STDERR
         ("\tformat       0-2[_p] 0: by calls, 1: by ticks, 2: by name\n");
     print STDERR
@@ -200,6 +219,8 @@ sub usage {
     print STDERR ("NOTES:\n");
     print STDERR
         ("\tmaps and objects come in sets, one map then many objects\n");
+    print STDERR
+        ("\ta linked executable doesn't need a map (hosted builds)\n");
     exit(1);
 }
 
@@ -221,8 +242,10 @@ my %symbols;
         my $file = $ARGV[$i];
         if ($file =~ m/\.map$/) {
             %map = read_map($file);
-        } elsif ($file =~ m/\.(a|o|elf)$/) {
-            if (!%map) {
+        } elsif ($file =~ m/\.(a|o|elf)$/ || is_linked_elf($file)) {
+            # a linked binary has final addresses, e.g. a hosted build's
+            # executable (rockbox, warble) sampled with profile_sample_start()
+            if (!%map && !is_linked_elf($file)) {
                 usage("No map file found before first object file");
             }
             my @parts = split(/\//,$file);
@@ -0,0 +1,179 @@
+#!/usr/bin/python
+#             __________               __   ___.
+#   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+#   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+#   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+#   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+#                     \/            \/     \/    \/            \/
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+# KIND, either express or implied.
+#
+# Convert a scheduler trace (debug menu -> "Dump scheduler trace", written
+# to /sched_trace.txt by builds with the scheduler trace developer option)
+# into Chrome trace event JSON, for chrome://tracing or ui.perfetto.dev.
+#
+# Each thread gets a row with its running slices; blocks, wakeups and
+# timeouts are instant events on the thread's row, and the number of
+# threads holding a boost request is a counter. A per-thread summary of
+# the traced window goes to stderr.
+#
+# Usage: sched_trace.py sched_trace.txt [out.json]
+
+import sys
+import json
+
+IDLE = 255
+
+
+def read_trace(f):
+    clock = 1000000
+    names = {}
+    events = []
+    for line in f:
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        fields = line.split()
+        if fields[0] == 'clock':
+            clock = int(fields[1])
+        elif fields[0] == 'thread':
+            names[int(fields[1])] = ' '.join(fields[3:])
+        else:
+            events.append((int(fields[0]), fields[1], int(fields[2]),
+                           fields[3:]))
+    return clock, names, events
+
+
+def unwrap(events):
+    # the device keeps the low 32 bits of its clock
+    out = []
+    high = 0
+    last = None
+    for time, kind, slot, args in events:
+        if last is not None and time < last:
+            high += 1 << 32
+        last = time
+        out.append((time + high, kind, slot, args))
+    return out
+
+
+def convert(clock, names, events):
+    trace = []
+    stats = {}
+    if not events:
+        return trace, stats
+
+    def us(t):
+        return (t - events[0][0]) * 1000000.0 / clock
+
+    def name(slot):
+        if slot == IDLE:
+            return 'idle'
+        return names.get(slot, 'thread %d' % slot)
+
+    def stat(slot):
+        return stats.setdefault(slot, {'run': 0, 'switches': 0,
+                                       'blocks': {}, 'wakes': 0,
+                                       'timeouts': 0, 'boosts': 0})
+
+    for slot in set([e[2] for e in events] + list(names.keys()) + [IDLE]):
+        trace.append({'ph': 'M', 'name': 'thread_name', 'pid': 0,
+                      'tid': slot, 'args': {'name': name(slot)}})
+
+    running = None
+    since = None
+    boosted = set()
+
+    def close(t):
+        if running is not None:
+            trace.append({'ph': 'X', 'name': name(running), 'pid': 0,
+                          'tid': running, 'ts': us(since),
+                          'dur': us(t) - us(since)})
+            stat(running)['run'] += t - since
+
+    for time, kind, slot, args in events:
+        if kind == 'switch' or kind == 'idle':
+            close(time)
+            running = slot if kind == 'switch' else IDLE
+            since = time
+            stat(running)['switches'] += 1
+        elif kind == 'block':
+            reason = ' '.join(args)
+            blocks = stat(slot)['blocks']
+            blocks[args[0]] = blocks.get(args[0], 0) + 1
+            trace.append({'ph': 'i', 's': 't', 'name': 'block ' + reason,
+                          'pid': 0, 'tid': slot, 'ts': us(time)})
+        elif kind == 'wake':
+            waker = int(args[0])
+            stat(slot)['wakes'] += 1
+            trace.append({'ph': 'i', 's': 't', 'name': 'woken',
+                          'pid': 0, 'tid': slot, 'ts': us(time),
+                          'args': {'by': name(waker)}})
+        elif kind == 'timeout':
+            stat(slot)['timeouts'] += 1
+            trace.append({'ph': 'i', 's': 't', 'name': 'timeout',
+                          'pid': 0, 'tid': slot, 'ts': us(time)})
+        elif kind == 'boost':
+            if int(args[0]):
+                boosted.add(slot)
+                stat(slot)['boosts'] += 1
+            else:
+                boosted.discard(slot)
+            trace.append({'ph': 'C', 'name': 'boost', 'pid': 0,
+                          'ts': us(time), 'args': {'threads': len(boosted)}})
+            trace.append({'ph': 'i', 's': 't',
+                          'name': 'boost' if int(args[0]) else 'unboost',
+                          'pid': 0, 'tid': slot, 'ts': us(time)})
+        elif kind == 'create':
+            trace.append({'ph': 'i', 's': 't', 'name': 'created',
+                          'pid': 0, 'tid': slot, 'ts': us(time)})
+
+    close(events[-1][0])
+    return trace, stats
+
+
+def summary(clock, names, events, stats):
+    if not events:
+        return
+    total = events[-1][0] - events[0][0] or 1
+    sys.stderr.write('%d events over %.3f s\n' %
+                     (len(events), float(total) / clock))
+    sys.stderr.write('%-20s %7s %9s %6s %6s %6s  %s\n' %
+                     ('thread', 'cpu', 'switches', 'wakes', 'tmo',
+                      'boost', 'blocks'))
+    for slot in sorted(stats, key=lambda s: -stats[s]['run']):
+        st = stats[slot]
+        blocks = ' '.join('%s:%d' % b for b in sorted(st['blocks'].items()))
+        sys.stderr.write('%-20s %6.2f%% %9d %6d %6d %6d  %s\n' %
+                         (slot == IDLE and 'idle' or
+                          names.get(slot, 'thread %d' % slot),
+                          100.0 * st['run'] / total, st['switches'],
+                          st['wakes'], st['timeouts'], st['boosts'],
+                          blocks))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.stderr.write('Usage: %s sched_trace.txt [out.json]\n' %
+                         sys.argv[0])
+        sys.exit(1)
+
+    with open(sys.argv[1]) as f:
+        clock, names, events = read_trace(f)
+    events = unwrap(events)
+    trace, stats = convert(clock, names, events)
+
+    out = open(sys.argv[2], 'w') if len(sys.argv) == 3 else sys.stdout
+    json.dump({'traceEvents': trace, 'displayTimeUnit': 'ms'}, out)
+    out.write('\n')
+    summary(clock, names, events, stats)
+
+
+if __name__ == '__main__':
+    main()